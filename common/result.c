@@ -142,6 +142,8 @@ const char* oe_result_str(oe_result_t result)
             return "OE_QUOTE_LIBRARY_LOAD_ERROR";
         case OE_SGX_QUOTE_LIBRARY_ERROR:
             return "OE_SGX_QUOTE_LIBRARY_ERROR";
+        case OE_TIMEDOUT:
+            return "OE_TIMEDOUT";
         case __OE_RESULT_MAX:
             break;
     }
@@ -216,6 +218,7 @@ bool oe_is_valid_result(uint32_t result)
         case OE_INVALID_IMAGE:
         case OE_QUOTE_LIBRARY_LOAD_ERROR:
         case OE_SGX_QUOTE_LIBRARY_ERROR:
+        case OE_TIMEDOUT:
         {
             return true;
         }
@@ -197,6 +197,18 @@ oe_result_t oe_cond_wait(oe_cond_t* condition, oe_mutex_t* mutex)
     return OE_OK;
 }
 
+oe_result_t oe_cond_timedwait(
+    oe_cond_t* condition,
+    oe_mutex_t* mutex,
+    uint64_t deadline_ns)
+{
+    OE_UNUSED(condition);
+    OE_UNUSED(mutex);
+    OE_UNUSED(deadline_ns);
+
+    return OE_UNSUPPORTED;
+}
+
 oe_result_t oe_cond_signal(oe_cond_t* condition)
 {
     oe_cond_impl_t* cond = (oe_cond_impl_t*)condition;
@@ -332,6 +344,50 @@ oe_result_t oe_rwlock_unlock(oe_rwlock_t* read_write_lock)
     return OE_OK;
 }
 
+/*
+**==============================================================================
+**
+** Futex:
+**
+**     OP-TEE runs one thread per TA session, so nothing could wake a waiter.
+**
+**==============================================================================
+*/
+
+oe_result_t oe_futex_wait(
+    volatile int32_t* addr,
+    int32_t value,
+    uint32_t bitset,
+    uint64_t deadline_ns)
+{
+    OE_UNUSED(deadline_ns);
+
+    if (!addr || !bitset)
+        return OE_INVALID_PARAMETER;
+
+    if (*addr != value)
+        return OE_BUSY;
+
+    return OE_UNSUPPORTED;
+}
+
+oe_result_t oe_futex_wake(
+    volatile int32_t* addr,
+    uint32_t count,
+    uint32_t bitset,
+    uint32_t* num_woken)
+{
+    OE_UNUSED(count);
+
+    if (num_woken)
+        *num_woken = 0;
+
+    if (!addr || !bitset)
+        return OE_INVALID_PARAMETER;
+
+    return OE_OK;
+}
+
 /*
 **==============================================================================
 **
@@ -28,6 +28,8 @@ OE_INLINE int _to_errno(oe_result_t result)
             return OE_EPERM;
         case OE_OUT_OF_MEMORY:
             return OE_ENOMEM;
+        case OE_TIMEDOUT:
+            return OE_ETIMEDOUT;
         default:
             return OE_EINVAL; /* unreachable */
     }
@@ -212,6 +214,16 @@ int oe_pthread_rwlock_wrlock(oe_pthread_rwlock_t* rwlock)
     return _to_errno(oe_rwlock_wrlock((oe_rwlock_t*)rwlock));
 }
 
+int oe_pthread_rwlock_tryrdlock(oe_pthread_rwlock_t* rwlock)
+{
+    return _to_errno(oe_rwlock_tryrdlock((oe_rwlock_t*)rwlock));
+}
+
+int oe_pthread_rwlock_trywrlock(oe_pthread_rwlock_t* rwlock)
+{
+    return _to_errno(oe_rwlock_trywrlock((oe_rwlock_t*)rwlock));
+}
+
 int oe_pthread_rwlock_unlock(oe_pthread_rwlock_t* rwlock)
 {
     return _to_errno(oe_rwlock_unlock((oe_rwlock_t*)rwlock));
@@ -248,11 +260,22 @@ int oe_pthread_cond_timedwait(
     oe_pthread_mutex_t* mutex,
     const struct oe_timespec* ts)
 {
-    OE_UNUSED(cond);
-    OE_UNUSED(mutex);
-    OE_UNUSED(ts);
-    oe_assert("oe_pthread_cond_timedwait(): panic" == NULL);
-    return -1;
+    const uint64_t max_sec = OE_UINT64_MAX / 1000000000 - 1;
+    uint64_t deadline_ns;
+
+    if (!ts || ts->tv_sec < 0 || ts->tv_nsec < 0 || ts->tv_nsec >= 1000000000)
+        return OE_EINVAL;
+
+    // The deadline is on the realtime clock, the default clock of condition
+    // variables. Deadlines too far away to represent mean no deadline.
+    if ((uint64_t)ts->tv_sec > max_sec)
+        deadline_ns = OE_UINT64_MAX;
+    else
+        deadline_ns =
+            (uint64_t)ts->tv_sec * 1000000000 + (uint64_t)ts->tv_nsec;
+
+    return _to_errno(oe_cond_timedwait(
+        (oe_cond_t*)cond, (oe_mutex_t*)mutex, deadline_ns));
 }
 
 int oe_pthread_cond_signal(oe_pthread_cond_t* cond)
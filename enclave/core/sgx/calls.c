@@ -35,6 +35,8 @@
 #include "asmdefs.h"
 #include "core_t.h"
 #include "cpuid.h"
+#include "deferredocalls.h"
+#include "ecallbuffer.h"
 #include "handle_ecall.h"
 #include "init.h"
 #include "platform_t.h"
@@ -46,6 +48,8 @@
 oe_result_t __oe_enclave_status = OE_OK;
 uint8_t __oe_initialized = 0;
 
+static void _free_async_ocall_slots(void);
+
 /*
 **==============================================================================
 **
@@ -258,8 +262,8 @@ oe_result_t oe_handle_call_enclave_function(uint64_t arg_in)
     if (func == NULL)
         OE_RAISE(OE_NOT_FOUND);
 
-    // Allocate buffers in enclave memory
-    buffer = input_buffer = oe_malloc(buffer_size);
+    // Get buffers in enclave memory, reusing this thread's buffer if possible
+    buffer = input_buffer = oe_get_ecall_buffer(buffer_size);
     if (buffer == NULL)
         OE_RAISE(OE_OUT_OF_MEMORY);
 
@@ -335,14 +339,16 @@ oe_result_t oe_handle_call_enclave_function(uint64_t arg_in)
         // Copy outputs to host memory.
         memcpy(args.output_buffer, output_buffer, args.output_buffer_size);
 
-        // The ecall succeeded.
+        // The ecall succeeded. A switchless caller polls the result, so set
+        // it last.
         args_ptr->output_bytes_written = output_bytes_written;
+        OE_ATOMIC_MEMORY_BARRIER_RELEASE();
         args_ptr->result = OE_OK;
     }
 
 done:
     if (buffer)
-        oe_free(buffer);
+        oe_put_ecall_buffer(buffer, buffer_size);
 
     if (result != OE_OK && return_args_ptr && args.output_buffer)
     {
@@ -358,6 +364,58 @@ done:
     return result;
 }
 
+/*
+**==============================================================================
+**
+** _handle_call_enclave_function_batch()
+**
+**     Dispatch a batch of enclave function calls in a single ecall. Each
+**     call goes through oe_handle_call_enclave_function(), which copies and
+**     validates its arguments and buffers just as for a single ecall. A
+**     failed call does not stop the batch; its error is stored in its result.
+**
+**==============================================================================
+*/
+
+static oe_result_t _handle_call_enclave_function_batch(uint64_t arg_in)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_call_enclave_function_batch_args_t batch;
+    uint64_t calls_size;
+
+    // Ensure that args lies outside the enclave.
+    if (!oe_is_outside_enclave(
+            (void*)arg_in, sizeof(oe_call_enclave_function_batch_args_t)))
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    // Copy args to enclave memory to avoid TOCTOU issues.
+    batch = *(oe_call_enclave_function_batch_args_t*)arg_in;
+
+    OE_CHECK(oe_safe_mul_u64(
+        batch.num_calls, sizeof(oe_call_enclave_function_args_t), &calls_size));
+
+    if (batch.calls == NULL ||
+        !oe_is_outside_enclave(batch.calls, calls_size))
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    for (size_t i = 0; i < batch.num_calls; i++)
+    {
+        oe_result_t call_result =
+            oe_handle_call_enclave_function((uint64_t)&batch.calls[i]);
+
+        if (call_result != OE_OK)
+            batch.calls[i].result = call_result;
+
+        /* Each call starts with an empty arena, as a separate ecall would */
+        oe_arena_free_all();
+    }
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
 /*
 **==============================================================================
 **
@@ -460,6 +518,11 @@ static void _handle_ecall(
             arg_out = oe_handle_call_enclave_function(arg_in);
             break;
         }
+        case OE_ECALL_CALL_ENCLAVE_FUNCTION_BATCH:
+        {
+            arg_out = _handle_call_enclave_function_batch(arg_in);
+            break;
+        }
         case OE_ECALL_DESTRUCTOR:
         {
             /* Call functions installed by oe_cxa_atexit() and oe_atexit() */
@@ -474,6 +537,12 @@ static void _handle_ecall(
             /* Cleanup verifiers */
             oe_verifier_shutdown();
 
+            /* Release the per-thread ecall buffers */
+            oe_free_ecall_buffers();
+
+            /* Release the host slots of asynchronous ocalls */
+            _free_async_ocall_slots();
+
             /* If memory still allocated, print a trace and return an error */
             OE_CHECK(oe_check_memory_leaks());
 
@@ -749,81 +818,22 @@ done:
 /*
 **==============================================================================
 **
-** oe_call_host_function_by_table_id()
+** _complete_call_host_function()
+**
+**     Check the result of a host function call that has returned and bring
+**     any deep-copied outputs into enclave memory.
 **
 **==============================================================================
 */
 
-oe_result_t oe_call_host_function_internal(
-    uint64_t function_id,
-    const void* input_buffer,
-    size_t input_buffer_size,
+static oe_result_t _complete_call_host_function(
+    oe_call_host_function_args_t* args,
     void* output_buffer,
-    size_t output_buffer_size,
-    size_t* output_bytes_written,
-    bool switchless)
+    size_t* output_bytes_written)
 {
     oe_result_t result = OE_UNEXPECTED;
-    oe_call_host_function_args_t* args = NULL;
     oe_call_function_return_args_t return_args, *return_args_ptr = NULL;
 
-    /* Reject invalid parameters */
-    if (!input_buffer || input_buffer_size == 0)
-        OE_RAISE(OE_INVALID_PARAMETER);
-
-    /*
-     * oe_post_switchless_ocall (below) can make a regular ocall to wake up the
-     * host worker thread, and will end up using the ecall context's args.
-     * Therefore, for switchless calls, allocate args in the arena so that it is
-     * is not overwritten by oe_post_switchless_ocall.
-     */
-    args =
-        (oe_call_host_function_args_t*)(switchless ? oe_arena_malloc(sizeof(*args)) : oe_ecall_context_get_ocall_args());
-
-    if (args == NULL)
-    {
-        /* Fail if the enclave is crashing. */
-        OE_CHECK(__oe_enclave_status);
-        OE_RAISE(OE_UNEXPECTED);
-    }
-
-    args->function_id = function_id;
-    args->input_buffer = input_buffer;
-    args->input_buffer_size = input_buffer_size;
-    args->output_buffer = output_buffer;
-    args->output_buffer_size = output_buffer_size;
-    args->result = OE_UNEXPECTED;
-
-    /* Call the host function with this address */
-    if (switchless && oe_is_switchless_initialized())
-    {
-        oe_result_t post_result = oe_post_switchless_ocall(args);
-
-        // Fall back to regular OCALL if host worker threads are unavailable
-        if (post_result == OE_CONTEXT_SWITCHLESS_OCALL_MISSED)
-            OE_CHECK(
-                oe_ocall(OE_OCALL_CALL_HOST_FUNCTION, (uint64_t)args, NULL));
-        else
-        {
-            OE_CHECK(post_result);
-            // Wait until args.result is set by the host worker.
-            while (true)
-            {
-                OE_ATOMIC_MEMORY_BARRIER_ACQUIRE();
-                if (__atomic_load_n(&args->result, __ATOMIC_SEQ_CST) !=
-                    __OE_RESULT_MAX)
-                    break;
-
-                /* Yield to CPU */
-                asm volatile("pause");
-            }
-        }
-    }
-    else
-    {
-        OE_CHECK(oe_ocall(OE_OCALL_CALL_HOST_FUNCTION, (uint64_t)args, NULL));
-    }
-
     /* Check the result */
     OE_CHECK(args->result);
 
@@ -898,6 +908,101 @@ done:
     return result;
 }
 
+/*
+**==============================================================================
+**
+** oe_call_host_function_by_table_id()
+**
+**==============================================================================
+*/
+
+oe_result_t oe_call_host_function_internal(
+    uint64_t function_id,
+    const void* input_buffer,
+    size_t input_buffer_size,
+    void* output_buffer,
+    size_t output_buffer_size,
+    size_t* output_bytes_written,
+    bool switchless)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_call_host_function_args_t* args = NULL;
+
+    /* Reject invalid parameters */
+    if (!input_buffer || input_buffer_size == 0)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    /* The host may route the ocall differently from its EDL declaration */
+    switchless = oe_route_ocall(function_id, switchless);
+
+    /*
+     * A deferred ocall completes once it is queued for the host. Report
+     * success through a zeroed output buffer, as the host function would.
+     * If it cannot be queued, make a regular ocall instead.
+     */
+    if (!switchless && oe_is_ocall_deferred(function_id) &&
+        oe_defer_ocall(
+            function_id, input_buffer, input_buffer_size, output_buffer_size) ==
+            OE_OK)
+    {
+        memset(output_buffer, 0, output_buffer_size);
+        *output_bytes_written = output_buffer_size;
+        result = OE_OK;
+        goto done;
+    }
+
+    /*
+     * oe_post_switchless_ocall (below) can make a regular ocall to wake up the
+     * host worker thread, and will end up using the ecall context's args.
+     * Therefore, for switchless calls, allocate args in the arena so that it is
+     * is not overwritten by oe_post_switchless_ocall.
+     */
+    args =
+        (oe_call_host_function_args_t*)(switchless ? oe_arena_malloc(sizeof(*args)) : oe_ecall_context_get_ocall_args());
+
+    if (args == NULL)
+    {
+        /* Fail if the enclave is crashing. */
+        OE_CHECK(__oe_enclave_status);
+        OE_RAISE(OE_UNEXPECTED);
+    }
+
+    args->function_id = function_id;
+    args->input_buffer = input_buffer;
+    args->input_buffer_size = input_buffer_size;
+    args->output_buffer = output_buffer;
+    args->output_buffer_size = output_buffer_size;
+    args->result = OE_UNEXPECTED;
+
+    /* Call the host function with this address */
+    if (switchless && oe_is_switchless_initialized())
+    {
+        oe_result_t post_result = oe_post_switchless_ocall(args);
+
+        // Fall back to regular OCALL if the switchless call ring is full
+        if (post_result == OE_CONTEXT_SWITCHLESS_OCALL_MISSED)
+            OE_CHECK(
+                oe_ocall(OE_OCALL_CALL_HOST_FUNCTION, (uint64_t)args, NULL));
+        else
+        {
+            OE_CHECK(post_result);
+            // Wait until args.result is set by the host worker.
+            oe_wait_switchless_ocall(args);
+        }
+    }
+    else
+    {
+        OE_CHECK(oe_ocall(OE_OCALL_CALL_HOST_FUNCTION, (uint64_t)args, NULL));
+    }
+
+    OE_CHECK(_complete_call_host_function(
+        args, output_buffer, output_bytes_written));
+    result = OE_OK;
+
+done:
+    return result;
+}
+
 /*
 **==============================================================================
 **
@@ -925,6 +1030,232 @@ oe_result_t oe_call_host_function(
         false /* non-switchless */);
 }
 
+/*
+**==============================================================================
+**
+** Asynchronous host function calls:
+**
+**     oe_call_host_function_async() posts the call to a switchless host
+**     worker and returns without waiting for args->result to be set. The
+**     args of calls in flight cannot live in the shared memory arena, which
+**     generated code resets after every switchless ocall, so they are taken
+**     from a pool of slots in host memory, allocated on first use. When the
+**     pool is exhausted, the call is made synchronously.
+**
+**==============================================================================
+*/
+
+#define OE_MAX_ASYNC_OCALLS 64
+
+static oe_call_host_function_args_t* _async_ocall_args;
+static uint64_t _async_ocall_slots;
+static oe_spinlock_t _async_ocall_lock = OE_SPINLOCK_INITIALIZER;
+
+struct _oe_ocall_handle
+{
+    /* Slot in host memory; the host sets args->result on completion. NULL
+     * if the call was made synchronously. */
+    oe_call_host_function_args_t* args;
+    uint64_t slot;
+    void* output_buffer;
+
+    /* Outcome of a synchronous call */
+    oe_result_t result;
+    size_t output_bytes_written;
+};
+
+static oe_call_host_function_args_t* _get_async_ocall_slot(uint64_t* slot)
+{
+    oe_call_host_function_args_t* args = NULL;
+    uint64_t slots;
+
+    if (!_async_ocall_args)
+    {
+        oe_spin_lock(&_async_ocall_lock);
+
+        if (!_async_ocall_args)
+            _async_ocall_args = (oe_call_host_function_args_t*)oe_host_calloc(
+                OE_MAX_ASYNC_OCALLS, sizeof(oe_call_host_function_args_t));
+
+        oe_spin_unlock(&_async_ocall_lock);
+    }
+
+    args = _async_ocall_args;
+
+    if (!args ||
+        !oe_is_outside_enclave(
+            args, OE_MAX_ASYNC_OCALLS * sizeof(oe_call_host_function_args_t)))
+        return NULL;
+
+    slots = __atomic_load_n(&_async_ocall_slots, __ATOMIC_ACQUIRE);
+
+    while (~slots)
+    {
+        uint64_t index = (uint64_t)__builtin_ctzll(~slots);
+
+        if (__atomic_compare_exchange_n(
+                &_async_ocall_slots,
+                &slots,
+                slots | (1ULL << index),
+                false,
+                __ATOMIC_ACQ_REL,
+                __ATOMIC_ACQUIRE))
+        {
+            *slot = index;
+            return &args[index];
+        }
+    }
+
+    return NULL;
+}
+
+static void _put_async_ocall_slot(uint64_t slot)
+{
+    __atomic_fetch_and(&_async_ocall_slots, ~(1ULL << slot), __ATOMIC_RELEASE);
+}
+
+static void _free_async_ocall_slots(void)
+{
+    oe_host_free(_async_ocall_args);
+    _async_ocall_args = NULL;
+    _async_ocall_slots = 0;
+}
+
+oe_result_t oe_call_host_function_async(
+    size_t function_id,
+    const void* input_buffer,
+    size_t input_buffer_size,
+    void* output_buffer,
+    size_t output_buffer_size,
+    oe_ocall_handle_t** handle_out)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_ocall_handle_t* handle = NULL;
+    oe_call_host_function_args_t* args = NULL;
+    bool posted = false;
+
+    if (handle_out)
+        *handle_out = NULL;
+
+    /* Reject invalid parameters */
+    if (!input_buffer || input_buffer_size == 0 || !output_buffer ||
+        !handle_out)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    /* The host accesses the buffers while the enclave keeps running */
+    if (!oe_is_outside_enclave(input_buffer, input_buffer_size) ||
+        !oe_is_outside_enclave(output_buffer, output_buffer_size))
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    if (!(handle = (oe_ocall_handle_t*)oe_calloc(1, sizeof(*handle))))
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    handle->output_buffer = output_buffer;
+
+    /* Ocalls the host routes as regular calls complete right away */
+    if (oe_is_switchless_initialized() && oe_route_ocall(function_id, true) &&
+        (args = _get_async_ocall_slot(&handle->slot)))
+    {
+        args->function_id = function_id;
+        args->input_buffer = input_buffer;
+        args->input_buffer_size = input_buffer_size;
+        args->output_buffer = output_buffer;
+        args->output_buffer_size = output_buffer_size;
+        args->output_bytes_written = 0;
+
+        oe_result_t post_result = oe_post_switchless_ocall(args);
+
+        if (post_result == OE_OK)
+        {
+            handle->args = args;
+            posted = true;
+        }
+        else
+        {
+            _put_async_ocall_slot(handle->slot);
+
+            if (post_result != OE_CONTEXT_SWITCHLESS_OCALL_MISSED)
+                OE_RAISE(post_result);
+        }
+    }
+
+    // Fall back to regular OCALL if no host worker or slot is available
+    if (!posted)
+    {
+        handle->result = oe_call_host_function_internal(
+            function_id,
+            input_buffer,
+            input_buffer_size,
+            output_buffer,
+            output_buffer_size,
+            &handle->output_bytes_written,
+            false /* non-switchless */);
+    }
+
+    *handle_out = handle;
+    handle = NULL;
+    result = OE_OK;
+
+done:
+    oe_free(handle);
+    return result;
+}
+
+bool oe_ocall_poll(oe_ocall_handle_t* handle)
+{
+    if (!handle)
+        return false;
+
+    if (!handle->args)
+        return true;
+
+    return __atomic_load_n(&handle->args->result, __ATOMIC_SEQ_CST) !=
+           __OE_RESULT_MAX;
+}
+
+oe_result_t oe_ocall_wait(
+    oe_ocall_handle_t* handle,
+    size_t* output_bytes_written)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    size_t bytes_written = 0;
+
+    if (!handle)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    /*
+     * The handle is freed on every return path, so complete the call and
+     * release its slot before checking the other parameters. Otherwise the
+     * host could still write to a slot that a later call reuses.
+     */
+    if (handle->args)
+    {
+        // Wait until args.result is set by the host worker.
+        oe_wait_switchless_ocall(handle->args);
+
+        result = _complete_call_host_function(
+            handle->args, handle->output_buffer, &bytes_written);
+
+        _put_async_ocall_slot(handle->slot);
+    }
+    else
+    {
+        result = handle->result;
+        bytes_written = handle->output_bytes_written;
+    }
+
+    if (!output_bytes_written)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    OE_CHECK(result);
+    *output_bytes_written = bytes_written;
+    result = OE_OK;
+
+done:
+    oe_free(handle);
+    return result;
+}
+
 /*
 **==============================================================================
 **
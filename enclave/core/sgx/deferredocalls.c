@@ -0,0 +1,184 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+
+#include "deferredocalls.h"
+#include <openenclave/corelibc/string.h>
+#include <openenclave/edger8r/common.h>
+#include <openenclave/enclave.h>
+#include <openenclave/internal/calls.h>
+#include <openenclave/internal/raise.h>
+#include <openenclave/internal/safemath.h>
+#include <openenclave/internal/sgx/ecall_context.h>
+#include <openenclave/internal/sgx/td.h>
+#include <openenclave/internal/utils.h>
+
+/*
+**==============================================================================
+**
+** Deferred ocalls:
+**
+**     The host passes a queue in host memory through the ecall context. A
+**     deferred ocall is appended to it as an oe_deferred_ocall_t followed by
+**     the marshalled inputs and room for the outputs. Before dispatching any
+**     regular ocall, and after the ecall returns, the host runs the queued
+**     ocalls in order, so the order of ocalls on a thread is preserved.
+**
+**     The queue fields are host memory; they are copied before being checked
+**     and the enclave only ever writes within the queue buffer.
+**
+**     Only function ids that opted in are ever deferred, since the caller of
+**     a deferred ocall gets a zeroed output. Ocalls made while the runtime
+**     forces regular ocalls (e.g., to wake switchless workers) are never
+**     deferred.
+**
+**==============================================================================
+*/
+
+/* Ids deferred everywhere, and ids deferred within a begin/end scope */
+static uint64_t _deferred_ids[OE_MAX_DEFERRED_OCALL_ID / 64];
+static uint64_t _deferrable_ids[OE_MAX_DEFERRED_OCALL_ID / 64];
+
+static oe_result_t _set_id(uint64_t* ids, uint64_t function_id, bool set)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    uint64_t* word;
+    uint64_t mask;
+
+    if (function_id >= OE_MAX_DEFERRED_OCALL_ID)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    word = &ids[function_id / 64];
+    mask = 1ULL << (function_id % 64);
+
+    if (set)
+        __atomic_fetch_or(word, mask, __ATOMIC_SEQ_CST);
+    else
+        __atomic_fetch_and(word, ~mask, __ATOMIC_SEQ_CST);
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+static bool _has_id(const uint64_t* ids, uint64_t function_id)
+{
+    return __atomic_load_n(&ids[function_id / 64], __ATOMIC_RELAXED) &
+           (1ULL << (function_id % 64));
+}
+
+oe_result_t oe_set_ocall_deferred(uint64_t function_id, bool deferred)
+{
+    return _set_id(_deferred_ids, function_id, deferred);
+}
+
+oe_result_t oe_set_ocall_deferrable(uint64_t function_id, bool deferrable)
+{
+    return _set_id(_deferrable_ids, function_id, deferrable);
+}
+
+void oe_begin_deferred_ocalls(void)
+{
+    oe_sgx_get_td()->deferred_ocalls_depth++;
+}
+
+void oe_end_deferred_ocalls(void)
+{
+    oe_sgx_td_t* td = oe_sgx_get_td();
+
+    if (td->deferred_ocalls_depth)
+        td->deferred_ocalls_depth--;
+}
+
+bool oe_is_ocall_deferred(uint64_t function_id)
+{
+    oe_sgx_td_t* td = oe_sgx_get_td();
+
+    if (function_id >= OE_MAX_DEFERRED_OCALL_ID || td->force_regular_ocalls)
+        return false;
+
+    if (_has_id(_deferred_ids, function_id))
+        return true;
+
+    return td->deferred_ocalls_depth &&
+           _has_id(_deferrable_ids, function_id);
+}
+
+oe_result_t oe_flush_deferred_ocalls(void)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_deferred_ocall_queue_t* queue =
+        oe_ecall_context_get_deferred_ocall_queue();
+
+    /* The host runs queued ocalls before dispatching any ocall */
+    if (queue && queue->count)
+        OE_CHECK(oe_ocall(OE_OCALL_FLUSH_DEFERRED_OCALLS, 0, NULL));
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+oe_result_t oe_defer_ocall(
+    uint64_t function_id,
+    const void* input_buffer,
+    size_t input_buffer_size,
+    size_t output_buffer_size)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_deferred_ocall_queue_t* queue;
+    uint8_t* buffer;
+    uint64_t capacity;
+    uint64_t size;
+    uint64_t entry_size;
+    oe_deferred_ocall_t* ocall;
+
+    if (!(queue = oe_ecall_context_get_deferred_ocall_queue()))
+        OE_RAISE_NO_TRACE(OE_UNSUPPORTED);
+
+    OE_CHECK_NO_TRACE(oe_safe_add_u64(
+        sizeof(oe_deferred_ocall_t), input_buffer_size, &entry_size));
+    OE_CHECK_NO_TRACE(
+        oe_safe_add_u64(entry_size, output_buffer_size, &entry_size));
+
+    if (entry_size % OE_EDGER8R_BUFFER_ALIGNMENT)
+        OE_RAISE_NO_TRACE(OE_INVALID_PARAMETER);
+
+    for (int attempt = 0;; attempt++)
+    {
+        // Copy to volatile variables to prevent TOCTOU attacks.
+        buffer = *(uint8_t* volatile*)&queue->buffer;
+        capacity = *(volatile uint64_t*)&queue->capacity;
+        size = *(volatile uint64_t*)&queue->size;
+
+        if (size > capacity || !oe_is_outside_enclave(buffer, capacity))
+            OE_RAISE_NO_TRACE(OE_UNEXPECTED);
+
+        if (entry_size <= capacity - size)
+            break;
+
+        /* Make room by having the host run the queued ocalls */
+        if (attempt || size == 0 || entry_size > capacity)
+            OE_RAISE_NO_TRACE(OE_BUFFER_TOO_SMALL);
+
+        OE_CHECK_NO_TRACE(oe_ocall(OE_OCALL_FLUSH_DEFERRED_OCALLS, 0, NULL));
+    }
+
+    ocall = (oe_deferred_ocall_t*)(buffer + size);
+    ocall->function_id = function_id;
+    ocall->input_buffer_size = input_buffer_size;
+    ocall->output_buffer_size = output_buffer_size;
+    ocall->reserved = 0;
+    memcpy(ocall + 1, input_buffer, input_buffer_size);
+
+    /* Publish the ocall after its contents */
+    OE_ATOMIC_MEMORY_BARRIER_RELEASE();
+    queue->size = size + entry_size;
+    queue->count++;
+
+    result = OE_OK;
+
+done:
+    return result;
+}
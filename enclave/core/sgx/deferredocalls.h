@@ -0,0 +1,20 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+
+#ifndef _OE_DEFERRED_OCALLS_H
+#define _OE_DEFERRED_OCALLS_H
+
+#include <openenclave/bits/result.h>
+#include <openenclave/bits/types.h>
+
+/* Whether an ocall to the given function should be deferred */
+bool oe_is_ocall_deferred(uint64_t function_id);
+
+/* Queue the ocall for the host; fails if it must be made as a regular ocall */
+oe_result_t oe_defer_ocall(
+    uint64_t function_id,
+    const void* input_buffer,
+    size_t input_buffer_size,
+    size_t output_buffer_size);
+
+#endif /* _OE_DEFERRED_OCALLS_H */
@@ -0,0 +1,173 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+
+#include "ecallbuffer.h"
+#include <openenclave/corelibc/stdlib.h>
+#include <openenclave/internal/calls.h>
+#include <openenclave/internal/sgx/td.h>
+#include <openenclave/internal/thread.h>
+
+/*
+**==============================================================================
+**
+** Per-thread ecall buffers:
+**
+**     oe_handle_call_enclave_function() copies the ecall parameters into
+**     enclave memory. Rather than allocating that memory on every ecall,
+**     each thread (TCS) keeps a buffer in its oe_sgx_td_t and reuses it.
+**
+**     - Nested ecalls (for example switchless ecalls handled inside a worker
+**       ecall) take the next region of the buffer, like a stack.
+**     - When no ecall is using it, the buffer grows to the next power of two
+**       that fits the request.
+**     - Requests that do not fit, or that exceed _MAX_CACHED_CAPACITY, are
+**       served from the heap as before.
+**     - After _SHRINK_AFTER consecutive ecalls that use at most a quarter of
+**       the buffer, it is halved, so one large ecall does not pin memory.
+**
+**     Threads owning a buffer are kept on a list so that the buffers can be
+**     released by the enclave destructor before memory leaks are checked.
+**
+**==============================================================================
+*/
+
+#define _MIN_CAPACITY (4 * 1024)
+#define _MAX_CACHED_CAPACITY (256 * 1024)
+#define _SHRINK_AFTER 64
+
+static oe_sgx_td_t* _tds;
+static oe_spinlock_t _lock = OE_SPINLOCK_INITIALIZER;
+
+static void _register_td(oe_sgx_td_t* td)
+{
+    oe_spin_lock(&_lock);
+    td->ecall_buffer.next = _tds;
+    _tds = td;
+    oe_spin_unlock(&_lock);
+}
+
+static bool _resize(oe_ecall_buffer_t* buffer, size_t capacity)
+{
+    uint8_t* data = (uint8_t*)oe_malloc(capacity);
+
+    if (!data)
+        return false;
+
+    oe_free(buffer->data);
+    buffer->data = data;
+    buffer->capacity = capacity;
+    buffer->num_underused = 0;
+    return true;
+}
+
+void* oe_get_ecall_buffer(size_t size)
+{
+    oe_sgx_td_t* td = oe_sgx_get_td();
+    oe_ecall_buffer_t* buffer = &td->ecall_buffer;
+    void* data;
+
+    /* The first ecall on this thread makes its counters visible */
+    if (!buffer->num_reused && !buffer->num_allocated)
+        _register_td(td);
+
+    if (size > _MAX_CACHED_CAPACITY)
+        goto heap;
+
+    /* Only grow the buffer while no ecall is using it */
+    if (buffer->used == 0 && size > buffer->capacity)
+    {
+        size_t capacity = _MIN_CAPACITY;
+
+        while (capacity < size)
+            capacity <<= 1;
+
+        buffer->num_allocated++;
+
+        if (!_resize(buffer, capacity))
+            return NULL;
+    }
+    else if (buffer->used + size <= buffer->capacity)
+    {
+        buffer->num_reused++;
+    }
+    else
+    {
+        goto heap;
+    }
+
+    /* Sizes are multiples of OE_EDGER8R_BUFFER_ALIGNMENT, so nested regions
+     * stay aligned */
+    data = buffer->data + buffer->used;
+    buffer->used += (uint32_t)size;
+    return data;
+
+heap:
+    buffer->num_allocated++;
+    return oe_malloc(size);
+}
+
+void oe_put_ecall_buffer(void* data, size_t size)
+{
+    oe_ecall_buffer_t* buffer = &oe_sgx_get_td()->ecall_buffer;
+    uint8_t* p = (uint8_t*)data;
+
+    if (p < buffer->data || p >= buffer->data + buffer->capacity)
+    {
+        oe_free(data);
+        return;
+    }
+
+    /* Regions are released in the reverse order of oe_get_ecall_buffer() */
+    buffer->used -= (uint32_t)size;
+
+    if (buffer->used)
+        return;
+
+    if (buffer->capacity > _MIN_CAPACITY && size <= buffer->capacity / 4)
+    {
+        /* If the smaller buffer cannot be allocated, keep the current one */
+        if (++buffer->num_underused >= _SHRINK_AFTER)
+            _resize(buffer, buffer->capacity / 2);
+    }
+    else
+    {
+        buffer->num_underused = 0;
+    }
+}
+
+void oe_free_ecall_buffers(void)
+{
+    oe_spin_lock(&_lock);
+
+    for (oe_sgx_td_t* td = _tds; td; td = td->ecall_buffer.next)
+    {
+        oe_free(td->ecall_buffer.data);
+        td->ecall_buffer.data = NULL;
+        td->ecall_buffer.capacity = 0;
+        td->ecall_buffer.used = 0;
+        td->ecall_buffer.num_underused = 0;
+    }
+
+    oe_spin_unlock(&_lock);
+}
+
+void oe_get_ecall_buffer_statistics(oe_ecall_buffer_statistics_t* statistics)
+{
+    if (!statistics)
+        return;
+
+    statistics->num_reused = 0;
+    statistics->num_allocated = 0;
+    statistics->bytes_cached = 0;
+
+    oe_spin_lock(&_lock);
+
+    for (oe_sgx_td_t* td = _tds; td; td = td->ecall_buffer.next)
+    {
+        statistics->num_reused += td->ecall_buffer.num_reused;
+        statistics->num_allocated += td->ecall_buffer.num_allocated;
+        statistics->bytes_cached += td->ecall_buffer.capacity;
+    }
+
+    oe_spin_unlock(&_lock);
+}
@@ -0,0 +1,18 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+
+#ifndef _OE_ECALL_BUFFER_H
+#define _OE_ECALL_BUFFER_H
+
+#include <openenclave/bits/types.h>
+
+/* Get an enclave buffer of at least size bytes for the ecall parameters */
+void* oe_get_ecall_buffer(size_t size);
+
+/* Release a buffer obtained with oe_get_ecall_buffer() */
+void oe_put_ecall_buffer(void* buffer, size_t size);
+
+/* Free the cached buffers of all threads */
+void oe_free_ecall_buffers(void);
+
+#endif /* _OE_ECALL_BUFFER_H */
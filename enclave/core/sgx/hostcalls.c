@@ -47,6 +47,23 @@ void* oe_ecall_context_get_ocall_buffer(uint64_t size)
     return NULL;
 }
 
+/**
+ * Fetch the deferred ocall queue if an ecall context has been passed in.
+ */
+oe_deferred_ocall_queue_t* oe_ecall_context_get_deferred_ocall_queue()
+{
+    oe_ecall_context_t* ecall_context = _get_ecall_context();
+    if (ecall_context)
+    {
+        // Copy to a volatile variable to prevent TOCTOU attacks.
+        oe_deferred_ocall_queue_t* volatile queue =
+            ecall_context->deferred_ocalls;
+        if (oe_is_outside_enclave(queue, sizeof(*queue)))
+            return queue;
+    }
+    return NULL;
+}
+
 // Function used by oeedger8r for allocating ocall buffers.
 void* oe_allocate_ocall_buffer(size_t size)
 {
@@ -58,6 +75,15 @@ void* oe_allocate_ocall_buffer(size_t size)
         return buffer;
     }
 
+    // Let the host know the buffer was too small so that it can grow it.
+    oe_ecall_context_t* ecall_context = _get_ecall_context();
+    if (ecall_context)
+    {
+        ecall_context->ocall_buffer_misses++;
+        if (size > ecall_context->ocall_buffer_miss_size)
+            ecall_context->ocall_buffer_miss_size = size;
+    }
+
     // Perform host allocation by making an ocall.
     return oe_host_malloc(size);
 }
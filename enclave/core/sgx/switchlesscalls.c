@@ -7,6 +7,7 @@
 #include <openenclave/internal/atomic.h>
 #include <openenclave/internal/defs.h>
 #include <openenclave/internal/raise.h>
+#include <openenclave/internal/sgx/td.h>
 #include <openenclave/internal/utils.h>
 #include "arena.h"
 #include "handle_ecall.h"
@@ -19,6 +20,17 @@ static size_t _host_worker_count = 0;
 // The array of host worker contexts. Initialized by host through ECALL
 static oe_host_worker_context_t* _host_worker_contexts = NULL;
 
+// The ring of pending switchless ocalls and enclave copies of its slots and
+// mask. Initialized by host through ECALL
+static oe_switchless_ring_t* _host_worker_ring = NULL;
+static oe_switchless_ring_slot_t* _host_worker_ring_slots = NULL;
+static uint64_t _host_worker_ring_mask = 0;
+
+// The route of each ocall chosen by the host, indexed by function id.
+// Initialized by host through ECALL
+static volatile uint8_t* _ocall_routes = NULL;
+static uint64_t _num_ocall_routes = 0;
+
 // Flag to denote if switchless calls have already been initialized.
 static bool _is_switchless_initialized = false;
 
@@ -40,6 +52,7 @@ oe_result_t _oe_sgx_wake_switchless_worker_ocall(
     oe_host_worker_context_t* context);
 oe_result_t _oe_sgx_sleep_switchless_worker_ocall(
     oe_enclave_worker_context_t* context);
+oe_result_t _oe_sgx_wait_switchless_ocall_ocall(void* call_arg);
 
 /**
  * Make the following OCALLs weak to support the system EDL opt-in.
@@ -68,6 +81,15 @@ OE_WEAK_ALIAS(
     _oe_sgx_sleep_switchless_worker_ocall,
     oe_sgx_sleep_switchless_worker_ocall);
 
+oe_result_t _oe_sgx_wait_switchless_ocall_ocall(void* call_arg)
+{
+    OE_UNUSED(call_arg);
+    return OE_UNSUPPORTED;
+}
+OE_WEAK_ALIAS(
+    _oe_sgx_wait_switchless_ocall_ocall,
+    oe_sgx_wait_switchless_ocall_ocall);
+
 /*
 **==============================================================================
 **
@@ -98,11 +120,18 @@ bool oe_is_switchless_initialized()
 **==============================================================================
 */
 oe_result_t oe_sgx_init_context_switchless_ecall(
+    uint32_t layout_version,
     oe_host_worker_context_t* host_worker_contexts,
-    uint64_t num_host_workers)
+    uint64_t num_host_workers,
+    oe_switchless_ring_t* host_worker_ring,
+    uint8_t* ocall_routes,
+    uint64_t num_ocall_routes)
 {
     oe_result_t result = OE_UNEXPECTED;
     uint64_t contexts_size = 0;
+    oe_switchless_ring_slot_t* ring_slots = NULL;
+    uint64_t ring_capacity = 0;
+    uint64_t ring_size = 0;
 
     if (!oe_atomic_compare_and_swap(
             &_switchless_init_in_progress, (int64_t) false, (int64_t) true))
@@ -115,6 +144,10 @@ oe_result_t oe_sgx_init_context_switchless_ecall(
         OE_RAISE(OE_ALREADY_INITIALIZED);
     }
 
+    // The host must lay out the shared structures as the enclave does.
+    if (layout_version != OE_SWITCHLESS_LAYOUT_VERSION)
+        OE_RAISE(OE_UNSUPPORTED);
+
     OE_CHECK(oe_safe_mul_u64(
         sizeof(oe_host_worker_context_t), num_host_workers, &contexts_size));
 
@@ -125,12 +158,40 @@ oe_result_t oe_sgx_init_context_switchless_ecall(
         OE_RAISE(OE_INVALID_PARAMETER);
     }
 
+    // Ensure the ring and its slots are outside of enclave. The slots and
+    // capacity are read once and kept in enclave memory.
+    if (!oe_is_outside_enclave(host_worker_ring, sizeof(*host_worker_ring)))
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    ring_slots = host_worker_ring->slots;
+    ring_capacity = host_worker_ring->capacity;
+
+    // The capacity must be a power of 2.
+    if (ring_capacity == 0 || (ring_capacity & (ring_capacity - 1)) != 0)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    OE_CHECK(oe_safe_mul_u64(
+        sizeof(oe_switchless_ring_slot_t), ring_capacity, &ring_size));
+
+    if (!oe_is_outside_enclave(ring_slots, ring_size))
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    // The routes are optional. If present, they must be outside of enclave.
+    if (num_ocall_routes &&
+        !oe_is_outside_enclave(ocall_routes, num_ocall_routes))
+        OE_RAISE(OE_INVALID_PARAMETER);
+
     /* lfence after checks. */
     oe_lfence();
 
     // Stash host worker information in enclave memory.
     _host_worker_count = num_host_workers;
     _host_worker_contexts = host_worker_contexts;
+    _host_worker_ring = host_worker_ring;
+    _host_worker_ring_slots = ring_slots;
+    _host_worker_ring_mask = ring_capacity - 1;
+    _ocall_routes = ocall_routes;
+    _num_ocall_routes = num_ocall_routes;
 
     __atomic_store_n(&_is_switchless_initialized, true, __ATOMIC_SEQ_CST);
 
@@ -142,83 +203,182 @@ done:
     return result;
 }
 
+/*
+**==============================================================================
+**
+** _wake_host_worker()
+**
+**  Make sure that some host worker will look at the ring after a call has
+**  been pushed onto it.
+**
+**==============================================================================
+*/
+static void _wake_host_worker(void)
+{
+    for (size_t i = 0; i < _host_worker_count; i++)
+    {
+        // If event is 0, the worker may have gone to sleep. Wake it by
+        // making an ocall (oe_sgx_wake_switchless_worker_ocall).
+        // Note: it is important to use an atomic cas operation to set
+        // the value to 1 before making the ocall. Setting the value to
+        // 1 prevents the host worker from simulataneously going to
+        // sleep. If instead, just a compare operation is used to
+        // determine if the host thread is sleeping or not, the host
+        // thread could go to sleep after the enclave has determined
+        // that the host is not sleeping, causing a deadlock.
+        //
+        // If event is 1, that indicates a pending wake notification, or a
+        // worker that is awake. Either way, that worker checks the ring
+        // again before it sleeps, so no ocall is needed.
+        int32_t oldval = 0;
+        int32_t newval = 1;
+        // Weak operation could sporadically fail.
+        // We need a strong operation.
+        bool weak = false;
+        if (__atomic_compare_exchange_n(
+                &_host_worker_contexts[i].event,
+                &oldval,
+                newval,
+                weak,
+                __ATOMIC_ACQ_REL,
+                __ATOMIC_ACQUIRE))
+        {
+            // The pevious value of the event was 0 which means that the
+            // worker may be sleeping. Wake it via an ocall, which must not
+            // itself wait for a worker.
+            oe_sgx_get_td()->force_regular_ocalls++;
+            oe_sgx_wake_switchless_worker_ocall(&_host_worker_contexts[i]);
+            oe_sgx_get_td()->force_regular_ocalls--;
+            return;
+        }
+    }
+}
+
+/*
+**==============================================================================
+**
+** oe_route_ocall()
+**
+**  Return whether an ocall to the given function is made as a switchless
+**  call. The host may override the choice declared in the EDL for each
+**  function, e.g. to keep blocking ocalls off the host workers.
+**
+**==============================================================================
+*/
+bool oe_route_ocall(uint64_t function_id, bool switchless)
+{
+    uint8_t route;
+
+    if (!oe_is_switchless_initialized() ||
+        function_id >= _num_ocall_routes ||
+        oe_sgx_get_td()->force_regular_ocalls)
+        return switchless;
+
+    // The routes are host memory. Any value is safe: it only picks one of
+    // the two ways of making the call.
+    route = _ocall_routes[function_id];
+
+    if (route == OE_SWITCHLESS_OCALL_ROUTE_SWITCHLESS)
+        return true;
+
+    if (route == OE_SWITCHLESS_OCALL_ROUTE_REGULAR)
+        return false;
+
+    return switchless;
+}
+
 /*
 **==============================================================================
 **
 ** oe_post_switchless_ocall()
 **
-**  Post the function call (wrapped in args) to a free host worker thread
-**  by writing to its context.
+**  Queue the function call (wrapped in args) on the ring shared with the host
+**  workers and wake a worker if needed. Bursts larger than the number of
+**  workers wait in the ring; the call only misses when the ring is full.
 **
 **==============================================================================
 */
 oe_result_t oe_post_switchless_ocall(oe_call_host_function_args_t* args)
 {
-    oe_result_t result = OE_UNEXPECTED;
-
+    args->parked = 0;
     OE_ATOMIC_MEMORY_BARRIER_RELEASE();
     args->result = __OE_RESULT_MAX; // Means the call hasn't been processed.
 
-    // Cycle through the worker contexts until we find a free worker.
-    size_t tries = _host_worker_count;
-    while (tries--)
+    if (!oe_switchless_ring_push(
+            _host_worker_ring,
+            _host_worker_ring_slots,
+            _host_worker_ring_mask,
+            args))
+    {
+        // Let the host see how often the workers fall behind.
+        oe_atomic_increment(&_host_worker_ring->misses);
+        return OE_CONTEXT_SWITCHLESS_OCALL_MISSED;
+    }
+
+    _wake_host_worker();
+
+    return OE_OK;
+}
+
+static bool _is_switchless_ocall_done(oe_call_host_function_args_t* args)
+{
+    return __atomic_load_n(&args->result, __ATOMIC_SEQ_CST) != __OE_RESULT_MAX;
+}
+
+/*
+**==============================================================================
+**
+** oe_wait_switchless_ocall()
+**
+**  Wait for a host worker to complete a posted switchless ocall. Spin for a
+**  while, as most ocalls are short, then park in the host until the worker
+**  wakes this thread. Without the wait ocall, keep spinning.
+**
+**  The caller sets args->parked before it checks the result for the last
+**  time, and the worker sets the result before it clears args->parked. Both
+**  are full barriers, so either the caller sees the result and does not
+**  park, or the worker sees the flag and wakes the caller. The host only
+**  sleeps while the flag is still set, so a wake that comes before the
+**  caller is asleep is not lost.
+**
+**==============================================================================
+*/
+void oe_wait_switchless_ocall(oe_call_host_function_args_t* args)
+{
+    oe_result_t result = OE_OK;
+
+    for (uint64_t i = 0; i < OE_SWITCHLESS_OCALL_SPIN_PAUSES; i++)
     {
-        // Check if the worker's slot is free.
-        if (_host_worker_contexts[tries].call_arg == NULL)
+        if (_is_switchless_ocall_done(args))
+            goto done;
+
+        /* Yield to CPU */
+        asm volatile("pause");
+    }
+
+    // A wake may also be left over from an earlier call that used the same
+    // arguments, so check the result again after every wake.
+    while (!_is_switchless_ocall_done(args))
+    {
+        __atomic_store_n(&args->parked, 1, __ATOMIC_SEQ_CST);
+
+        if (_is_switchless_ocall_done(args))
+            break;
+
+        // The ocall to park must not itself be posted to a worker.
+        oe_sgx_get_td()->force_regular_ocalls++;
+        result = oe_sgx_wait_switchless_ocall_ocall(args);
+        oe_sgx_get_td()->force_regular_ocalls--;
+
+        if (result == OE_UNSUPPORTED)
         {
-            // Try to atomically grab the slot by placing args in the slot.
-            // If the atomic operation was successful, then the worker thread
-            // will execute this switchless ocall. If the atomic operation
-            // failed, this means that the slot was grabbed by another
-            // switchless ocall and therefore, we must scan for another worker
-            // thread with a free slot.
-            if (oe_atomic_compare_and_swap_ptr(
-                    (void* volatile*)&_host_worker_contexts[tries].call_arg,
-                    NULL,
-                    args))
-            {
-                // The worker thread has been marked to execute this switchless
-                // call. Determine if it needs to be woken up or not.
-                //
-                // If event is 0, it means that it has gone to sleep. Wake it by
-                // making an ocall (oe_sgx_wake_switchless_worker_ocall).
-                // Note: it is important to use an atomic cas operation to set
-                // the value to 1 before making the ocall. Setting the value to
-                // 1 prevents the host worker from simulataneously going to
-                // sleep. If instead, just a compare operation is used to
-                // determine if the host thread is sleeping or not, the host
-                // thread could go to sleep after the enclave has determined
-                // that the host is not sleeping, causing a deadlock.
-                //
-                // If event is 1, that indicates a pending wake notification.
-                int32_t oldval = 0;
-                int32_t newval = 1;
-                // Weak operation could sporadically fail.
-                // We need a strong operation.
-                bool weak = false;
-                if (__atomic_compare_exchange_n(
-                        &_host_worker_contexts[tries].event,
-                        &oldval,
-                        newval,
-                        weak,
-                        __ATOMIC_ACQ_REL,
-                        __ATOMIC_ACQUIRE))
-                {
-                    // The pevious value of the event was 0 which means that the
-                    // worker was previously sleeping.
-                    // Wake it via an ocall.
-                    oe_sgx_wake_switchless_worker_ocall(
-                        &_host_worker_contexts[tries]);
-                }
-
-                return OE_OK;
-            }
+            while (!_is_switchless_ocall_done(args))
+                asm volatile("pause");
         }
     }
 
-    result = OE_CONTEXT_SWITCHLESS_OCALL_MISSED;
-
-    return result;
+done:
+    OE_ATOMIC_MEMORY_BARRIER_ACQUIRE();
 }
 
 /*
@@ -248,54 +408,94 @@ oe_result_t oe_switchless_call_host_function(
 }
 
 void oe_sgx_switchless_enclave_worker_thread_ecall(
-    oe_enclave_worker_context_t* context)
+    oe_enclave_worker_context_t* context,
+    oe_switchless_ring_t* ring)
 {
-    // Ensure that the context lies in host memory.
-    if (!oe_is_outside_enclave(context, sizeof(*context)))
+    oe_switchless_ring_slot_t* slots = NULL;
+    uint64_t capacity = 0;
+    uint64_t slots_size = 0;
+
+    // Ensure that the context and the ring lie in host memory.
+    if (!oe_is_outside_enclave(context, sizeof(*context)) ||
+        !oe_is_outside_enclave(ring, sizeof(*ring)))
+        return;
+
+    // Keep the slots and capacity of the ring in enclave memory.
+    slots = ring->slots;
+    capacity = ring->capacity;
+
+    // The capacity must be a power of 2.
+    if (capacity == 0 || (capacity & (capacity - 1)) != 0)
+        return;
+
+    if (oe_safe_mul_u64(sizeof(*slots), capacity, &slots_size) != OE_OK ||
+        !oe_is_outside_enclave(slots, slots_size))
         return;
 
     // Prevent speculative execution.
     oe_lfence();
 
-    const uint64_t spin_count_threshold = context->spin_count_threshold;
+    // The host adjusts the spin count threshold to the calls it sees, so it
+    // is read again whenever the worker spins. Between two looks at the
+    // ring, the worker pauses for exponentially longer.
+    uint64_t pauses = 1;
     while (!context->is_stopping)
     {
-        volatile oe_call_enclave_function_args_t* local_call_arg = NULL;
-        if ((local_call_arg = context->call_arg) != NULL)
+        oe_call_enclave_function_args_t* local_call_arg = NULL;
+        if ((local_call_arg = (oe_call_enclave_function_args_t*)
+                 oe_switchless_ring_pop(ring, slots, capacity - 1)) != NULL)
         {
-            // Handle the switchless call, but do not clear the slot yet. Since
-            // the slot is not empty, any new incoming switchless call request
-            // will be scheduled in another available work thread and get
-            // handled immediately.
-            oe_handle_call_enclave_function((uint64_t)local_call_arg);
-
-            // After handling the switchless call, mark this worker thread
-            // as free by clearing the slot.
-            OE_ATOMIC_MEMORY_BARRIER_RELEASE();
+            // Publish the call being handled for diagnostics.
+            context->call_arg = local_call_arg;
+
+            oe_result_t result =
+                oe_handle_call_enclave_function((uint64_t)local_call_arg);
+
+            // The caller waits for the result to change. A call that was
+            // rejected leaves it untouched, so report the error here, unless
+            // the args themselves were bogus.
+            if (result != OE_OK &&
+                oe_is_outside_enclave(local_call_arg, sizeof(*local_call_arg)))
+            {
+                OE_ATOMIC_MEMORY_BARRIER_RELEASE();
+                local_call_arg->result = result;
+            }
+
             context->call_arg = NULL;
+            context->num_calls++;
 
             // Reset spin count for next message.
             context->total_spin_count += context->spin_count;
             context->spin_count = 0;
+            pauses = 1;
         }
         else
         {
             // If there is no message, increment spin count until threshold is
             // reached.
-            if (++context->spin_count >= spin_count_threshold)
+            context->spin_count += pauses;
+            if (context->spin_count >= context->spin_count_threshold)
             {
                 // Reset spin count and return to host to sleep.
                 context->total_spin_count += context->spin_count;
                 context->spin_count = 0;
 
-                // Make an ocall to sleep until messages arrive.
+                // Make an ocall to sleep until messages arrive. A host worker
+                // must not be held up by the sleep.
+                oe_sgx_get_td()->force_regular_ocalls++;
                 oe_sgx_sleep_switchless_worker_ocall(context);
+                oe_sgx_get_td()->force_regular_ocalls--;
+                pauses = 1;
             }
 
             // In Release builds, the following pause has been observed to be
             // essential. Without it, the worker thread seems to hog the CPU,
             // preventing host threads from posting switchless ecall messages.
-            asm volatile("pause");
+            for (uint64_t i = 0; i < pauses; i++)
+                asm volatile("pause");
+
+            if (pauses < OE_SWITCHLESS_MAX_BACKOFF_PAUSES)
+                pauses *= 2;
         }
     }
 }
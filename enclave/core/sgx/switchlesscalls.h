@@ -8,6 +8,13 @@
 
 bool oe_is_switchless_initialized();
 
+/* Whether to make an ocall declared with the given switchless flag as a
+ * switchless call */
+bool oe_route_ocall(uint64_t function_id, bool switchless);
+
 oe_result_t oe_post_switchless_ocall(oe_call_host_function_args_t* args);
 
+/* Wait until a host worker has completed a posted switchless ocall */
+void oe_wait_switchless_ocall(oe_call_host_function_args_t* args);
+
 #endif // _OE_SWITCHLESSCALLS_H
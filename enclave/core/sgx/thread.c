@@ -30,6 +30,18 @@ static int _thread_wait(oe_sgx_td_t* self)
     return 0;
 }
 
+/* Wait on the calling thread until the deadline in nanoseconds since the
+ * Epoch. Returns 1 if the wait timed out. */
+static int _thread_timed_wait(uint64_t deadline_ns)
+{
+    uint64_t timed_out = 0;
+
+    if (oe_ocall(OE_OCALL_THREAD_TIMED_WAIT, deadline_ns, &timed_out) != OE_OK)
+        return -1;
+
+    return timed_out ? 1 : 0;
+}
+
 static int _thread_wake(oe_sgx_td_t* self)
 {
     const void* tcs = td_to_tcs((oe_sgx_td_t*)self);
@@ -70,6 +82,52 @@ done:
     return ret;
 }
 
+/* Maximum number of threads woken by one batched wake */
+#define OE_THREAD_WAKE_BATCH 32
+
+oe_result_t _oe_sgx_thread_wake_multiple_ocall(
+    oe_enclave_t* enclave,
+    const uint64_t* tcs,
+    size_t tcs_count)
+{
+    OE_UNUSED(enclave);
+    OE_UNUSED(tcs);
+    OE_UNUSED(tcs_count);
+
+    return OE_UNSUPPORTED;
+}
+
+OE_WEAK_ALIAS(
+    _oe_sgx_thread_wake_multiple_ocall,
+    oe_sgx_thread_wake_multiple_ocall);
+
+/* Wake up to OE_THREAD_WAKE_BATCH threads with one enclave exit. Enclaves
+ * that opted out of the batched wake fall back to one exit per thread. */
+static void _thread_wake_multiple(oe_sgx_td_t** threads, size_t count)
+{
+    uint64_t tcs[OE_THREAD_WAKE_BATCH];
+    oe_result_t result;
+
+    if (count <= 1)
+    {
+        if (count)
+            _thread_wake(threads[0]);
+
+        return;
+    }
+
+    for (size_t i = 0; i < count; i++)
+        tcs[i] = (uint64_t)td_to_tcs(threads[i]);
+
+    result = oe_sgx_thread_wake_multiple_ocall(oe_get_enclave(), tcs, count);
+
+    if (result != OE_OK)
+    {
+        for (size_t i = 0; i < count; i++)
+            _thread_wake(threads[i]);
+    }
+}
+
 /*
 **==============================================================================
 **
@@ -111,6 +169,27 @@ static oe_sgx_td_t* _queue_pop_front(Queue* queue)
     return thread;
 }
 
+static void _queue_remove(Queue* queue, oe_sgx_td_t* thread)
+{
+    oe_sgx_td_t* prev = NULL;
+
+    for (oe_sgx_td_t* p = queue->front; p; prev = p, p = p->next)
+    {
+        if (p == thread)
+        {
+            if (prev)
+                prev->next = p->next;
+            else
+                queue->front = p->next;
+
+            if (queue->back == p)
+                queue->back = prev;
+
+            return;
+        }
+    }
+}
+
 static bool _queue_contains(Queue* queue, oe_sgx_td_t* thread)
 {
     oe_sgx_td_t* p;
@@ -155,6 +234,13 @@ bool oe_thread_equal(oe_thread_t thread1, oe_thread_t thread2)
 **==============================================================================
 */
 
+/*
+ * Most times a thread looks at a held mutex before it parks. Parking and
+ * waking take two enclave exits, several microseconds, so a waiter spins at
+ * most about as long as a park would cost.
+ */
+#define OE_MUTEX_MAX_SPINS 1000
+
 /* Internal mutex implementation */
 typedef struct _oe_mutex_impl
 {
@@ -169,6 +255,10 @@ typedef struct _oe_mutex_impl
 
     /* Queue of waiting threads (front holds the mutex) */
     Queue queue;
+
+    /* Average number of spins before waiters got the mutex, which follows
+     * how long the mutex is held */
+    uint32_t spins;
 } oe_mutex_impl_t;
 
 OE_STATIC_ASSERT(sizeof(oe_mutex_impl_t) <= sizeof(oe_mutex_t));
@@ -228,10 +318,63 @@ static int _mutex_lock(oe_mutex_impl_t* m, oe_sgx_td_t* self)
     return -1;
 }
 
+/* Move the average spin count a little towards the given count. Updates
+ * may race; a lost one only skews the estimate. */
+static void _mutex_update_spins(oe_mutex_impl_t* m, uint32_t spins)
+{
+    int32_t delta = (int32_t)spins - (int32_t)m->spins;
+
+    m->spins = (uint32_t)((int32_t)m->spins + delta / 8);
+}
+
+/*
+ * Spin while the mutex is held and no thread is parked on it, trying to get
+ * it once it is released. Waiters spin up to twice the average spin count,
+ * so that a mutex held for short critical sections is waited out without
+ * parking, while a mutex held for long costs at most OE_MUTEX_MAX_SPINS
+ * pauses before the waiter parks. Parked threads get the mutex first, so
+ * spinning stops as soon as one is queued.
+ */
+static bool _mutex_spin(oe_mutex_impl_t* m, oe_sgx_td_t* self)
+{
+    uint32_t max_spins = 2 * m->spins + 10;
+
+    if (max_spins > OE_MUTEX_MAX_SPINS)
+        max_spins = OE_MUTEX_MAX_SPINS;
+
+    for (uint32_t spins = 0; spins < max_spins; spins++)
+    {
+        if (*(oe_sgx_td_t* volatile*)&m->queue.front)
+            break;
+
+        if (!*(oe_sgx_td_t* volatile*)&m->owner)
+        {
+            bool locked;
+
+            oe_spin_lock(&m->lock);
+            {
+                if ((locked = (_mutex_lock(m, self) == 0)))
+                    _mutex_update_spins(m, spins);
+            }
+            oe_spin_unlock(&m->lock);
+
+            if (locked)
+                return true;
+        }
+
+        /* Yield to CPU */
+        asm volatile("pause");
+    }
+
+    _mutex_update_spins(m, max_spins);
+    return false;
+}
+
 oe_result_t oe_mutex_lock(oe_mutex_t* mutex)
 {
     oe_mutex_impl_t* m = (oe_mutex_impl_t*)mutex;
     oe_sgx_td_t* self = oe_sgx_get_td();
+    bool spun = false;
 
     if (!m)
         return OE_INVALID_PARAMETER;
@@ -248,6 +391,19 @@ oe_result_t oe_mutex_lock(oe_mutex_t* mutex)
                 return OE_OK;
             }
 
+            /* Before parking for the first time, wait for a short critical
+             * section to end */
+            if (!spun && _queue_empty(&m->queue))
+            {
+                spun = true;
+                oe_spin_unlock(&m->lock);
+
+                if (_mutex_spin(m, self))
+                    return OE_OK;
+
+                continue;
+            }
+
             /* If the waiters queue does not contain this thread */
             if (!_queue_contains(&m->queue, self))
             {
@@ -417,13 +573,14 @@ oe_result_t oe_cond_destroy(oe_cond_t* condition)
     return OE_OK;
 }
 
-oe_result_t oe_cond_wait(oe_cond_t* condition, oe_mutex_t* mutex)
+/* Wait on the condition until signaled, or until the deadline if any */
+static oe_result_t _cond_wait(
+    oe_cond_impl_t* cond,
+    oe_mutex_t* mutex,
+    const uint64_t* deadline_ns)
 {
-    oe_cond_impl_t* cond = (oe_cond_impl_t*)condition;
     oe_sgx_td_t* self = oe_sgx_get_td();
-
-    if (!cond || !mutex)
-        return OE_INVALID_PARAMETER;
+    oe_result_t result = OE_OK;
 
     oe_spin_lock(&cond->lock);
     {
@@ -435,19 +592,32 @@ oe_result_t oe_cond_wait(oe_cond_t* condition, oe_mutex_t* mutex)
         /* Unlock this mutex and get the waiter at the front of the queue */
         if (_mutex_unlock(mutex, &waiter) != 0)
         {
+            _queue_remove((Queue*)&cond->queue, self);
             oe_spin_unlock(&cond->lock);
             return OE_BUSY;
         }
 
         for (;;)
         {
+            bool timed_out = false;
+
             oe_spin_unlock(&cond->lock);
             {
-                if (waiter)
+                if (waiter && !deadline_ns)
                 {
                     _thread_wake_wait(waiter, self);
                     waiter = NULL;
                 }
+                else if (deadline_ns)
+                {
+                    if (waiter)
+                    {
+                        _thread_wake(waiter);
+                        waiter = NULL;
+                    }
+
+                    timed_out = _thread_timed_wait(*deadline_ns) == 1;
+                }
                 else
                 {
                     _thread_wait(self);
@@ -458,12 +628,43 @@ oe_result_t oe_cond_wait(oe_cond_t* condition, oe_mutex_t* mutex)
             /* If self is no longer in the queue, then it was selected */
             if (!_queue_contains((Queue*)&cond->queue, self))
                 break;
+
+            /* A signal that selected self before this point still counts */
+            if (timed_out)
+            {
+                _queue_remove((Queue*)&cond->queue, self);
+                result = OE_TIMEDOUT;
+                break;
+            }
         }
     }
     oe_spin_unlock(&cond->lock);
     oe_mutex_lock(mutex);
 
-    return OE_OK;
+    return result;
+}
+
+oe_result_t oe_cond_wait(oe_cond_t* condition, oe_mutex_t* mutex)
+{
+    oe_cond_impl_t* cond = (oe_cond_impl_t*)condition;
+
+    if (!cond || !mutex)
+        return OE_INVALID_PARAMETER;
+
+    return _cond_wait(cond, mutex, NULL);
+}
+
+oe_result_t oe_cond_timedwait(
+    oe_cond_t* condition,
+    oe_mutex_t* mutex,
+    uint64_t deadline_ns)
+{
+    oe_cond_impl_t* cond = (oe_cond_impl_t*)condition;
+
+    if (!cond || !mutex)
+        return OE_INVALID_PARAMETER;
+
+    return _cond_wait(cond, mutex, &deadline_ns);
 }
 
 oe_result_t oe_cond_signal(oe_cond_t* condition)
@@ -488,28 +689,36 @@ oe_result_t oe_cond_signal(oe_cond_t* condition)
 oe_result_t oe_cond_broadcast(oe_cond_t* condition)
 {
     oe_cond_impl_t* cond = (oe_cond_impl_t*)condition;
-    Queue waiters = {NULL, NULL};
+    oe_sgx_td_t* waiters[OE_THREAD_WAKE_BATCH];
+    size_t remaining = 0;
 
     if (!cond)
         return OE_INVALID_PARAMETER;
 
+    /* Only wake the threads that are waiting now. Threads that wait again
+     * after an early batch is woken join the back of the queue. */
     oe_spin_lock(&cond->lock);
-    {
-        oe_sgx_td_t* p;
-
-        while ((p = _queue_pop_front((Queue*)&cond->queue)))
-            _queue_push_back(&waiters, p);
-    }
+    for (oe_sgx_td_t* p = cond->queue.front; p; p = p->next)
+        remaining++;
     oe_spin_unlock(&cond->lock);
 
-    oe_sgx_td_t* p_next = NULL;
-    for (oe_sgx_td_t* p = waiters.front; p; p = p_next)
+    while (remaining)
     {
-        // p could wake up and immediately use a synchronization
-        // primitive that could modify the next field.
-        // Therefore fetch the next thread before waking up p.
-        p_next = p->next;
-        _thread_wake(p);
+        size_t count = 0;
+
+        /* Pop the batch under the lock: a waiter whose deadline passes may
+         * return, and reuse its queue link, as soon as it is dequeued */
+        oe_spin_lock(&cond->lock);
+        while (count < OE_THREAD_WAKE_BATCH && count < remaining &&
+               (waiters[count] = _queue_pop_front((Queue*)&cond->queue)))
+            count++;
+        oe_spin_unlock(&cond->lock);
+
+        if (!count)
+            break;
+
+        _thread_wake_multiple(waiters, count);
+        remaining -= count;
     }
 
     return OE_OK;
@@ -520,9 +729,36 @@ oe_result_t oe_cond_broadcast(oe_cond_t* condition)
 **
 ** oe_rwlock_t
 **
+**     While a lock is reader-biased, readers do not write to the lock at all:
+**     each thread publishes the lock it reads in the reader indicator of its
+**     oe_sgx_td_t, then checks that the bias still holds. A writer clears
+**     the bias under the spinlock and waits until no indicator names the
+**     lock. Readers that find the bias cleared, or their indicator in use,
+**     take the spinlock as before. The bias is restored after a run of
+**     reads without writers.
+**
+**     A writer first spins while the readers drain. If some remain, it tags
+**     their indicators and counts them in the lock, then parks; the last
+**     tagged reader to leave wakes it. Untagged readers never wake it.
+**
+**     Writers are preferred: once a writer waits, at most
+**     OE_RWLOCK_READER_BURST more readers join the current ones, so that
+**     overlapping readers cannot starve it. Readers that already hold a read
+**     lock are always let in, since they would otherwise deadlock against
+**     the writer.
+**
 **==============================================================================
 */
 
+/* Reads through the spinlock, without writers, that restore the bias */
+#define OE_RWLOCK_REBIAS_READS 64
+
+/* Pauses a writer spins before parking while readers drain */
+#define OE_RWLOCK_REVOKE_SPINS 1024
+
+/* Readers that may join while a writer waits */
+#define OE_RWLOCK_READER_BURST 32
+
 /* Internal readers-writer lock variable implementation. */
 typedef struct _oe_rwlock_impl
 {
@@ -533,15 +769,211 @@ typedef struct _oe_rwlock_impl
     uint32_t readers;
 
     /* The writer thread that currently owns this lock.*/
-    oe_sgx_td_t* writer;
+    oe_sgx_td_t* volatile writer;
 
     /* Queue of threads waiting on this variable. */
     Queue queue;
 
+    /* Non-zero while readers may use their reader indicators */
+    volatile uint8_t bias;
+
+    /* Non-zero while the writer waits for reader indicators to clear */
+    uint8_t revoking;
+
+    /* Number of writers waiting for the lock */
+    uint16_t writers_waiting;
+
+    /* Reads through the spinlock since the bias was cleared */
+    uint8_t slow_reads;
+
+    /* Readers that joined while a writer waited, up to the burst */
+    uint8_t burst_reads;
+
+    /* Tagged readers the writer revoking the bias still waits for */
+    uint16_t draining;
+
 } oe_rwlock_impl_t;
 
 OE_STATIC_ASSERT(sizeof(oe_rwlock_impl_t) <= sizeof(oe_rwlock_t));
 
+/* Reader indicator of a reader that the revoking writer waits for */
+#define OE_RWLOCK_TAGGED(rw_lock) ((void*)((uintptr_t)(rw_lock) | 1))
+
+/* Threads whose reader indicators writers scan */
+static oe_sgx_td_t* _rwlock_readers;
+static oe_spinlock_t _rwlock_readers_lock = OE_SPINLOCK_INITIALIZER;
+
+static void _rwlock_register_reader(oe_sgx_td_t* self)
+{
+    oe_spin_lock(&_rwlock_readers_lock);
+    self->rwlock_next = _rwlock_readers;
+    __atomic_store_n(&_rwlock_readers, self, __ATOMIC_RELEASE);
+    self->rwlock_registered = 1;
+    oe_spin_unlock(&_rwlock_readers_lock);
+}
+
+/* Clear the reader indicator of self. The last reader tagged by the
+ * revoking writer wakes it. */
+static void _rwlock_clear_reader(oe_rwlock_impl_t* rw_lock, oe_sgx_td_t* self)
+{
+    oe_sgx_td_t* writer;
+
+    if (__atomic_exchange_n(&self->rwlock_reader, NULL, __ATOMIC_SEQ_CST) !=
+        OE_RWLOCK_TAGGED(rw_lock))
+        return;
+
+    /* The writer cannot leave before the count drops to zero */
+    writer = rw_lock->writer;
+
+    if (__atomic_sub_fetch(&rw_lock->draining, 1, __ATOMIC_SEQ_CST) == 0)
+        _thread_wake(writer);
+}
+
+/* Whether td holds the lock for read through its reader indicator */
+static bool _rwlock_is_fast_reader(oe_rwlock_impl_t* rw_lock, oe_sgx_td_t* td)
+{
+    return ((uintptr_t)td->rwlock_reader & ~(uintptr_t)1) ==
+           (uintptr_t)rw_lock;
+}
+
+/* Try to take a read lock through the reader indicator of self */
+static bool _rwlock_fast_rdlock(oe_rwlock_impl_t* rw_lock, oe_sgx_td_t* self)
+{
+    if (!rw_lock->bias || self->rwlock_reader)
+        return false;
+
+    if (!self->rwlock_registered)
+        _rwlock_register_reader(self);
+
+    /* Publish the indicator before checking the bias. Pairs with the fence
+     * in _rwlock_revoke_bias() */
+    self->rwlock_reader = rw_lock;
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    if (rw_lock->bias)
+    {
+        self->rwlock_read_depth++;
+        return true;
+    }
+
+    /* The writer may have tagged the indicator meanwhile */
+    _rwlock_clear_reader(rw_lock, self);
+    return false;
+}
+
+static void _rwlock_fast_rdunlock(oe_rwlock_impl_t* rw_lock, oe_sgx_td_t* self)
+{
+    self->rwlock_read_depth--;
+    _rwlock_clear_reader(rw_lock, self);
+}
+
+/* Clear the bias and wait until no reader indicator names the lock. The
+ * caller owns the lock as writer, so readers cannot publish it again. */
+static void _rwlock_revoke_bias(oe_rwlock_impl_t* rw_lock, oe_sgx_td_t* self)
+{
+    oe_sgx_td_t* readers;
+    size_t spins = 0;
+    bool drained = true;
+
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    readers = __atomic_load_n(&_rwlock_readers, __ATOMIC_ACQUIRE);
+
+    /* Most readers leave while the writer spins */
+    for (oe_sgx_td_t* td = readers; td; td = td->rwlock_next)
+    {
+        while (td->rwlock_reader == rw_lock)
+        {
+            if (spins++ >= OE_RWLOCK_REVOKE_SPINS)
+            {
+                drained = false;
+                break;
+            }
+
+            asm volatile("pause" ::: "memory");
+        }
+    }
+
+    if (drained)
+        return;
+
+    /* Count the remaining readers while tagging them. The extra count keeps
+     * readers that leave meanwhile from dropping it to zero early. */
+    rw_lock->draining = 1;
+
+    for (oe_sgx_td_t* td = readers; td; td = td->rwlock_next)
+    {
+        void* reader = rw_lock;
+
+        __atomic_add_fetch(&rw_lock->draining, 1, __ATOMIC_SEQ_CST);
+
+        if (!__atomic_compare_exchange_n(
+                &td->rwlock_reader,
+                &reader,
+                OE_RWLOCK_TAGGED(rw_lock),
+                false,
+                __ATOMIC_SEQ_CST,
+                __ATOMIC_SEQ_CST))
+            __atomic_sub_fetch(&rw_lock->draining, 1, __ATOMIC_SEQ_CST);
+    }
+
+    /* Otherwise the last tagged reader wakes the writer */
+    if (__atomic_sub_fetch(&rw_lock->draining, 1, __ATOMIC_SEQ_CST) == 0)
+        return;
+
+    do
+    {
+        _thread_wait(self);
+    } while (__atomic_load_n(&rw_lock->draining, __ATOMIC_SEQ_CST));
+}
+
+/* Whether a reader indicator names the lock, after the bias was cleared */
+static bool _rwlock_has_fast_readers(oe_rwlock_impl_t* rw_lock)
+{
+    oe_sgx_td_t* readers;
+
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    readers = __atomic_load_n(&_rwlock_readers, __ATOMIC_ACQUIRE);
+
+    for (oe_sgx_td_t* td = readers; td; td = td->rwlock_next)
+    {
+        if (_rwlock_is_fast_reader(rw_lock, td))
+            return true;
+    }
+
+    return false;
+}
+
+/* Whether self may take the lock for read. Called with the spinlock held. */
+static bool _rwlock_can_read(oe_rwlock_impl_t* rw_lock, oe_sgx_td_t* self)
+{
+    /* Readers keep joining while a writer only revokes the bias */
+    if (rw_lock->writer != NULL && !rw_lock->revoking)
+        return false;
+
+    if (self->rwlock_read_depth || !rw_lock->writers_waiting)
+        return true;
+
+    return rw_lock->burst_reads < OE_RWLOCK_READER_BURST;
+}
+
+/* Count a read through the spinlock. Called with the spinlock held. */
+static void _rwlock_slow_read(oe_rwlock_impl_t* rw_lock, oe_sgx_td_t* self)
+{
+    rw_lock->readers++;
+    self->rwlock_read_depth++;
+
+    if (rw_lock->writers_waiting &&
+        rw_lock->burst_reads < OE_RWLOCK_READER_BURST)
+        rw_lock->burst_reads++;
+
+    if (!rw_lock->bias && !rw_lock->writers_waiting &&
+        ++rw_lock->slow_reads >= OE_RWLOCK_REBIAS_READS)
+    {
+        rw_lock->slow_reads = 0;
+        rw_lock->bias = 1;
+    }
+}
+
 oe_result_t oe_rwlock_init(oe_rwlock_t* read_write_lock)
 {
     oe_rwlock_impl_t* rw_lock = (oe_rwlock_impl_t*)read_write_lock;
@@ -566,11 +998,14 @@ oe_result_t oe_rwlock_rdlock(oe_rwlock_t* read_write_lock)
     if (!rw_lock)
         return OE_INVALID_PARAMETER;
 
+    if (_rwlock_fast_rdlock(rw_lock, self))
+        return OE_OK;
+
     oe_spin_lock(&rw_lock->lock);
 
-    // Wait for writer to finish.
+    // Wait for writers to finish.
     // Multiple readers can concurrently operate.
-    while (rw_lock->writer != NULL)
+    while (!_rwlock_can_read(rw_lock, self))
     {
         // Add self to list of waiters, and go to wait state.
         if (!_queue_contains(&rw_lock->queue, self))
@@ -584,8 +1019,7 @@ oe_result_t oe_rwlock_rdlock(oe_rwlock_t* read_write_lock)
         oe_spin_lock(&rw_lock->lock);
     }
 
-    // Increment number of readers.
-    rw_lock->readers++;
+    _rwlock_slow_read(rw_lock, self);
 
     oe_spin_unlock(&rw_lock->lock);
 
@@ -595,18 +1029,22 @@ oe_result_t oe_rwlock_rdlock(oe_rwlock_t* read_write_lock)
 oe_result_t oe_rwlock_tryrdlock(oe_rwlock_t* read_write_lock)
 {
     oe_rwlock_impl_t* rw_lock = (oe_rwlock_impl_t*)read_write_lock;
+    oe_sgx_td_t* self = oe_sgx_get_td();
 
     if (!rw_lock)
         return OE_INVALID_PARAMETER;
 
+    if (_rwlock_fast_rdlock(rw_lock, self))
+        return OE_OK;
+
     oe_spin_lock(&rw_lock->lock);
 
     oe_result_t result = OE_BUSY;
 
-    // If no writer is active, then lock is successful.
-    if (rw_lock->writer == NULL)
+    // If no writer is active or waiting, then lock is successful.
+    if (_rwlock_can_read(rw_lock, self))
     {
-        rw_lock->readers++;
+        _rwlock_slow_read(rw_lock, self);
         result = OE_OK;
     }
 
@@ -631,10 +1069,20 @@ static oe_result_t _wake_waiters(oe_rwlock_impl_t* rw_lock)
     // ownership of the rw_lock.
     oe_spin_unlock(&rw_lock->lock);
 
-    // Wake the waiters in FIFO order. However actual acquisition of the lock
-    // will be dependent on OS scheduling of the threads.
-    while ((p = _queue_pop_front(&waiters)))
-        _thread_wake(p);
+    // Wake the waiters in FIFO order, in batches that each take a single
+    // enclave exit. However actual acquisition of the lock will be dependent
+    // on OS scheduling of the threads.
+    while (waiters.front)
+    {
+        oe_sgx_td_t* batch[OE_THREAD_WAKE_BATCH];
+        size_t count = 0;
+
+        while (count < OE_THREAD_WAKE_BATCH &&
+               (p = _queue_pop_front(&waiters)))
+            batch[count++] = p;
+
+        _thread_wake_multiple(batch, count);
+    }
 
     return OE_OK;
 }
@@ -649,12 +1097,14 @@ static oe_result_t _rwlock_rdunlock(oe_rwlock_t* read_write_lock)
     oe_spin_lock(&rw_lock->lock);
 
     // There must be at least 1 reader and no writers.
-    if (rw_lock->readers < 1 || rw_lock->writer != NULL)
+    if (rw_lock->readers < 1 || (rw_lock->writer != NULL && !rw_lock->revoking))
     {
         oe_spin_unlock(&rw_lock->lock);
         return OE_NOT_OWNER;
     }
 
+    oe_sgx_get_td()->rwlock_read_depth--;
+
     if (--rw_lock->readers == 0)
     {
         // This is the last reader. Wake up all waiting threads.
@@ -683,23 +1133,53 @@ oe_result_t oe_rwlock_wrlock(oe_rwlock_t* read_write_lock)
         return OE_BUSY;
     }
 
-    // Wait for all readers and any other writer to finish.
-    while (rw_lock->readers > 0 || rw_lock->writer != NULL)
+    // Wait for all readers and any other writer to finish. New readers wait
+    // behind this writer.
+    rw_lock->writers_waiting++;
+
+    for (;;)
     {
-        // Add self to list of waiters, and go to wait state.
-        if (!_queue_contains(&rw_lock->queue, self))
-            _queue_push_back(&rw_lock->queue, self);
+        while (rw_lock->readers > 0 || rw_lock->writer != NULL)
+        {
+            // Add self to list of waiters, and go to wait state.
+            if (!_queue_contains(&rw_lock->queue, self))
+                _queue_push_back(&rw_lock->queue, self);
+
+            oe_spin_unlock(&rw_lock->lock);
+
+            _thread_wait(self);
+
+            // Upon waking, re-acquire the lock.
+            // Just like a condition variable.
+            oe_spin_lock(&rw_lock->lock);
+        }
+
+        rw_lock->writer = self;
+
+        if (!rw_lock->bias)
+            break;
 
+        // Wait for readers that hold the lock through their indicators.
+        // Readers that come meanwhile take the spinlock and may still join.
+        rw_lock->bias = 0;
+        rw_lock->slow_reads = 0;
+        rw_lock->revoking = 1;
         oe_spin_unlock(&rw_lock->lock);
 
-        _thread_wait(self);
+        _rwlock_revoke_bias(rw_lock, self);
 
-        // Upon waking, re-acquire the lock.
-        // Just like a condition variable.
         oe_spin_lock(&rw_lock->lock);
+        rw_lock->revoking = 0;
+
+        if (rw_lock->readers == 0)
+            break;
+
+        // Wait for the readers that joined, as above.
+        rw_lock->writer = NULL;
     }
 
-    rw_lock->writer = self;
+    rw_lock->writers_waiting--;
+    rw_lock->burst_reads = 0;
     oe_spin_unlock(&rw_lock->lock);
 
     return OE_OK;
@@ -721,6 +1201,25 @@ oe_result_t oe_rwlock_trywrlock(oe_rwlock_t* read_write_lock)
     {
         rw_lock->writer = self;
         result = OE_OK;
+
+        // Fail rather than wait for readers that hold the lock through their
+        // indicators. The bias is restored so that a later writer still waits
+        // for them.
+        if (rw_lock->bias)
+        {
+            rw_lock->bias = 0;
+
+            if (_rwlock_has_fast_readers(rw_lock))
+            {
+                rw_lock->bias = 1;
+                rw_lock->writer = NULL;
+                result = OE_BUSY;
+            }
+            else
+            {
+                rw_lock->slow_reads = 0;
+            }
+        }
     }
 
     oe_spin_unlock(&rw_lock->lock);
@@ -775,6 +1274,19 @@ oe_result_t oe_rwlock_destroy(oe_rwlock_t* read_write_lock)
         return OE_BUSY;
     }
 
+    // Nor any readers holding it through their indicators.
+    if (rw_lock->bias)
+    {
+        rw_lock->bias = 0;
+
+        if (_rwlock_has_fast_readers(rw_lock))
+        {
+            rw_lock->bias = 1;
+            oe_spin_unlock(&rw_lock->lock);
+            return OE_BUSY;
+        }
+    }
+
     oe_spin_unlock(&rw_lock->lock);
 
     return OE_OK;
@@ -790,13 +1302,220 @@ oe_result_t oe_rwlock_unlock(oe_rwlock_t* read_write_lock)
         return OE_INVALID_PARAMETER;
 
     // If the current thread is the writer that owns the lock, then call
-    // oe_rwlock_wrunlock. Call oe_rwlock_rdunlock otherwise. No locking is
-    // necessary here since the condition is expected to be true only when the
-    // current thread is the writer thread.
+    // oe_rwlock_wrunlock. If it holds the lock through its reader indicator,
+    // clear the indicator. Call oe_rwlock_rdunlock otherwise. No locking is
+    // necessary here since the conditions are expected to be true only for
+    // the current thread.
     if (rw_lock->writer == self)
         return _rwlock_wrunlock(read_write_lock);
+
+    if (_rwlock_is_fast_reader(rw_lock, self))
+    {
+        _rwlock_fast_rdunlock(rw_lock, self);
+        return OE_OK;
+    }
+
+    return _rwlock_rdunlock(read_write_lock);
+}
+
+/*
+**==============================================================================
+**
+** Futex:
+**
+**     Waiters on a futex word are kept in a table of buckets keyed by the
+**     address of the word. A waiter checks the word under the bucket lock
+**     before it queues itself, and a waker changes the word before it takes
+**     the same lock, so a wake cannot slip in between the check and the park.
+**     Waiters park on the host event of their TCS, which keeps a pending
+**     wake, so a wake that arrives before the waiter parks is not lost.
+**
+**==============================================================================
+*/
+
+#define OE_FUTEX_BUCKETS 64
+
+typedef struct _oe_futex_waiter
+{
+    struct _oe_futex_waiter* next;
+    volatile int32_t* addr;
+    uint32_t bitset;
+    oe_sgx_td_t* thread;
+
+    /* Set under the bucket lock once a waker has removed this waiter */
+    bool woken;
+} oe_futex_waiter_t;
+
+typedef struct _oe_futex_bucket
+{
+    oe_spinlock_t lock;
+    oe_futex_waiter_t* front;
+    oe_futex_waiter_t* back;
+} oe_futex_bucket_t;
+
+static oe_futex_bucket_t _futex_buckets[OE_FUTEX_BUCKETS];
+
+static oe_futex_bucket_t* _futex_bucket(volatile int32_t* addr)
+{
+    uint64_t key = (uint64_t)addr >> 2;
+
+    return &_futex_buckets[(key ^ (key >> 6)) % OE_FUTEX_BUCKETS];
+}
+
+static void _futex_remove(
+    oe_futex_bucket_t* bucket,
+    oe_futex_waiter_t* waiter,
+    oe_futex_waiter_t* prev)
+{
+    if (prev)
+        prev->next = waiter->next;
     else
-        return _rwlock_rdunlock(read_write_lock);
+        bucket->front = waiter->next;
+
+    if (bucket->back == waiter)
+        bucket->back = prev;
+}
+
+oe_result_t oe_futex_wait(
+    volatile int32_t* addr,
+    int32_t value,
+    uint32_t bitset,
+    uint64_t deadline_ns)
+{
+    oe_futex_bucket_t* bucket;
+    oe_futex_waiter_t waiter;
+    oe_result_t result = OE_OK;
+
+    if (!addr || ((uint64_t)addr & 3) || !bitset)
+        return OE_INVALID_PARAMETER;
+
+    bucket = _futex_bucket(addr);
+
+    waiter.next = NULL;
+    waiter.addr = addr;
+    waiter.bitset = bitset;
+    waiter.thread = oe_sgx_get_td();
+    waiter.woken = false;
+
+    oe_spin_lock(&bucket->lock);
+    {
+        if (*addr != value)
+        {
+            oe_spin_unlock(&bucket->lock);
+            return OE_BUSY;
+        }
+
+        if (bucket->back)
+            bucket->back->next = &waiter;
+        else
+            bucket->front = &waiter;
+
+        bucket->back = &waiter;
+
+        for (;;)
+        {
+            bool timed_out = false;
+
+            oe_spin_unlock(&bucket->lock);
+            {
+                if (deadline_ns == OE_UINT64_MAX)
+                    _thread_wait(waiter.thread);
+                else
+                    timed_out = _thread_timed_wait(deadline_ns) == 1;
+            }
+            oe_spin_lock(&bucket->lock);
+
+            if (waiter.woken)
+                break;
+
+            /* A wake that removed this waiter before this point still counts */
+            if (timed_out)
+            {
+                oe_futex_waiter_t* prev = NULL;
+
+                for (oe_futex_waiter_t* p = bucket->front; p; p = p->next)
+                {
+                    if (p == &waiter)
+                        break;
+
+                    prev = p;
+                }
+
+                _futex_remove(bucket, &waiter, prev);
+                result = OE_TIMEDOUT;
+                break;
+            }
+        }
+    }
+    oe_spin_unlock(&bucket->lock);
+
+    return result;
+}
+
+oe_result_t oe_futex_wake(
+    volatile int32_t* addr,
+    uint32_t count,
+    uint32_t bitset,
+    uint32_t* num_woken)
+{
+    oe_futex_bucket_t* bucket;
+    uint32_t woken = 0;
+
+    if (num_woken)
+        *num_woken = 0;
+
+    if (!addr || ((uint64_t)addr & 3) || !bitset)
+        return OE_INVALID_PARAMETER;
+
+    bucket = _futex_bucket(addr);
+
+    /* Wake a batch per pass, since the host wake must not be made under the
+     * bucket lock. A woken waiter may return as soon as it is marked, so
+     * only its thread is used after the lock is dropped. */
+    while (woken < count)
+    {
+        oe_sgx_td_t* threads[OE_THREAD_WAKE_BATCH];
+        size_t batch = 0;
+
+        oe_spin_lock(&bucket->lock);
+        {
+            oe_futex_waiter_t* prev = NULL;
+            oe_futex_waiter_t* next;
+
+            for (oe_futex_waiter_t* p = bucket->front; p; p = next)
+            {
+                next = p->next;
+
+                if (batch == OE_THREAD_WAKE_BATCH || woken + batch == count)
+                    break;
+
+                if (p->addr == addr && (p->bitset & bitset))
+                {
+                    _futex_remove(bucket, p, prev);
+                    threads[batch++] = p->thread;
+                    p->woken = true;
+                    continue;
+                }
+
+                prev = p;
+            }
+        }
+        oe_spin_unlock(&bucket->lock);
+
+        if (!batch)
+            break;
+
+        _thread_wake_multiple(threads, batch);
+        woken += (uint32_t)batch;
+
+        if (batch < OE_THREAD_WAKE_BATCH)
+            break;
+    }
+
+    if (num_woken)
+        *num_woken = woken;
+
+    return OE_OK;
 }
 
 /*
@@ -3,6 +3,7 @@
 
 #include <openenclave/host.h>
 #include <openenclave/internal/raise.h>
+#include <stdlib.h>
 
 #include "calls.h"
 #include "ecall_ids.h"
@@ -109,3 +110,85 @@ oe_result_t oe_call_enclave_function(
 done:
     return result;
 }
+
+/*
+**==============================================================================
+**
+** oe_call_enclave_function_batch()
+**
+** Call several enclave functions with a single OE_ECALL_CALL_ENCLAVE_FUNCTION_BATCH
+** ecall.
+**
+**==============================================================================
+*/
+
+oe_result_t oe_call_enclave_function_batch(
+    oe_enclave_t* enclave,
+    oe_enclave_function_call_t* calls,
+    size_t num_calls)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_call_enclave_function_args_t* args = NULL;
+    oe_call_enclave_function_batch_args_t batch;
+
+    /* Reject invalid parameters */
+    if (!enclave || (!calls && num_calls))
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    if (num_calls == 0)
+    {
+        result = OE_OK;
+        goto done;
+    }
+
+    if (!(args = (oe_call_enclave_function_args_t*)calloc(
+              num_calls, sizeof(oe_call_enclave_function_args_t))))
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    /* Initialize the call_enclave_args structure of each call */
+    for (size_t i = 0; i < num_calls; i++)
+    {
+        calls[i].output_bytes_written = 0;
+        calls[i].result = OE_UNEXPECTED;
+
+        OE_CHECK(oe_get_ecall_ids(
+            enclave, calls[i].name, calls[i].global_id, &args[i].function_id));
+
+        args[i].input_buffer = calls[i].input_buffer;
+        args[i].input_buffer_size = calls[i].input_buffer_size;
+        args[i].output_buffer = calls[i].output_buffer;
+        args[i].output_buffer_size = calls[i].output_buffer_size;
+        args[i].output_bytes_written = 0;
+        args[i].result = OE_UNEXPECTED;
+    }
+
+    batch.calls = args;
+    batch.num_calls = num_calls;
+
+    /* Perform the ECALL */
+    {
+        uint64_t arg_out = 0;
+
+        OE_CHECK(oe_ecall(
+            enclave,
+            OE_ECALL_CALL_ENCLAVE_FUNCTION_BATCH,
+            (uint64_t)&batch,
+            &arg_out));
+        OE_CHECK((oe_result_t)arg_out);
+    }
+
+    /* Report the result of each call */
+    for (size_t i = 0; i < num_calls; i++)
+    {
+        calls[i].result = args[i].result;
+
+        if (args[i].result == OE_OK)
+            calls[i].output_bytes_written = args[i].output_bytes_written;
+    }
+
+    result = OE_OK;
+
+done:
+    free(args);
+    return result;
+}
@@ -15,6 +15,9 @@ typedef struct _ocall_table
     size_t num_ocalls;
 } ocall_table_t;
 
-oe_result_t oe_handle_call_host_function(uint64_t arg, oe_enclave_t* enclave);
+oe_result_t oe_handle_call_host_function(
+    uint64_t arg,
+    oe_enclave_t* enclave,
+    bool switchless);
 
 #endif /* OE_HOST_CALLS_H */
@@ -102,6 +102,16 @@ oe_thread_t oe_thread_self(void);
  */
 int oe_thread_equal(oe_thread_t thread1, oe_thread_t thread2);
 
+/**
+ * Restricts a thread to one CPU.
+ *
+ * @param thread A thread created with oe_thread_create().
+ * @param cpu The index of the CPU to run the thread on.
+ *
+ * @returns Returns zero on success.
+ */
+int oe_thread_set_affinity(oe_thread_t thread, uint32_t cpu);
+
 /**
  * Calls the given function exactly once.
  *
@@ -243,6 +253,33 @@ int oe_thread_setspecific(oe_thread_key key, void* value);
  */
 void* oe_thread_getspecific(oe_thread_key key);
 
+/**
+ * Waits for a wake-up on an address.
+ *
+ * This function blocks the calling thread while the 32-bit value at **addr**
+ * equals **expected**, until another thread calls oe_thread_wake_address()
+ * on the same address or the timeout elapses. Like a futex, it may return
+ * spuriously, so callers re-check the value in a loop.
+ *
+ * @param addr The address to wait on.
+ * @param expected Only block if the value at **addr** equals this value.
+ * @param timeout_ns Relative timeout in nanoseconds, or OE_UINT64_MAX to wait
+ *        indefinitely.
+ *
+ * @return Returns non-zero if the timeout elapsed and zero otherwise.
+ */
+int oe_thread_wait_address(
+    volatile uint32_t* addr,
+    uint32_t expected,
+    uint64_t timeout_ns);
+
+/**
+ * Wakes one thread waiting in oe_thread_wait_address() on an address.
+ *
+ * @param addr The address to wake a waiter on.
+ */
+void oe_thread_wake_address(volatile uint32_t* addr);
+
 OE_EXTERNC_END
 
 #endif /* _HOSTTHREAD_H */
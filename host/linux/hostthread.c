@@ -3,8 +3,14 @@
 
 #include "../hostthread.h"
 #include <assert.h>
+#include <errno.h>
+#include <linux/futex.h>
 #include <openenclave/host.h>
 #include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
 
 /*
 **==============================================================================
@@ -33,6 +39,18 @@ int oe_thread_equal(oe_thread_t thread1, oe_thread_t thread2)
     return pthread_equal((pthread_t)thread1, (pthread_t)thread2);
 }
 
+int oe_thread_set_affinity(oe_thread_t thread, uint32_t cpu)
+{
+    cpu_set_t set;
+
+    if (cpu >= CPU_SETSIZE)
+        return EINVAL;
+
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np((pthread_t)thread, sizeof(set), &set);
+}
+
 /*
 **==============================================================================
 **
@@ -109,3 +127,45 @@ void* oe_thread_getspecific(oe_thread_key key)
 {
     return pthread_getspecific(key);
 }
+
+/*
+**==============================================================================
+**
+** oe_thread_wait_address/oe_thread_wake_address
+**
+**==============================================================================
+*/
+
+int oe_thread_wait_address(
+    volatile uint32_t* addr,
+    uint32_t expected,
+    uint64_t timeout_ns)
+{
+    struct timespec ts;
+    struct timespec* timeout = NULL;
+
+    if (timeout_ns != OE_UINT64_MAX)
+    {
+        ts.tv_sec = (time_t)(timeout_ns / 1000000000UL);
+        ts.tv_nsec = (long)(timeout_ns % 1000000000UL);
+        timeout = &ts;
+    }
+
+    if (syscall(
+            __NR_futex,
+            addr,
+            FUTEX_WAIT_PRIVATE,
+            expected,
+            timeout,
+            NULL,
+            0) == -1 &&
+        errno == ETIMEDOUT)
+        return 1;
+
+    return 0;
+}
+
+void oe_thread_wake_address(volatile uint32_t* addr)
+{
+    syscall(__NR_futex, addr, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
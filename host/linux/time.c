@@ -22,6 +22,17 @@ static uint64_t _time()
            ((uint64_t)ts.tv_nsec / _MSEC_TO_NSEC);
 }
 
+uint64_t oe_get_monotonic_time_ns(void)
+{
+    struct timespec ts;
+
+    if (clock_gettime(CLOCK_MONOTONIC, &ts) != 0)
+        return 0;
+
+    return ((uint64_t)ts.tv_sec * _SEC_TO_MSEC * _MSEC_TO_NSEC) +
+           (uint64_t)ts.tv_nsec;
+}
+
 void oe_handle_get_time(uint64_t arg_in, uint64_t* arg_out)
 {
     OE_UNUSED(arg_in);
@@ -538,6 +538,25 @@ oe_result_t oe_ecall(
         result = _handle_call_enclave_function(
             enclave, (oe_call_enclave_function_args_t*)arg_in);
     }
+    else if (func == OE_ECALL_CALL_ENCLAVE_FUNCTION_BATCH)
+    {
+        /* A TEEC operation carries a single call, so a batch is issued as
+         * one invocation per call */
+        oe_call_enclave_function_batch_args_t* batch =
+            (oe_call_enclave_function_batch_args_t*)arg_in;
+
+        for (size_t i = 0; i < batch->num_calls; i++)
+        {
+            oe_call_enclave_function_args_t* args = &batch->calls[i];
+            oe_result_t call_result =
+                _handle_call_enclave_function(enclave, args);
+
+            if (call_result != OE_OK)
+                args->result = call_result;
+        }
+
+        result = OE_OK;
+    }
     else
     {
         result = _handle_call_builtin_function(enclave, func, arg_in, arg_out);
@@ -28,13 +28,16 @@
 #include <openenclave/internal/safemath.h>
 #include <openenclave/internal/sgx/td.h>
 #include <openenclave/internal/switchless.h>
+#include <openenclave/internal/time.h>
 #include <openenclave/internal/utils.h>
 #include "../calls.h"
 #include "../hostthread.h"
 #include "../ocalls/ocalls.h"
 #include "asmdefs.h"
+#include "callstats.h"
 #include "enclave.h"
 #include "ocalls/ocalls.h"
+#include "waitqueue.h"
 
 /*
 **==============================================================================
@@ -216,13 +219,19 @@ done:
 **==============================================================================
 */
 
-oe_result_t oe_handle_call_host_function(uint64_t arg, oe_enclave_t* enclave)
+oe_result_t oe_handle_call_host_function(
+    uint64_t arg,
+    oe_enclave_t* enclave,
+    bool switchless)
 {
     oe_call_host_function_args_t* args_ptr = NULL;
     oe_result_t result = OE_OK;
     oe_ocall_func_t func = NULL;
     size_t buffer_size = 0;
     ocall_table_t ocall_table;
+    bool timed = false;
+    uint64_t start = 0;
+    uint64_t time_ns;
 
     args_ptr = (oe_call_host_function_args_t*)arg;
     if (args_ptr == NULL)
@@ -258,7 +267,14 @@ oe_result_t oe_handle_call_host_function(uint64_t arg, oe_enclave_t* enclave)
     if ((args_ptr->output_buffer_size % OE_EDGER8R_BUFFER_ALIGNMENT) != 0)
         OE_RAISE(OE_INVALID_PARAMETER);
 
+    // Only time the function for the statistics or an automatic route.
+    timed = oe_call_statistics_enabled(enclave) ||
+            oe_is_ocall_route_auto(enclave, args_ptr->function_id);
+
     // Call the function.
+    if (timed)
+        start = oe_get_monotonic_time_ns();
+
     func(
         args_ptr->input_buffer,
         args_ptr->input_buffer_size,
@@ -266,6 +282,13 @@ oe_result_t oe_handle_call_host_function(uint64_t arg, oe_enclave_t* enclave)
         args_ptr->output_buffer_size,
         &args_ptr->output_bytes_written);
 
+    if (timed)
+    {
+        time_ns = oe_get_monotonic_time_ns() - start;
+        oe_record_ocall(enclave, args_ptr, time_ns, switchless);
+        oe_update_ocall_route(enclave, args_ptr->function_id, time_ns);
+    }
+
     // The ocall succeeded.
     OE_ATOMIC_MEMORY_BARRIER_RELEASE();
     args_ptr->result = OE_OK;
@@ -285,7 +308,9 @@ static const char* oe_ocall_str(oe_func_t ocall)
         "THREAD_WAIT",
         "MALLOC",
         "FREE",
-        "GET_TIME"
+        "GET_TIME",
+        "FLUSH_DEFERRED_OCALLS",
+        "THREAD_TIMED_WAIT"
     };
     // clang-format on
 
@@ -305,7 +330,8 @@ static const char* oe_ecall_str(oe_func_t ecall)
         "DESTRUCTOR",
         "INIT_ENCLAVE",
         "CALL_ENCLAVE_FUNCTION",
-        "VIRTUAL_EXCEPTION_HANDLER"
+        "VIRTUAL_EXCEPTION_HANDLER",
+        "CALL_ENCLAVE_FUNCTION_BATCH"
     };
     // clang-format on
 
@@ -353,7 +379,7 @@ static oe_result_t _handle_ocall(
     switch ((oe_func_t)func)
     {
         case OE_OCALL_CALL_HOST_FUNCTION:
-            OE_CHECK(oe_handle_call_host_function(arg_in, enclave));
+            OE_CHECK(oe_handle_call_host_function(arg_in, enclave, false));
             break;
 
         case OE_OCALL_MALLOC:
@@ -372,10 +398,18 @@ static oe_result_t _handle_ocall(
             HandleThreadWake(enclave, arg_in);
             break;
 
+        case OE_OCALL_THREAD_TIMED_WAIT:
+            HandleThreadTimedWait(enclave, arg_in, arg_out);
+            break;
+
         case OE_OCALL_GET_TIME:
             oe_handle_get_time(arg_in, arg_out);
             break;
 
+        case OE_OCALL_FLUSH_DEFERRED_OCALLS:
+            /* The queue was dispatched by __oe_dispatch_ocall() */
+            break;
+
         default:
         {
             /* No function found with the number */
@@ -390,6 +424,92 @@ done:
     return result;
 }
 
+/*
+**==============================================================================
+**
+** _dispatch_deferred_ocalls()
+**
+**     Run the one-way ocalls that the enclave queued on this binding, in the
+**     order they were queued. A queued ocall may call back into the enclave,
+**     which may queue more ocalls; those are picked up by the same loop.
+**     Failures are not reported, since the enclave no longer waits for them.
+**
+**==============================================================================
+*/
+
+static void _dispatch_deferred_ocalls(
+    oe_enclave_t* enclave,
+    oe_thread_binding_t* binding)
+{
+    oe_deferred_ocall_queue_t* queue;
+    uint64_t offset = 0;
+
+    if (!binding || binding->enclave != enclave)
+        return;
+
+    queue = &binding->deferred_ocalls;
+
+    if (!queue->count || binding->dispatching_deferred_ocalls)
+        return;
+
+    binding->dispatching_deferred_ocalls = 1;
+
+    while (offset < queue->size && queue->size <= queue->capacity)
+    {
+        oe_deferred_ocall_t* ocall =
+            (oe_deferred_ocall_t*)(queue->buffer + offset);
+        oe_call_host_function_args_t args;
+        uint64_t end;
+
+        if (queue->size - offset < sizeof(*ocall) ||
+            oe_safe_add_u64(
+                ocall->input_buffer_size, ocall->output_buffer_size, &end) ||
+            end > queue->size - offset - sizeof(*ocall))
+            break;
+
+        args.function_id = ocall->function_id;
+        args.input_buffer = ocall + 1;
+        args.input_buffer_size = ocall->input_buffer_size;
+        args.output_buffer = (uint8_t*)(ocall + 1) + ocall->input_buffer_size;
+        args.output_buffer_size = ocall->output_buffer_size;
+        args.output_bytes_written = 0;
+        args.result = OE_UNEXPECTED;
+
+        memset(args.output_buffer, 0, args.output_buffer_size);
+        oe_handle_call_host_function((uint64_t)&args, enclave, false);
+
+        offset += sizeof(*ocall) + end;
+    }
+
+    queue->size = 0;
+    queue->count = 0;
+    binding->dispatching_deferred_ocalls = 0;
+}
+
+/*
+**==============================================================================
+**
+** _discard_deferred_ocalls()
+**
+**     Drop the ocalls queued on the binding of an ecall that did not return
+**     with ERET. Their inputs may refer to a state the enclave abandoned, so
+**     they must not run with the next ecall on the binding.
+**
+**==============================================================================
+*/
+
+static void _discard_deferred_ocalls(oe_enclave_t* enclave, void* tcs)
+{
+    oe_thread_binding_t* binding =
+        oe_find_thread_binding(enclave, (uint64_t)tcs);
+
+    if (!binding || binding->dispatching_deferred_ocalls)
+        return;
+
+    binding->deferred_ocalls.size = 0;
+    binding->deferred_ocalls.count = 0;
+}
+
 /*
 **==============================================================================
 **
@@ -434,6 +554,9 @@ int __oe_dispatch_ocall(
         oe_thread_binding_t* binding = oe_get_thread_binding();
         uint64_t arg_out = 0;
 
+        // Ocalls queued before this one run first.
+        _dispatch_deferred_ocalls(enclave, binding);
+
         oe_result_t result = _handle_ocall(enclave, tcs, func, arg, &arg_out);
         *arg1_out = oe_make_call_arg1(OE_CODE_ORET, func, 0, result);
         *arg2_out = arg_out;
@@ -447,6 +570,44 @@ int __oe_dispatch_ocall(
     return 1;
 }
 
+/*
+**==============================================================================
+**
+** _find_owned_binding()
+**
+**     Find the busy binding of the given enclave owned by the calling thread.
+**     The binding cached in thread-specific data is checked first; a scan is
+**     only needed when the thread re-enters this enclave from an ocall made
+**     by another enclave. The scan needs no lock since only the owning
+**     thread ever stores its own id into binding->thread.
+**
+**==============================================================================
+*/
+
+static oe_thread_binding_t* _find_owned_binding(
+    oe_enclave_t* enclave,
+    oe_thread_t thread)
+{
+    oe_thread_binding_t* binding = oe_get_thread_binding();
+
+    /* No binding in TSD means the thread is not inside any enclave */
+    if (!binding)
+        return NULL;
+
+    if (binding->enclave == enclave && binding->thread == thread)
+        return binding;
+
+    for (size_t i = 0; i < enclave->num_bindings; i++)
+    {
+        binding = &enclave->bindings[i];
+
+        if (*(volatile oe_thread_t*)&binding->thread == thread)
+            return binding;
+    }
+
+    return NULL;
+}
+
 /*
 **==============================================================================
 **
@@ -457,8 +618,9 @@ int __oe_dispatch_ocall(
 **         - an enclave thread context
 **
 **     If such a binding already exists, the binding's count in incremented.
-**     Else, the calling host thread is bound to the first available enclave
-**     thread context.
+**     Else, the calling host thread is bound to an idle enclave thread
+**     context taken from the free list. If none is idle and the enclave was
+**     created with a thread wait queue, the caller waits for one.
 **
 **     Returns the address of the thread control structure (TCS) corresponding
 **     to the enclave thread context.
@@ -468,61 +630,35 @@ int __oe_dispatch_ocall(
 
 static void* _assign_tcs(oe_enclave_t* enclave)
 {
-    void* tcs = NULL;
-    size_t i;
     oe_thread_t thread = oe_thread_self();
+    oe_thread_binding_t* binding;
 
-    oe_mutex_lock(&enclave->lock);
+    /* First attempt to find a busy binding owned by this thread */
+    if ((binding = _find_owned_binding(enclave, thread)))
     {
-        /* First attempt to find a busy oe_sgx_td_t owned by this thread */
-        for (i = 0; i < enclave->num_bindings; i++)
-        {
-            oe_thread_binding_t* binding = &enclave->bindings[i];
-
-            if ((binding->flags & _OE_THREAD_BUSY) && binding->thread == thread)
-            {
-                binding->count++;
-                tcs = (void*)binding->tcs;
-
-                /* Notify the debugger runtime */
-                if (enclave->debug && enclave->debug_enclave != NULL)
-                    oe_debug_push_thread_binding(
-                        enclave->debug_enclave, (sgx_tcs_t*)tcs);
-                break;
-            }
-        }
+        binding->count++;
+    }
+    else
+    {
+        /* Else take an available binding, waiting for one if configured */
+        if (!(binding = oe_acquire_thread_binding(enclave)))
+            return NULL;
 
-        /* If binding not found above, look for an available ThreadBinding */
-        if (!tcs)
-        {
-            for (i = 0; i < enclave->num_bindings; i++)
-            {
-                oe_thread_binding_t* binding = &enclave->bindings[i];
-
-                if (!(binding->flags & _OE_THREAD_BUSY))
-                {
-                    binding->flags |= _OE_THREAD_BUSY;
-                    binding->thread = thread;
-                    binding->count = 1;
-
-                    tcs = (void*)binding->tcs;
-
-                    /* Set into TSD so asynchronous exceptions can get it */
-                    _set_thread_binding(binding);
-                    assert(oe_get_thread_binding() == binding);
-
-                    /* Notify the debugger runtime */
-                    if (enclave->debug && enclave->debug_enclave != NULL)
-                        oe_debug_push_thread_binding(
-                            enclave->debug_enclave, (sgx_tcs_t*)tcs);
-                    break;
-                }
-            }
-        }
+        binding->flags |= _OE_THREAD_BUSY;
+        binding->thread = thread;
+        binding->count = 1;
     }
-    oe_mutex_unlock(&enclave->lock);
 
-    return tcs;
+    /* Set into TSD so asynchronous exceptions can get it */
+    _set_thread_binding(binding);
+    assert(oe_get_thread_binding() == binding);
+
+    /* Notify the debugger runtime */
+    if (enclave->debug && enclave->debug_enclave != NULL)
+        oe_debug_push_thread_binding(
+            enclave->debug_enclave, (sgx_tcs_t*)binding->tcs);
+
+    return (void*)binding->tcs;
 }
 
 /*
@@ -531,43 +667,37 @@ static void* _assign_tcs(oe_enclave_t* enclave)
 ** _release_tcs()
 **
 **     Decrement the ThreadBinding.count field of the binding associated with
-**     the given TCS. If the field becomes zero, the binding is dissolved.
+**     the given TCS. If the field becomes zero, the binding is dissolved and
+**     returned to the free list. The caller restores the thread-specific
+**     binding that was in effect before _assign_tcs().
 **
 **==============================================================================
 */
 
 static void _release_tcs(oe_enclave_t* enclave, void* tcs)
 {
-    size_t i;
+    oe_thread_binding_t* binding =
+        oe_find_thread_binding(enclave, (uint64_t)tcs);
 
-    oe_mutex_lock(&enclave->lock);
+    if (!binding || !(binding->flags & _OE_THREAD_BUSY))
+        return;
+
+    /* Notify the debugger runtime */
+    if (enclave->debug && enclave->debug_enclave != NULL)
+        oe_debug_pop_thread_binding();
+
+    if (--binding->count == 0)
     {
-        for (i = 0; i < enclave->num_bindings; i++)
-        {
-            oe_thread_binding_t* binding = &enclave->bindings[i];
-
-            if ((binding->flags & _OE_THREAD_BUSY) &&
-                (void*)binding->tcs == tcs)
-            {
-                binding->count--;
-
-                /* Notify the debugger runtime */
-                if (enclave->debug && enclave->debug_enclave != NULL)
-                    oe_debug_pop_thread_binding();
-
-                if (binding->count == 0)
-                {
-                    binding->flags &= (~_OE_THREAD_BUSY);
-                    binding->thread = 0;
-                    memset(&binding->event, 0, sizeof(binding->event));
-                    _set_thread_binding(NULL);
-                    assert(oe_get_thread_binding() == NULL);
-                }
-                break;
-            }
-        }
+        binding->flags &= (~_OE_THREAD_BUSY);
+        binding->thread = 0;
+#if defined(__linux__)
+        /* The Windows event handle lives as long as the binding */
+        binding->event.value = 0;
+#endif
+
+        /* The CAS in the push publishes the stores above */
+        oe_release_thread_binding(enclave, binding);
     }
-    oe_mutex_unlock(&enclave->lock);
 }
 
 /*
@@ -593,6 +723,9 @@ oe_result_t oe_ecall(
     uint16_t func_out = 0;
     uint16_t result_out = 0;
     uint64_t arg_out = 0;
+    oe_thread_binding_t* previous_binding = oe_get_thread_binding();
+    uint64_t start;
+    bool returned = false;
 
     if (!enclave)
         OE_RAISE(OE_INVALID_PARAMETER);
@@ -610,6 +743,8 @@ oe_result_t oe_ecall(
         oe_ecall_str(func));
 
     /* Perform ECALL or ORET */
+    start =
+        oe_call_statistics_enabled(enclave) ? oe_get_monotonic_time_ns() : 0;
     OE_CHECK(_do_eenter(
         enclave,
         tcs,
@@ -626,6 +761,23 @@ oe_result_t oe_ecall(
     if (code_out != OE_CODE_ERET)
         OE_RAISE(OE_UNEXPECTED);
 
+    /* Statistics enabled during the ecall start with the next one */
+    if (start && func == OE_ECALL_CALL_ENCLAVE_FUNCTION)
+        oe_record_ecall(
+            enclave,
+            (oe_call_enclave_function_args_t*)arg,
+            oe_get_monotonic_time_ns() - start,
+            false);
+    else if (start && func == OE_ECALL_CALL_ENCLAVE_FUNCTION_BATCH)
+        oe_record_ecall_batch(
+            enclave,
+            (oe_call_enclave_function_batch_args_t*)arg,
+            oe_get_monotonic_time_ns() - start);
+
+    /* Run the ocalls the enclave queued before returning */
+    _dispatch_deferred_ocalls(enclave, oe_get_thread_binding());
+    returned = true;
+
     if (arg_out_ptr)
         *arg_out_ptr = arg_out;
 
@@ -634,7 +786,13 @@ oe_result_t oe_ecall(
 done:
 
     if (enclave && tcs)
+    {
+        if (!returned)
+            _discard_deferred_ocalls(enclave, tcs);
+
         _release_tcs(enclave, tcs);
+        _set_thread_binding(previous_binding);
+    }
 
     /* ATTN: this causes an assertion with call nesting. */
     /* ATTN: make enclave argument a cookie. */
@@ -0,0 +1,244 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+
+#include "callstats.h"
+#include <openenclave/internal/atomic.h>
+#include <openenclave/internal/raise.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+**==============================================================================
+**
+** Call statistics:
+**
+**     Every ecall and ocall of an enclave has a set of counters, indexed by
+**     its function id. The counters are updated with atomic adds and no
+**     locks, which still bounce their cache lines between the threads that
+**     make the same call. They are therefore only allocated, and calls only
+**     timed and counted, once oe_enable_call_statistics() is called.
+**
+**     A batch of ecalls is timed as a whole; each call of the batch is
+**     accounted for with an equal share of the time.
+**
+**==============================================================================
+*/
+
+typedef struct _oe_call_counters
+{
+    volatile uint64_t num_calls;
+    volatile uint64_t num_switchless_calls;
+    volatile uint64_t bytes_in;
+    volatile uint64_t bytes_out;
+    volatile uint64_t total_time_ns;
+    volatile uint64_t max_time_ns;
+    volatile uint64_t latency_buckets[OE_CALL_LATENCY_BUCKETS];
+} oe_call_counters_t;
+
+/* Map a latency to its bucket: four buckets per power of two */
+static size_t _latency_bucket(uint64_t time_ns)
+{
+    uint64_t msb = 0;
+    size_t bucket;
+
+    if (time_ns < 4)
+        return (size_t)time_ns;
+
+    for (uint64_t t = time_ns; t > 1; t >>= 1)
+        msb++;
+
+    bucket = (size_t)(4 * (msb - 1) + ((time_ns >> (msb - 2)) & 3));
+
+    return bucket < OE_CALL_LATENCY_BUCKETS ? bucket
+                                            : OE_CALL_LATENCY_BUCKETS - 1;
+}
+
+static void _record_call(
+    oe_call_counters_t* counters,
+    uint64_t bytes_in,
+    uint64_t bytes_out,
+    uint64_t time_ns,
+    bool switchless)
+{
+    oe_atomic_increment(&counters->num_calls);
+
+    if (switchless)
+        oe_atomic_increment(&counters->num_switchless_calls);
+
+    oe_atomic_add(&counters->bytes_in, bytes_in);
+    oe_atomic_add(&counters->bytes_out, bytes_out);
+    oe_atomic_add(&counters->total_time_ns, time_ns);
+    oe_atomic_max(&counters->max_time_ns, time_ns);
+    oe_atomic_increment(&counters->latency_buckets[_latency_bucket(time_ns)]);
+}
+
+oe_result_t oe_enable_call_statistics(oe_enclave_t* enclave)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    size_t count;
+    oe_call_counters_t* counters = NULL;
+
+    if (!enclave || enclave->magic != ENCLAVE_MAGIC)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    count = enclave->num_ecalls + enclave->num_ocalls;
+
+    if (oe_call_statistics_enabled(enclave) || !count)
+    {
+        result = OE_OK;
+        goto done;
+    }
+
+    if (!(counters = (oe_call_counters_t*)calloc(
+              count, sizeof(oe_call_counters_t))))
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    /* Another thread may have enabled the statistics first */
+    if (oe_atomic_compare_and_swap_ptr(
+            (void* volatile*)&enclave->call_counters, NULL, counters))
+        counters = NULL;
+
+    result = OE_OK;
+
+done:
+    free(counters);
+    return result;
+}
+
+void oe_destroy_call_statistics(oe_enclave_t* enclave)
+{
+    free(enclave->call_counters);
+    enclave->call_counters = NULL;
+}
+
+void oe_record_ecall(
+    oe_enclave_t* enclave,
+    const oe_call_enclave_function_args_t* args,
+    uint64_t time_ns,
+    bool switchless)
+{
+    oe_call_counters_t* counters = enclave->call_counters;
+
+    if (!counters || args->function_id >= enclave->num_ecalls)
+        return;
+
+    _record_call(
+        &counters[args->function_id],
+        args->input_buffer_size,
+        args->output_bytes_written,
+        time_ns,
+        switchless);
+}
+
+void oe_record_ecall_batch(
+    oe_enclave_t* enclave,
+    const oe_call_enclave_function_batch_args_t* batch,
+    uint64_t time_ns)
+{
+    if (!enclave->call_counters || !batch->num_calls)
+        return;
+
+    for (size_t i = 0; i < batch->num_calls; i++)
+        oe_record_ecall(
+            enclave, &batch->calls[i], time_ns / batch->num_calls, false);
+}
+
+void oe_record_ocall(
+    oe_enclave_t* enclave,
+    const oe_call_host_function_args_t* args,
+    uint64_t time_ns,
+    bool switchless)
+{
+    oe_call_counters_t* counters = enclave->call_counters;
+
+    if (!counters || args->function_id >= enclave->num_ocalls)
+        return;
+
+    _record_call(
+        &counters[enclave->num_ecalls + args->function_id],
+        args->input_buffer_size,
+        args->output_bytes_written,
+        time_ns,
+        switchless);
+}
+
+/*
+**==============================================================================
+**
+** oe_get_call_statistics()
+**
+**==============================================================================
+*/
+
+oe_result_t oe_get_call_statistics(
+    oe_enclave_t* enclave,
+    oe_call_statistics_t* statistics,
+    size_t* count)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_call_counters_t* call_counters;
+    size_t num_functions;
+    size_t num_called = 0;
+
+    if (!enclave || enclave->magic != ENCLAVE_MAGIC || !count)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    call_counters = enclave->call_counters;
+    num_functions =
+        call_counters ? enclave->num_ecalls + enclave->num_ocalls : 0;
+
+    for (size_t i = 0; i < num_functions; i++)
+    {
+        oe_call_counters_t* counters = &call_counters[i];
+        oe_call_statistics_t* entry;
+
+        if (!oe_atomic_load(&counters->num_calls))
+            continue;
+
+        if (!statistics || num_called >= *count)
+        {
+            num_called++;
+            continue;
+        }
+
+        entry = &statistics[num_called++];
+        memset(entry, 0, sizeof(*entry));
+
+        if (i < enclave->num_ecalls)
+        {
+            entry->kind = OE_CALL_KIND_ECALL;
+            entry->function_id = i;
+            entry->name =
+                enclave->ecall_names ? enclave->ecall_names[i].name : NULL;
+        }
+        else
+        {
+            entry->kind = OE_CALL_KIND_OCALL;
+            entry->function_id = i - enclave->num_ecalls;
+        }
+
+        entry->num_calls = oe_atomic_load(&counters->num_calls);
+        entry->num_switchless_calls =
+            oe_atomic_load(&counters->num_switchless_calls);
+        entry->bytes_in = oe_atomic_load(&counters->bytes_in);
+        entry->bytes_out = oe_atomic_load(&counters->bytes_out);
+        entry->total_time_ns = oe_atomic_load(&counters->total_time_ns);
+        entry->max_time_ns = oe_atomic_load(&counters->max_time_ns);
+
+        for (size_t b = 0; b < OE_CALL_LATENCY_BUCKETS; b++)
+            entry->latency_buckets[b] =
+                oe_atomic_load(&counters->latency_buckets[b]);
+    }
+
+    if (num_called > *count || (!statistics && num_called))
+    {
+        *count = num_called;
+        OE_RAISE_NO_TRACE(OE_BUFFER_TOO_SMALL);
+    }
+
+    *count = num_called;
+    result = OE_OK;
+
+done:
+    return result;
+}
@@ -0,0 +1,39 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+
+#ifndef _OE_HOST_CALLSTATS_H
+#define _OE_HOST_CALLSTATS_H
+
+#include <openenclave/host.h>
+#include "enclave.h"
+
+/* Whether oe_enable_call_statistics() was called on the enclave */
+OE_INLINE bool oe_call_statistics_enabled(oe_enclave_t* enclave)
+{
+    return enclave->call_counters != NULL;
+}
+
+/* Release the call counters of the enclave, if any */
+void oe_destroy_call_statistics(oe_enclave_t* enclave);
+
+/* Account for an ecall that returned after time_ns nanoseconds */
+void oe_record_ecall(
+    oe_enclave_t* enclave,
+    const oe_call_enclave_function_args_t* args,
+    uint64_t time_ns,
+    bool switchless);
+
+/* Account for the calls of a batch that returned after time_ns nanoseconds */
+void oe_record_ecall_batch(
+    oe_enclave_t* enclave,
+    const oe_call_enclave_function_batch_args_t* batch,
+    uint64_t time_ns);
+
+/* Account for an ocall whose host function took time_ns nanoseconds */
+void oe_record_ocall(
+    oe_enclave_t* enclave,
+    const oe_call_host_function_args_t* args,
+    uint64_t time_ns,
+    bool switchless);
+
+#endif /* _OE_HOST_CALLSTATS_H */
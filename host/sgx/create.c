@@ -56,11 +56,13 @@ static char* get_fullpath(const char* path)
 #include <string.h>
 #include "../memalign.h"
 #include "../signkey.h"
+#include "callstats.h"
 #include "cpuid.h"
 #include "enclave.h"
 #include "exception.h"
 #include "platform_u.h"
 #include "sgxload.h"
+#include "waitqueue.h"
 #include "xstate.h"
 
 #if !defined(OEHOSTMR)
@@ -213,16 +215,20 @@ static oe_result_t _add_control_pages(
      *     pageN - extra segment space for thread-specific data.
      */
 
+#if !defined(OEHOSTMR)
     /* Save the address of new TCS page into enclave object */
     {
-        if (enclave->num_bindings == OE_SGX_MAX_TCS)
+        if (enclave->num_bindings == enclave->max_bindings)
             OE_RAISE_MSG(
-                OE_FAILURE, "OE_SGX_MAX_TCS (%d) hit\n", OE_SGX_MAX_TCS);
+                OE_FAILURE,
+                "NumTCS (%zu) thread bindings exhausted\n",
+                enclave->max_bindings);
 
         enclave->bindings[enclave->num_bindings].enclave = enclave;
         enclave->bindings[enclave->num_bindings++].tcs =
             enclave->start_address + *vaddr;
     }
+#endif // OEHOSTMR
 
     /* Add the TCS page */
     {
@@ -507,16 +513,18 @@ static oe_result_t _configure_enclave(
             // Configure the switchless ocalls, such as the number of workers.
             case OE_ENCLAVE_SETTING_CONTEXT_SWITCHLESS:
             {
-                size_t max_host_workers =
-                    settings[i].u.context_switchless_setting->max_host_workers;
-                size_t max_enclave_workers =
-                    settings[i]
-                        .u.context_switchless_setting->max_enclave_workers;
-
                 OE_CHECK(oe_start_switchless_manager(
-                    enclave, max_host_workers, max_enclave_workers));
+                    enclave, settings[i].u.context_switchless_setting));
+                break;
+            }
+            // Let ecalls wait for a TCS instead of failing when none is idle.
+            case OE_ENCLAVE_SETTING_THREAD_WAIT_QUEUE:
+            {
+                OE_CHECK(oe_create_thread_wait_queue(
+                    enclave, settings[i].u.thread_wait_queue_setting));
                 break;
             }
+            case OE_ENCLAVE_SETTING_OCALL_BUFFER:
             case OE_SGX_ENCLAVE_CONFIG_DATA:
             {
                 break;
@@ -860,6 +868,20 @@ oe_result_t oe_sgx_build_enclave(
     /* Validate the enclave prop_override structure */
     OE_CHECK(oe_sgx_validate_enclave_properties(&props, NULL));
 
+#if !defined(OEHOSTMR)
+    /* Allocate one thread binding per TCS. Measuring the enclave does not
+     * run it, so it needs none. */
+    if (props.header.size_settings.num_tcs)
+    {
+        enclave->bindings = (oe_thread_binding_t*)calloc(
+            props.header.size_settings.num_tcs, sizeof(oe_thread_binding_t));
+        if (!enclave->bindings)
+            OE_RAISE(OE_OUT_OF_MEMORY);
+
+        enclave->max_bindings = props.header.size_settings.num_tcs;
+    }
+#endif // OEHOSTMR
+
     /* If the OE_ENCLAVE_FLAG_DEBUG_AUTO is set and the OE_ENCLAVE_FLAG_DEBUG is
      * cleared, set enclave->debug based on the attributes in the properties. */
     if (!enclave->debug && oe_sgx_is_debug_auto_load_context(context))
@@ -999,6 +1021,11 @@ oe_result_t oe_sgx_build_enclave(
         tls_page_count,
         &vaddr));
 
+#if !defined(OEHOSTMR)
+    /* All TCSs are known now, so the free list of bindings can be built */
+    oe_init_thread_bindings(enclave);
+#endif
+
 #ifdef OE_WITH_EXPERIMENTAL_EEID
     /* Add optional EEID pages */
     OE_CHECK(_add_eeid_pages(context, enclave_addr, &vaddr));
@@ -1104,6 +1131,36 @@ done:
 }
 
 #if !defined(OEHOSTMR)
+/*
+**==============================================================================
+**
+** _free_thread_bindings()
+**
+**     Release the per-TCS thread bindings allocated by oe_sgx_build_enclave()
+**     along with the resources each binding holds.
+**
+**==============================================================================
+*/
+static void _free_thread_bindings(oe_enclave_t* enclave)
+{
+    for (size_t i = 0; i < enclave->num_bindings; i++)
+    {
+        oe_thread_binding_t* binding = &enclave->bindings[i];
+#if defined(_WIN32)
+        /* Release Windows events created during enclave creation */
+        if (binding->event.handle)
+            CloseHandle(binding->event.handle);
+#endif
+        free(binding->ocall_buffer);
+        free(binding->deferred_ocalls.buffer);
+    }
+
+    free(enclave->bindings);
+    enclave->bindings = NULL;
+    enclave->num_bindings = 0;
+    enclave->max_bindings = 0;
+}
+
 /*
 ** This method encapsulates all steps of the enclave creation process:
 **     - Loads an enclave image file
@@ -1134,6 +1191,7 @@ oe_result_t oe_create_enclave(
     oe_result_t result = OE_UNEXPECTED;
     oe_enclave_t* enclave = NULL;
     oe_sgx_load_context_t context;
+    const oe_enclave_setting_ocall_buffer_t* ocall_buffer_setting = NULL;
 
     _initialize_enclave_host();
 
@@ -1160,29 +1218,6 @@ oe_result_t oe_create_enclave(
     if (!(enclave = (oe_enclave_t*)calloc(1, sizeof(oe_enclave_t))))
         OE_RAISE(OE_OUT_OF_MEMORY);
 
-#if defined(_WIN32)
-    /* Create Windows events for each TCS binding. Enclaves use
-     * this event when calling into the host to handle waits/wakes
-     * as part of the enclave mutex and condition variable
-     * implementation.
-     */
-    for (size_t i = 0; i < enclave->num_bindings; i++)
-    {
-        oe_thread_binding_t* binding = &enclave->bindings[i];
-
-        if (!(binding->event.handle = CreateEvent(
-                  0,     /* No security attributes */
-                  FALSE, /* Event is reset automatically */
-                  FALSE, /* Event is not put in a signaled state
-                            upon creation */
-                  0)))   /* No name */
-        {
-            OE_RAISE_MSG(OE_FAILURE, "CreateEvent failed", NULL);
-        }
-    }
-
-#endif
-
     /* Initialize the context parameter and any driver handles */
     OE_CHECK(oe_sgx_initialize_load_context(
         &context, OE_SGX_LOAD_TYPE_CREATE, flags));
@@ -1195,6 +1230,19 @@ oe_result_t oe_create_enclave(
             context.use_config_id = true;
         }
 
+        /* The ocall buffers are allocated by the first ecalls */
+        if (settings[i].setting_type == OE_ENCLAVE_SETTING_OCALL_BUFFER)
+        {
+            const oe_enclave_setting_ocall_buffer_t* setting =
+                settings[i].u.ocall_buffer_setting;
+
+            if (!setting || (setting->max_size &&
+                             setting->max_size < setting->initial_size))
+                OE_RAISE(OE_INVALID_PARAMETER);
+
+            ocall_buffer_setting = setting;
+        }
+
 #ifdef OE_WITH_EXPERIMENTAL_EEID
         if (settings[i].setting_type == OE_EXTENDED_ENCLAVE_INITIALIZATION_DATA)
         {
@@ -1206,6 +1254,38 @@ oe_result_t oe_create_enclave(
     /* Build the enclave */
     OE_CHECK(oe_sgx_build_enclave(&context, enclave_path, NULL, enclave));
 
+    /* Building clears the enclave structure, so the ocall buffer sizes are
+     * stored afterwards, before the initialization ecall allocates the
+     * first buffer. */
+    if (ocall_buffer_setting)
+    {
+        enclave->ocall_buffer_initial_size = ocall_buffer_setting->initial_size;
+        enclave->ocall_buffer_max_size = ocall_buffer_setting->max_size;
+    }
+
+#if defined(_WIN32)
+    /* Create Windows events for each TCS binding. Enclaves use
+     * this event when calling into the host to handle waits/wakes
+     * as part of the enclave mutex and condition variable
+     * implementation. The bindings only exist once the enclave has
+     * been built from its signed NumTCS.
+     */
+    for (size_t i = 0; i < enclave->num_bindings; i++)
+    {
+        oe_thread_binding_t* binding = &enclave->bindings[i];
+
+        if (!(binding->event.handle = CreateEvent(
+                  0,     /* No security attributes */
+                  FALSE, /* Event is reset automatically */
+                  FALSE, /* Event is not put in a signaled state
+                            upon creation */
+                  0)))   /* No name */
+        {
+            OE_RAISE_MSG(OE_FAILURE, "CreateEvent failed", NULL);
+        }
+    }
+#endif
+
     /* Push the new created enclave to the global list. */
     if (oe_push_enclave_instance(enclave) != 0)
     {
@@ -1232,6 +1312,7 @@ oe_result_t oe_create_enclave(
 
     /* Register ecalls */
     enclave->num_ecalls = ecall_count;
+    enclave->ecall_names = ecall_name_table;
     oe_register_ecalls(enclave, ecall_name_table, ecall_count);
 
     /* Invoke enclave initialization. */
@@ -1264,6 +1345,9 @@ done:
 
     if (result != OE_OK && enclave)
     {
+        oe_destroy_thread_wait_queue(enclave);
+        oe_destroy_call_statistics(enclave);
+        _free_thread_bindings(enclave);
         free(enclave);
     }
 
@@ -1322,15 +1406,9 @@ oe_result_t oe_terminate_enclave(oe_enclave_t* enclave)
          * Track failures reported by the platform, but do not exit early */
         result = oe_sgx_delete_enclave(enclave);
 
-        for (size_t i = 0; i < enclave->num_bindings; i++)
-        {
-            oe_thread_binding_t* binding = &enclave->bindings[i];
-#if defined(_WIN32)
-            /* Release Windows events created during enclave creation */
-            CloseHandle(binding->event.handle);
-#endif
-            free(binding->ocall_buffer);
-        }
+        _free_thread_bindings(enclave);
+        oe_destroy_thread_wait_queue(enclave);
+        oe_destroy_call_statistics(enclave);
 
         /* Free the path name of the enclave image file */
         free(enclave->path);
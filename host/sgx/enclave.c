@@ -4,31 +4,139 @@
 #include "enclave.h"
 #include <assert.h>
 #include <openenclave/host.h>
+#include <openenclave/internal/atomic.h>
 
-/* Get the event object from the enclave for the given TCS */
-EnclaveEvent* GetEnclaveEvent(oe_enclave_t* enclave, uint64_t tcs)
+/*
+**==============================================================================
+**
+** oe_init_thread_bindings()
+**
+**     Push every binding onto the enclave's free list. Called once after all
+**     TCS pages have been added, before any ecall can be made.
+**
+**==============================================================================
+*/
+
+void oe_init_thread_bindings(oe_enclave_t* enclave)
+{
+    uint32_t next = OE_THREAD_BINDING_NIL;
+
+    /* Push in reverse so that the lowest TCS is handed out first */
+    for (size_t i = enclave->num_bindings; i > 0; i--)
+    {
+        enclave->bindings[i - 1].next_free = next;
+        next = (uint32_t)(i - 1);
+    }
+
+    enclave->free_bindings = next;
+}
+
+/*
+**==============================================================================
+**
+** oe_pop_free_thread_binding()
+** oe_push_free_thread_binding()
+**
+**     Lock-free (Treiber) stack of idle bindings. The head packs the index of
+**     the top binding with a tag that is incremented on every update, so a
+**     head that was popped and pushed back between a load and the CAS is
+**     still detected.
+**
+**==============================================================================
+*/
+
+#define _FREE_BINDINGS_TAG_ONE (1ULL << 32)
+#define _FREE_BINDINGS_INDEX(HEAD) ((uint32_t)((HEAD)&0xFFFFFFFFULL))
+#define _FREE_BINDINGS_TAG(HEAD) ((HEAD) & ~0xFFFFFFFFULL)
+
+oe_thread_binding_t* oe_pop_free_thread_binding(oe_enclave_t* enclave)
 {
-    EnclaveEvent* event = NULL;
+    uint64_t head;
+    uint64_t next;
+    uint32_t index;
+
+    do
+    {
+        head = oe_atomic_load(&enclave->free_bindings);
+        index = _FREE_BINDINGS_INDEX(head);
+
+        if (index == OE_THREAD_BINDING_NIL)
+            return NULL;
+
+        next = (_FREE_BINDINGS_TAG(head) + _FREE_BINDINGS_TAG_ONE) |
+               *(volatile uint32_t*)&enclave->bindings[index].next_free;
+    } while (!oe_atomic_compare_and_swap(
+        (volatile int64_t*)&enclave->free_bindings,
+        (int64_t)head,
+        (int64_t)next));
+
+    return &enclave->bindings[index];
+}
+
+void oe_push_free_thread_binding(
+    oe_enclave_t* enclave,
+    oe_thread_binding_t* binding)
+{
+    uint32_t index = (uint32_t)(binding - enclave->bindings);
+    uint64_t head;
+    uint64_t next;
+
+    do
+    {
+        head = oe_atomic_load(&enclave->free_bindings);
+        binding->next_free = _FREE_BINDINGS_INDEX(head);
+        next = (_FREE_BINDINGS_TAG(head) + _FREE_BINDINGS_TAG_ONE) | index;
+    } while (!oe_atomic_compare_and_swap(
+        (volatile int64_t*)&enclave->free_bindings,
+        (int64_t)head,
+        (int64_t)next));
+}
+
+/*
+**==============================================================================
+**
+** oe_find_thread_binding()
+**
+**     Find the binding for the given TCS. The bindings array is sorted by
+**     TCS address and never changes after the enclave is built, so a binary
+**     search can run without the enclave lock.
+**
+**==============================================================================
+*/
+
+oe_thread_binding_t* oe_find_thread_binding(
+    oe_enclave_t* enclave,
+    uint64_t tcs)
+{
+    size_t lo = 0;
+    size_t hi;
 
     if (!enclave)
         return NULL;
 
-    oe_mutex_lock(&enclave->lock);
+    hi = enclave->num_bindings;
+
+    while (lo < hi)
     {
-        size_t i;
-
-        for (i = 0; i < enclave->num_bindings; i++)
-        {
-            oe_thread_binding_t* binding = &enclave->bindings[i];
-
-            if (binding->tcs == tcs)
-            {
-                event = &binding->event;
-                break;
-            }
-        }
+        size_t mid = lo + (hi - lo) / 2;
+        oe_thread_binding_t* binding = &enclave->bindings[mid];
+
+        if (binding->tcs == tcs)
+            return binding;
+
+        if (binding->tcs < tcs)
+            lo = mid + 1;
+        else
+            hi = mid;
     }
-    oe_mutex_unlock(&enclave->lock);
 
-    return event;
+    return NULL;
+}
+
+/* Get the event object from the enclave for the given TCS */
+EnclaveEvent* GetEnclaveEvent(oe_enclave_t* enclave, uint64_t tcs)
+{
+    oe_thread_binding_t* binding = oe_find_thread_binding(enclave, tcs);
+
+    return binding ? &binding->event : NULL;
 }
@@ -76,6 +76,19 @@ typedef struct _thread_binding
     /* Buffer used for ocall parameters */
     void* ocall_buffer;
     uint64_t ocall_buffer_size;
+
+    /* Largest ocall parameters that did not fit in the buffer since it was
+     * last grown */
+    uint64_t ocall_buffer_miss_size;
+
+    /* Queue of deferred one-way ocalls, filled by the enclave */
+    oe_deferred_ocall_queue_t deferred_ocalls;
+
+    /* Non-zero while the deferred ocalls are being dispatched */
+    uint64_t dispatching_deferred_ocalls;
+
+    /* Index of the next idle binding in the enclave's free list */
+    uint32_t next_free;
 } oe_thread_binding_t;
 
 /* Whether this binding is busy */
@@ -84,6 +97,9 @@ typedef struct _thread_binding
 /* Whether the thread is handling an exception */
 #define _OE_THREAD_HANDLING_EXCEPTION 0X2UL
 
+/* Terminates the free list of idle bindings */
+#define OE_THREAD_BINDING_NIL 0xFFFFFFFFU
+
 /* Get thread data from thread-specific data (TSD) */
 oe_thread_binding_t* oe_get_thread_binding(void);
 
@@ -109,11 +125,20 @@ typedef struct _oe_enclave
     /* Size of enclave in bytes */
     uint64_t size;
 
-    /* Array of thread bindings */
-    oe_thread_binding_t bindings[OE_SGX_MAX_TCS];
+    /* Array of thread bindings (sorted by TCS address), one per TCS */
+    oe_thread_binding_t* bindings;
     size_t num_bindings;
+    size_t max_bindings;
     oe_mutex lock;
 
+    /* Lock-free stack of idle bindings. The low 32 bits hold the index of
+     * the top binding (OE_THREAD_BINDING_NIL if empty) and the high 32 bits
+     * hold a tag that is bumped on every update to defeat ABA. */
+    volatile uint64_t free_bindings;
+
+    /* Optional FIFO queue of host threads waiting for an idle binding */
+    struct _oe_thread_wait_queue* thread_wait_queue;
+
     /* Hash of enclave (MRENCLAVE) */
     OE_SHA256 hash;
 
@@ -134,13 +159,41 @@ typedef struct _oe_enclave
     /* Manager for switchless calls */
     oe_switchless_call_manager_t* switchless_manager;
 
+    /* Sizes of the per-binding ocall buffers (zero for the defaults) */
+    uint64_t ocall_buffer_initial_size;
+    uint64_t ocall_buffer_max_size;
+    oe_ocall_buffer_statistics_t ocall_buffer_statistics;
+
     /* Table of global to local ecall ids */
     oe_ecall_id_t* ecall_id_table;
     size_t ecall_id_table_size;
     size_t num_ecalls;
+
+    /* Table of ecall names, indexed by local ecall id */
+    const oe_ecall_info_t* ecall_names;
+
+    /* Counters of the ecalls followed by those of the ocalls, allocated by
+     * oe_enable_call_statistics() */
+    struct _oe_call_counters* volatile call_counters;
 } oe_enclave_t;
 
 /* Get the event for the given TCS */
 EnclaveEvent* GetEnclaveEvent(oe_enclave_t* enclave, uint64_t tcs);
 
+/* Initialize the free list of idle bindings once all TCSs have been added */
+void oe_init_thread_bindings(oe_enclave_t* enclave);
+
+/* Take an idle binding from the free list, or NULL if none is left */
+oe_thread_binding_t* oe_pop_free_thread_binding(oe_enclave_t* enclave);
+
+/* Return an idle binding to the free list */
+void oe_push_free_thread_binding(
+    oe_enclave_t* enclave,
+    oe_thread_binding_t* binding);
+
+/* Find the binding for the given TCS without taking the enclave lock */
+oe_thread_binding_t* oe_find_thread_binding(
+    oe_enclave_t* enclave,
+    uint64_t tcs);
+
 #endif /* _OE_HOST_ENCLAVE_H */
@@ -173,19 +173,17 @@ oe_enclave_t* oe_query_enclave_instance(void* tcs)
         OE_LIST_FOREACH(tmp, &oe_enclave_list_head, next_entry)
         {
             oe_enclave_t* enclave = tmp->enclave;
+            uint64_t addr = (uint64_t)tcs;
 
-            oe_mutex_lock(&enclave->lock);
-
-            for (uint32_t i = 0; i < OE_COUNTOF(enclave->bindings); i++)
+            // The bindings are immutable once the enclave is built, so no
+            // enclave lock is needed to search them.
+            if (addr >= enclave->start_address &&
+                addr < enclave->start_address + enclave->size &&
+                oe_find_thread_binding(enclave, addr))
             {
-                if (enclave->bindings[i].tcs == (uint64_t)tcs)
-                {
-                    ret = enclave;
-                    break;
-                }
+                ret = enclave;
+                break;
             }
-
-            oe_mutex_unlock(&enclave->lock);
         }
     }
 
@@ -2,8 +2,10 @@
 // Licensed under the MIT License.
 
 #include <openenclave/bits/sgx/sgxtypes.h>
+#include <openenclave/internal/atomic.h>
 #include <openenclave/internal/calls.h>
 #include <openenclave/internal/constants_x64.h>
+#include <openenclave/internal/raise.h>
 #include <openenclave/internal/registers.h>
 #include <openenclave/internal/sgx/ecall_context.h>
 #include "asmdefs.h"
@@ -137,6 +139,17 @@ int __oe_host_stack_bridge(
  */
 #define OE_DEFAULT_OCALL_BUFFER_SIZE (16 * 1024)
 
+/**
+ * Default cap on the size ocall buffers grow to when ocalls do not fit.
+ */
+#define OE_DEFAULT_MAX_OCALL_BUFFER_SIZE (1024 * 1024)
+
+/**
+ * Size of the per-thread queue of deferred ocalls. When it is full, the
+ * enclave has the host dispatch the queued ocalls before adding more.
+ */
+#define OE_DEFERRED_OCALL_BUFFER_SIZE (16 * 1024)
+
 /**
  * Setup the ecall_context.
  */
@@ -145,13 +158,101 @@ OE_INLINE void _setup_ecall_context(oe_ecall_context_t* ecall_context)
     oe_thread_binding_t* binding = oe_get_thread_binding();
     if (binding->ocall_buffer == NULL)
     {
+        uint64_t size = binding->enclave->ocall_buffer_initial_size;
+        if (!size)
+            size = OE_DEFAULT_OCALL_BUFFER_SIZE;
+
         // Lazily allocate buffer for making ocalls. Bound to the tcs.
         // Will be cleaned up by enclave during termination.
-        binding->ocall_buffer = malloc(OE_DEFAULT_OCALL_BUFFER_SIZE);
-        binding->ocall_buffer_size = OE_DEFAULT_OCALL_BUFFER_SIZE;
+        binding->ocall_buffer = malloc(size);
+        binding->ocall_buffer_size = binding->ocall_buffer ? size : 0;
     }
     ecall_context->ocall_buffer = binding->ocall_buffer;
     ecall_context->ocall_buffer_size = binding->ocall_buffer_size;
+
+    if (binding->deferred_ocalls.buffer == NULL)
+    {
+        binding->deferred_ocalls.buffer =
+            (uint8_t*)malloc(OE_DEFERRED_OCALL_BUFFER_SIZE);
+
+        // Without a queue, deferred ocalls are made as regular ocalls.
+        if (binding->deferred_ocalls.buffer)
+            binding->deferred_ocalls.capacity = OE_DEFERRED_OCALL_BUFFER_SIZE;
+    }
+    if (binding->deferred_ocalls.buffer)
+        ecall_context->deferred_ocalls = &binding->deferred_ocalls;
+}
+
+/**
+ * Account for the ocalls that did not fit in the ocall buffer during an
+ * ecall, and grow the buffer to fit the largest of them once the outermost
+ * ecall on the binding returns. Nested ecalls leave the buffer alone since
+ * an outer ocall may still be using it.
+ */
+static void _update_ocall_buffer(
+    oe_enclave_t* enclave,
+    const oe_ecall_context_t* ecall_context)
+{
+    oe_thread_binding_t* binding = oe_get_thread_binding();
+    oe_ocall_buffer_statistics_t* statistics =
+        &enclave->ocall_buffer_statistics;
+    uint64_t max_size = enclave->ocall_buffer_max_size;
+    uint64_t miss_size = ecall_context->ocall_buffer_miss_size;
+    uint64_t size;
+    void* buffer;
+
+    if (ecall_context->ocall_buffer_misses)
+    {
+        oe_atomic_add(
+            &statistics->total_misses, ecall_context->ocall_buffer_misses);
+        oe_atomic_max(&statistics->max_miss_size, miss_size);
+    }
+
+    if (miss_size > binding->ocall_buffer_miss_size)
+        binding->ocall_buffer_miss_size = miss_size;
+
+    if (binding->count > 1)
+        return;
+
+    miss_size = binding->ocall_buffer_miss_size;
+    binding->ocall_buffer_miss_size = 0;
+
+    if (!max_size)
+        max_size = OE_DEFAULT_MAX_OCALL_BUFFER_SIZE;
+
+    if (miss_size <= binding->ocall_buffer_size || miss_size > max_size)
+        return;
+
+    // Round up to a power of two so that a few growths cover a workload.
+    for (size = binding->ocall_buffer_size ? binding->ocall_buffer_size
+                                           : OE_DEFAULT_OCALL_BUFFER_SIZE;
+         size < miss_size;)
+        size *= 2;
+
+    if (size > max_size)
+        size = max_size;
+
+    // Keep the current buffer if the larger one cannot be allocated.
+    if (!(buffer = malloc(size)))
+        return;
+
+    free(binding->ocall_buffer);
+    binding->ocall_buffer = buffer;
+    binding->ocall_buffer_size = size;
+
+    oe_atomic_increment(&statistics->total_grows);
+    oe_atomic_max(&statistics->max_buffer_size, size);
+}
+
+/**
+ * Whether the ecall, or a nested ecall on the binding before it returned,
+ * had ocalls that did not fit in the ocall buffer. Nested ecalls leave their
+ * misses on the binding for the outermost one to apply.
+ */
+OE_INLINE bool _has_ocall_buffer_misses(const oe_ecall_context_t* ecall_context)
+{
+    return ecall_context->ocall_buffer_misses ||
+           oe_get_thread_binding()->ocall_buffer_miss_size;
 }
 
 /**
@@ -243,6 +344,9 @@ void oe_enter(
             break;
     }
 
+    if (_has_ocall_buffer_misses(&ecall_context))
+        _update_ocall_buffer(enclave, &ecall_context);
+
     *arg3 = arg1;
     *arg4 = arg2;
 }
@@ -359,6 +463,39 @@ void oe_enter_sim(
             break;
     }
 
+    if (_has_ocall_buffer_misses(&ecall_context))
+        _update_ocall_buffer(enclave, &ecall_context);
+
     *arg3 = arg1;
     *arg4 = arg2;
 }
+
+/*
+**==============================================================================
+**
+** oe_get_ocall_buffer_statistics()
+**
+**==============================================================================
+*/
+
+oe_result_t oe_get_ocall_buffer_statistics(
+    oe_enclave_t* enclave,
+    oe_ocall_buffer_statistics_t* statistics)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_ocall_buffer_statistics_t* current;
+
+    if (!enclave || enclave->magic != ENCLAVE_MAGIC || !statistics)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    current = &enclave->ocall_buffer_statistics;
+    statistics->total_misses = oe_atomic_load(&current->total_misses);
+    statistics->total_grows = oe_atomic_load(&current->total_grows);
+    statistics->max_miss_size = oe_atomic_load(&current->max_miss_size);
+    statistics->max_buffer_size = oe_atomic_load(&current->max_buffer_size);
+
+    result = OE_OK;
+
+done:
+    return result;
+}
@@ -5,6 +5,7 @@
 #include <stdio.h>
 
 #if defined(__linux__)
+#include <errno.h>
 #include <linux/futex.h>
 #include <stdlib.h>
 #include <sys/random.h>
@@ -68,6 +69,94 @@ void HandleThreadWait(oe_enclave_t* enclave, uint64_t arg_in)
 #endif
 }
 
+/*
+**==============================================================================
+**
+** HandleThreadTimedWait()
+**
+**     The enclave passes the deadline rather than its TCS, so wait on the
+**     event of the binding of the calling thread, which is the one other
+**     threads wake through its TCS. A wait that times out withdraws from the
+**     event, unless a wake came in meanwhile; that wake then counts, so it
+**     is never lost.
+**
+**==============================================================================
+*/
+
+void HandleThreadTimedWait(
+    oe_enclave_t* enclave,
+    uint64_t deadline_ns,
+    uint64_t* arg_out)
+{
+    oe_thread_binding_t* binding = oe_get_thread_binding();
+    EnclaveEvent* event = NULL;
+    bool timed_out = false;
+
+    OE_UNUSED(enclave);
+    assert(binding && binding->enclave == enclave);
+    event = &binding->event;
+
+#if defined(__linux__)
+
+    if (__sync_fetch_and_add(&event->value, (uint32_t)-1) == 0)
+    {
+        struct timespec deadline;
+
+        deadline.tv_sec = (time_t)(deadline_ns / 1000000000);
+        deadline.tv_nsec = (long)(deadline_ns % 1000000000);
+
+        do
+        {
+            // FUTEX_WAIT_BITSET takes an absolute timeout, on the realtime
+            // clock with FUTEX_CLOCK_REALTIME.
+            if (syscall(
+                    __NR_futex,
+                    &event->value,
+                    FUTEX_WAIT_BITSET_PRIVATE | FUTEX_CLOCK_REALTIME,
+                    -1,
+                    &deadline,
+                    NULL,
+                    FUTEX_BITSET_MATCH_ANY) != 0 &&
+                errno == ETIMEDOUT &&
+                __sync_bool_compare_and_swap(&event->value, (uint32_t)-1, 0))
+            {
+                timed_out = true;
+                break;
+            }
+        } while (event->value == (uint32_t)-1);
+    }
+
+#elif defined(_WIN32)
+
+    {
+        /* 100-nanosecond intervals between 1601 and 1970 */
+        const uint64_t epoch_offset = 116444736000000000ULL;
+        FILETIME filetime;
+        ULARGE_INTEGER now;
+        DWORD timeout_ms = 0;
+
+        GetSystemTimePreciseAsFileTime(&filetime);
+        now.LowPart = filetime.dwLowDateTime;
+        now.HighPart = filetime.dwHighDateTime;
+        now.QuadPart = (now.QuadPart - epoch_offset) * 100;
+
+        if (deadline_ns > now.QuadPart)
+        {
+            uint64_t ms = (deadline_ns - now.QuadPart + 999999) / 1000000;
+            timeout_ms = ms < INFINITE ? (DWORD)ms : INFINITE - 1;
+        }
+
+        // An event set after the timeout only causes a spurious wake.
+        timed_out =
+            WaitForSingleObject(event->handle, timeout_ms) == WAIT_TIMEOUT;
+    }
+
+#endif
+
+    if (arg_out)
+        *arg_out = timed_out ? 1 : 0;
+}
+
 void HandleThreadWake(oe_enclave_t* enclave, uint64_t arg_in)
 {
     const uint64_t tcs = arg_in;
@@ -9,4 +9,12 @@
 void HandleThreadWait(oe_enclave_t* enclave, uint64_t arg);
 void HandleThreadWake(oe_enclave_t* enclave, uint64_t arg);
 
+/* Wait like HandleThreadWait() on the thread calling from the enclave, until
+ * the deadline in nanoseconds since the Epoch. *arg_out is set to 1 if the
+ * wait timed out. */
+void HandleThreadTimedWait(
+    oe_enclave_t* enclave,
+    uint64_t deadline_ns,
+    uint64_t* arg_out);
+
 #endif /* _OE_HOST_SGX_OCALLS_H */
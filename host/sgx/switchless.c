@@ -7,21 +7,56 @@
 #include <openenclave/internal/defs.h>
 #include <openenclave/internal/raise.h>
 #include <openenclave/internal/switchless.h>
+#include <openenclave/internal/time.h>
 #include <openenclave/internal/utils.h>
 #include "../calls.h"
 #include "../hostthread.h"
+#include "../memalign.h"
+#include "callstats.h"
 #include "enclave.h"
 #include "platform_u.h"
 
 /**
- * Number of iterations an ocall worker thread would spin before going to sleep
+ * Default range of the time a worker thread spins before going to sleep
  */
-#define OE_HOST_WORKER_SPIN_COUNT_THRESHOLD (4096U)
+#define OE_SWITCHLESS_DEFAULT_MIN_SPIN_NS (10000U)
+#define OE_SWITCHLESS_DEFAULT_MAX_SPIN_NS (200000U)
 
 /**
- * Number of iterations an ecall worker thread would spin before going to sleep
+ * Minimum number of pending calls each switchless ring can hold
  */
-#define OE_ENCLAVE_WORKER_SPIN_COUNT_THRESHOLD (4096U)
+#define OE_SWITCHLESS_RING_MIN_CAPACITY (64U)
+
+/**
+ * Interval at which the pool controller looks at the load of elastic pools
+ */
+#define OE_SWITCHLESS_CONTROLLER_PERIOD_NS (10000000U)
+
+/**
+ * Number of consecutive intervals with queued calls after which an elastic
+ * pool adds a worker
+ */
+#define OE_SWITCHLESS_GROW_PERIODS (2U)
+
+/**
+ * Number of consecutive intervals with an idle worker after which an elastic
+ * pool retires a worker
+ */
+#define OE_SWITCHLESS_RETIRE_PERIODS (100U)
+
+/**
+ * Average duration of a host function above which OE_OCALL_ROUTE_AUTO makes
+ * its ocalls as regular calls. Roughly the cost of a pair of enclave
+ * transitions: longer calls gain little from a worker and keep it busy.
+ * They return to switchless once the average falls below half of this.
+ */
+#define OE_SWITCHLESS_AUTO_MAX_OCALL_NS (10000U)
+
+OE_STATIC_ASSERT(
+    OE_OCALL_ROUTE_DEFAULT == OE_SWITCHLESS_OCALL_ROUTE_AS_DECLARED);
+OE_STATIC_ASSERT(
+    OE_OCALL_ROUTE_SWITCHLESS == OE_SWITCHLESS_OCALL_ROUTE_SWITCHLESS);
+OE_STATIC_ASSERT(OE_OCALL_ROUTE_REGULAR == OE_SWITCHLESS_OCALL_ROUTE_REGULAR);
 
 /**
  * Declare the prototypes of the following functions to avoid missing-prototypes
@@ -30,11 +65,16 @@
 OE_UNUSED_FUNC oe_result_t _oe_sgx_init_context_switchless_ecall(
     oe_enclave_t* enclave,
     oe_result_t* _retval,
+    uint32_t layout_version,
     oe_host_worker_context_t* host_worker_contexts,
-    uint64_t num_host_workers);
+    uint64_t num_host_workers,
+    oe_switchless_ring_t* host_worker_ring,
+    uint8_t* ocall_routes,
+    uint64_t num_ocall_routes);
 OE_UNUSED_FUNC oe_result_t _oe_sgx_switchless_enclave_worker_thread_ecall(
     oe_enclave_t* enclave,
-    oe_enclave_worker_context_t* context);
+    oe_enclave_worker_context_t* context,
+    oe_switchless_ring_t* ring);
 
 /**
  * Make the following ECALLs weak to support the system EDL opt-in.
@@ -47,12 +87,20 @@ OE_UNUSED_FUNC oe_result_t _oe_sgx_switchless_enclave_worker_thread_ecall(
 oe_result_t _oe_sgx_init_context_switchless_ecall(
     oe_enclave_t* enclave,
     oe_result_t* _retval,
+    uint32_t layout_version,
     oe_host_worker_context_t* host_worker_contexts,
-    uint64_t num_host_workers)
+    uint64_t num_host_workers,
+    oe_switchless_ring_t* host_worker_ring,
+    uint8_t* ocall_routes,
+    uint64_t num_ocall_routes)
 {
     OE_UNUSED(enclave);
+    OE_UNUSED(layout_version);
     OE_UNUSED(host_worker_contexts);
     OE_UNUSED(num_host_workers);
+    OE_UNUSED(host_worker_ring);
+    OE_UNUSED(ocall_routes);
+    OE_UNUSED(num_ocall_routes);
 
     if (_retval)
         *_retval = OE_UNSUPPORTED;
@@ -65,10 +113,12 @@ OE_WEAK_ALIAS(
 
 oe_result_t _oe_sgx_switchless_enclave_worker_thread_ecall(
     oe_enclave_t* enclave,
-    oe_enclave_worker_context_t* context)
+    oe_enclave_worker_context_t* context,
+    oe_switchless_ring_t* ring)
 {
     OE_UNUSED(enclave);
     OE_UNUSED(context);
+    OE_UNUSED(ring);
     return OE_UNSUPPORTED;
 }
 OE_WEAK_ALIAS(
@@ -76,292 +126,1495 @@ OE_WEAK_ALIAS(
     oe_sgx_switchless_enclave_worker_thread_ecall);
 
 /*
-** The thread function that handles switchless ocalls
+**==============================================================================
+**
+** Spin policy:
 **
+**     An idle worker spins for a while before it sleeps, so that a call
+**     arriving soon after the previous one is picked up without a wake-up.
+**     The spin time is twice the average gap between calls, kept as a moving
+**     average with weight 1/8, and clamped to the range set with
+**     oe_set_switchless_spin_policy(). If the calls are further apart than
+**     the maximum, spinning would rarely catch one and the worker spins only
+**     the minimum. Between two looks at its ring, the worker pauses for
+**     exponentially longer, up to OE_SWITCHLESS_MAX_BACKOFF_PAUSES.
+**
+**     Host workers measure their gaps themselves. Enclave workers have no
+**     trusted clock, so the host measures the gaps between the switchless
+**     ecalls it posts and turns the spin time into a spin count, which it
+**     stores in the worker's context when the worker sleeps or is woken.
+**
+**==============================================================================
 */
-static void* _switchless_ocall_worker(void* arg)
+
+/* Fold the given gap between calls into the average */
+static void _update_average_gap(
+    volatile uint64_t* average_gap_ns,
+    uint64_t gap_ns,
+    uint64_t max_spin_ns)
 {
-    oe_host_worker_context_t* context = (oe_host_worker_context_t*)arg;
+    // Gaps much longer than any spin time all mean the same thing. Clamp
+    // them so that the average recovers quickly once calls resume.
+    if (gap_ns > 4 * max_spin_ns)
+        gap_ns = 4 * max_spin_ns;
 
-    while (!context->is_stopping)
-    {
-        volatile oe_call_host_function_args_t* local_call_arg = NULL;
-        if ((local_call_arg = context->call_arg) != NULL)
-        {
-            // Handle the switchless call, but do not clear the slot yet. Since
-            // the slot is not empty, any new incoming switchless call request
-            // will be scheduled in another available work thread and get
-            // handled immediately.
-            oe_handle_call_host_function(
-                (uint64_t)local_call_arg, context->enc);
-
-            // After handling the switchless call, mark this worker thread
-            // as free by clearing the slot.
-            context->call_arg = NULL;
+    *average_gap_ns = *average_gap_ns - *average_gap_ns / 8 + gap_ns / 8;
+}
 
-            // Reset spin count for next message.
-            context->total_spin_count += context->spin_count;
-            context->spin_count = 0;
-        }
-        else
-        {
-            // If there is no message, increment spin count until threshold is
-            // reached.
-            if (++context->spin_count >= OE_HOST_WORKER_SPIN_COUNT_THRESHOLD)
-            {
-                // Reset spin count and go to sleep until event is fired.
-                context->total_spin_count += context->spin_count;
-                context->spin_count = 0;
-                oe_host_worker_wait(context);
-            }
+/* The time to spin given the average gap between calls */
+static uint64_t _get_spin_ns(
+    uint64_t min_spin_ns,
+    uint64_t max_spin_ns,
+    uint64_t average_gap_ns)
+{
+    if (average_gap_ns > max_spin_ns || 2 * average_gap_ns < min_spin_ns)
+        return min_spin_ns;
 
-            /* Yield CPU */
-            oe_yield_cpu();
-        }
-    }
-    return NULL;
+    if (2 * average_gap_ns > max_spin_ns)
+        return max_spin_ns;
+
+    return 2 * average_gap_ns;
 }
 
-void oe_sgx_sleep_switchless_worker_ocall(oe_enclave_worker_context_t* context)
+/* The number of pause instructions an enclave worker spins */
+static uint64_t _get_enclave_worker_spin_count(
+    oe_switchless_call_manager_t* manager)
 {
-    // Wait for messages.
-    oe_enclave_worker_wait(context);
+    uint64_t spin_ns = _get_spin_ns(
+        manager->min_spin_ns,
+        manager->max_spin_ns,
+        manager->average_ecall_gap_ns);
+    uint64_t spin_count = spin_ns / 1000 * manager->pauses_per_us +
+                          spin_ns % 1000 * manager->pauses_per_us / 1000;
+
+    return spin_count ? spin_count : 1;
+}
+
+/* Measure how many pause instructions this processor executes per
+ * microsecond */
+static uint64_t _count_pauses_per_us(void)
+{
+    const uint64_t pauses = 4096;
+    uint64_t start = oe_get_monotonic_time_ns();
+    uint64_t elapsed_ns;
+    uint64_t pauses_per_us;
+
+    for (uint64_t i = 0; i < pauses; i++)
+        oe_yield_cpu();
+
+    elapsed_ns = oe_get_monotonic_time_ns() - start;
+    pauses_per_us = elapsed_ns ? pauses * 1000 / elapsed_ns : pauses;
+
+    return pauses_per_us ? pauses_per_us : 1;
+}
+
+/* Copy the CPUs of a setting, which need not outlive oe_create_enclave() */
+static oe_result_t _copy_cpus(
+    const uint32_t* cpus,
+    size_t num_cpus,
+    uint32_t** copy)
+{
+    *copy = NULL;
+
+    if (num_cpus == 0)
+        return OE_OK;
+
+    if (!cpus || num_cpus > OE_SIZE_MAX / sizeof(uint32_t))
+        return OE_INVALID_PARAMETER;
+
+    if (!(*copy = malloc(num_cpus * sizeof(uint32_t))))
+        return OE_OUT_OF_MEMORY;
+
+    memcpy(*copy, cpus, num_cpus * sizeof(uint32_t));
+    return OE_OK;
+}
+
+/* Pin the worker with the given index to the next CPU of the list, if any */
+static void _pin_worker(
+    oe_thread_t thread,
+    const uint32_t* cpus,
+    size_t num_cpus,
+    size_t index)
+{
+    uint32_t cpu;
+
+    if (num_cpus == 0)
+        return;
+
+    cpu = cpus[index % num_cpus];
+
+    // A worker that cannot be pinned, e.g. to an offline CPU, still works.
+    if (oe_thread_set_affinity(thread, cpu) != 0)
+        OE_TRACE_WARNING(
+            "Cannot pin switchless worker %d to CPU %u\n", (int)index, cpu);
+}
+
+/* Allocate zeroed memory that starts on a cache line. Free it with
+ * oe_memalign_free(). */
+static void* _calloc_cache_aligned(size_t count, size_t size)
+{
+    void* ptr;
+
+    if (size && count > OE_SIZE_MAX / size)
+        return NULL;
+
+    // Keep the pointer unique for empty arrays, like calloc.
+    size *= count;
+    if (size == 0)
+        size = OE_SWITCHLESS_CACHE_LINE_SIZE;
+
+    if ((ptr = oe_memalign(OE_SWITCHLESS_CACHE_LINE_SIZE, size)))
+        memset(ptr, 0, size);
+
+    return ptr;
 }
 
 /*
-** The thread function that handles switchless ecalls
+** Allocate a ring that holds at least min_capacity pending calls.
 **
 */
-static void* _switchless_ecall_worker(void* arg)
+static oe_switchless_ring_t* _create_ring(size_t min_capacity)
 {
-    oe_enclave_worker_context_t* context = (oe_enclave_worker_context_t*)arg;
+    oe_switchless_ring_t* ring = NULL;
+    uint64_t capacity = OE_SWITCHLESS_RING_MIN_CAPACITY;
 
-    // Enter enclave to process ecall messages.
-    if (oe_sgx_switchless_enclave_worker_thread_ecall(context->enc, context) !=
-        OE_OK)
+    while (capacity < min_capacity)
+        capacity <<= 1;
+
+    if (!(ring = _calloc_cache_aligned(1, sizeof(oe_switchless_ring_t))))
+        return NULL;
+
+    if (!(ring->slots = _calloc_cache_aligned(
+              capacity, sizeof(oe_switchless_ring_slot_t))))
     {
-        OE_TRACE_ERROR("Switchless enclave worker thread failed\n");
+        oe_memalign_free(ring);
+        return NULL;
     }
 
-    return NULL;
+    // Slot i is ready to be filled at position i.
+    for (uint64_t i = 0; i < capacity; i++)
+        ring->slots[i].sequence = i;
+
+    ring->capacity = capacity;
+    return ring;
 }
 
-static oe_result_t oe_stop_worker_threads(oe_switchless_call_manager_t* manager)
+static void _destroy_ring(oe_switchless_ring_t* ring)
 {
-    oe_result_t result = OE_UNEXPECTED;
-    for (size_t i = 0; i < manager->num_host_workers; i++)
-    {
-        manager->host_worker_contexts[i].is_stopping = true;
-        oe_host_worker_wake(&manager->host_worker_contexts[i]);
-
-        OE_TRACE_INFO(
-            "Switchless host worker thread %d spun for %lu times",
-            (int)i,
-            manager->host_worker_contexts[i].total_spin_count);
-    }
-    for (size_t i = 0; i < manager->num_enclave_workers; i++)
+    if (ring)
     {
-        manager->enclave_worker_contexts[i].is_stopping = true;
-        oe_enclave_worker_wake(&manager->enclave_worker_contexts[i]);
+        oe_memalign_free(ring->slots);
+        oe_memalign_free(ring);
     }
+}
 
-    for (size_t i = 0; i < manager->num_host_workers; i++)
-    {
-        if (manager->host_worker_threads[i] != (oe_thread_t)NULL)
-            if (oe_thread_join(manager->host_worker_threads[i]))
-                OE_RAISE(OE_THREAD_JOIN_ERROR);
-    }
+/* Empty the ring for reuse. Nobody may push or pop while it runs. */
+static void _reset_ring(oe_switchless_ring_t* ring)
+{
+    for (uint64_t i = 0; i < ring->capacity; i++)
+        ring->slots[i].sequence = i;
 
-    for (size_t i = 0; i < manager->num_enclave_workers; i++)
-    {
-        if (manager->enclave_worker_threads[i] != (oe_thread_t)NULL)
-            if (oe_thread_join(manager->enclave_worker_threads[i]))
-                OE_RAISE(OE_THREAD_JOIN_ERROR);
-    }
+    ring->misses = 0;
+    ring->head = 0;
+    ring->tail = 0;
+}
 
-    result = OE_OK;
-done:
-    return result;
+/* Whether a call may be waiting in the ring. Only reads its head and tail,
+ * so looking at an idle ring writes no shared memory. */
+OE_INLINE bool _ring_has_calls(oe_switchless_ring_t* ring)
+{
+    return oe_atomic_load(&ring->head) != oe_atomic_load(&ring->tail);
 }
 
-oe_result_t oe_start_switchless_manager(
-    oe_enclave_t* enclave,
-    size_t num_host_workers,
-    size_t num_enclave_workers)
+/*
+**==============================================================================
+**
+** Shared host worker pool:
+**
+**     Enclaves created with share_host_workers set do not start host workers
+**     of their own. Their switchless ocalls are served by one process-wide
+**     pool, started by the first such enclave and stopped with the last one.
+**     Each member enclave keeps its own ring, and every enclave is given the
+**     contexts of the pool's workers so that it can wake any of them.
+**
+**     A worker looks at the rings of the members in turn, starting after the
+**     member whose call it handled last, and takes one call at a time, so
+**     busy enclaves cannot starve the others. The time the workers spend in
+**     the calls of each member is accounted to it.
+**
+**     Member slots and their rings are never freed while the pool exists,
+**     so a worker may look at the head and tail of any ring without
+**     holding a reference; it only takes one for a ring with calls. It
+**     announces itself in the users count of the member before it looks at
+**     the active flag, and an enclave that leaves clears the flag and waits
+**     for the users to drain. The next enclave in the slot reuses the ring,
+**     or retires it to the pool if it needs a larger one.
+**
+**==============================================================================
+*/
+
+/**
+ * Max number of enclaves that can share the host worker pool
+ */
+#define OE_SWITCHLESS_POOL_MAX_MEMBERS (64U)
+
+struct _oe_switchless_pool_member
 {
-    oe_result_t result = OE_UNEXPECTED;
-    oe_result_t result_out = 0;
-    oe_switchless_call_manager_t* manager = NULL;
-    oe_host_worker_context_t* host_contexts = NULL;
-    oe_thread_t* host_threads = NULL;
-    oe_enclave_worker_context_t* enclave_contexts = NULL;
-    oe_thread_t* enclave_threads = NULL;
+    /* 1 while workers may take calls from the ring */
+    volatile uint64_t active;
 
-    if (enclave == NULL)
-        OE_RAISE(OE_INVALID_PARAMETER);
+    /* Number of workers looking at the ring or handling one of its calls */
+    volatile uint64_t users;
 
-    if (enclave->switchless_manager != NULL)
-        OE_RAISE(OE_UNEXPECTED);
+    /* Whether the slot is taken, guarded by the pool lock */
+    bool in_use;
 
-    if (num_host_workers == 0 && num_enclave_workers == 0)
-        OE_RAISE(OE_UNEXPECTED);
+    oe_enclave_t* enclave;
 
-    // Limit the number of workers to the number of thread bindings
-    // because the maximum parallelism is dictated by the latter for
-    // synchronous ocalls. We may need to revisit this for asynchronous
-    // calls later.
-    if (num_host_workers > enclave->num_bindings)
-        num_host_workers = (uint32_t)enclave->num_bindings;
+    /* Kept when the enclave leaves, replaced only while inactive */
+    oe_switchless_ring_t* volatile ring;
 
-    if (num_enclave_workers > enclave->num_bindings)
-        num_enclave_workers = (uint32_t)enclave->num_bindings;
+    /* Accounting */
+    volatile uint64_t num_calls;
+    volatile uint64_t busy_time_ns;
+};
 
-    // Allocate memory for the manager and its arrays
-    manager = calloc(1, sizeof(oe_switchless_call_manager_t));
-    if (manager == NULL)
-        OE_RAISE(OE_OUT_OF_MEMORY);
+/* A ring that its member slot outgrew. Workers may still be looking at it, so
+ * it lives as long as the pool. */
+typedef struct _oe_switchless_retired_ring
+{
+    oe_switchless_ring_t* ring;
+    struct _oe_switchless_retired_ring* next;
+} oe_switchless_retired_ring_t;
 
-    host_contexts = calloc(num_host_workers, sizeof(oe_host_worker_context_t));
-    if (host_contexts == NULL)
-        OE_RAISE(OE_OUT_OF_MEMORY);
+typedef struct _oe_switchless_pool
+{
+    oe_host_worker_context_t* contexts;
+    oe_switchless_worker_counters_t* counters;
+    oe_thread_t* threads;
+    size_t num_workers;
 
-    host_threads = calloc(num_host_workers, sizeof(oe_thread_t));
-    if (host_threads == NULL)
-        OE_RAISE(OE_OUT_OF_MEMORY);
+    uint64_t min_spin_ns;
+    uint64_t max_spin_ns;
 
-    enclave_contexts =
-        calloc(num_enclave_workers, sizeof(oe_enclave_worker_context_t));
-    if (enclave_contexts == NULL)
-        OE_RAISE(OE_OUT_OF_MEMORY);
+    /* Number of member enclaves, guarded by the pool lock */
+    size_t num_references;
 
-    enclave_threads = calloc(num_enclave_workers, sizeof(oe_thread_t));
-    if (enclave_threads == NULL)
-        OE_RAISE(OE_OUT_OF_MEMORY);
+    /* Number of slots ever used; workers look at this many */
+    volatile size_t num_members;
+    oe_switchless_pool_member_t members[OE_SWITCHLESS_POOL_MAX_MEMBERS];
 
-    manager->num_host_workers = num_host_workers;
-    manager->host_worker_contexts = host_contexts;
-    manager->host_worker_threads = host_threads;
-    manager->num_enclave_workers = num_enclave_workers;
-    manager->enclave_worker_contexts = enclave_contexts;
-    manager->enclave_worker_threads = enclave_threads;
+    /* Guarded by the pool lock */
+    oe_switchless_retired_ring_t* retired_rings;
+} oe_switchless_pool_t;
 
-    // Start the host worker threads, and assign each one a private context.
-    for (size_t i = 0; i < num_host_workers; i++)
-    {
-        OE_TRACE_INFO("Creating switchless host worker thread %d\n", (int)i);
-        manager->host_worker_contexts[i].enc = enclave;
-        if (oe_thread_create(
-                &manager->host_worker_threads[i],
-                _switchless_ocall_worker,
-                &manager->host_worker_contexts[i]) != 0)
-        {
-            OE_RAISE(OE_THREAD_CREATE_ERROR);
-        }
-    }
+static oe_mutex _pool_lock = OE_H_MUTEX_INITIALIZER;
+static oe_switchless_pool_t* _pool;
 
-    // Inform the enclave about the switchless manager through an ECALL
-    if (num_host_workers > 0)
-    {
-        OE_CHECK(oe_sgx_init_context_switchless_ecall(
-            enclave,
-            &result_out,
-            manager->host_worker_contexts,
-            manager->num_host_workers));
-        OE_CHECK(result_out);
-    }
+/* Take a call from the next member with one, in turn. On success, the member
+ * stays in use until _put_shared_ocall(). */
+static oe_call_host_function_args_t* _take_shared_ocall(
+    oe_switchless_pool_t* pool,
+    size_t* next_member,
+    oe_switchless_pool_member_t** member_out)
+{
+    size_t num_members = pool->num_members;
 
-    // Start the enclave worker threads, and assign each one a private context.
-    // ecall worker threads are initialized after the regular ecall above to
-    // oe_sgx_init_context_switchless_ecall is complete.
-    for (size_t i = 0; i < num_enclave_workers; i++)
+    for (size_t k = 0; k < num_members; k++)
     {
-        OE_TRACE_INFO("Creating switchless enclave worker thread %d\n", (int)i);
-        manager->enclave_worker_contexts[i].enc = enclave;
-        manager->enclave_worker_contexts[i].spin_count_threshold =
-            OE_ENCLAVE_WORKER_SPIN_COUNT_THRESHOLD;
-        if (oe_thread_create(
-                &manager->enclave_worker_threads[i],
-                _switchless_ecall_worker,
-                &manager->enclave_worker_contexts[i]) != 0)
+        size_t index = (*next_member + k) % num_members;
+        oe_switchless_pool_member_t* member = &pool->members[index];
+        oe_switchless_ring_t* ring = member->ring;
+        void* call_arg = NULL;
+
+        // Skip idle rings without writing to the member.
+        if (!member->active || !ring || !_ring_has_calls(ring))
+            continue;
+
+        oe_atomic_increment(&member->users);
+
+        // The slot may have changed hands since; look at its ring again.
+        if (oe_atomic_load(&member->active))
         {
-            OE_RAISE(OE_THREAD_CREATE_ERROR);
+            ring = member->ring;
+            call_arg =
+                oe_switchless_ring_pop(ring, ring->slots, ring->capacity - 1);
         }
 
-        // Wait until the enclave worker thread has started.
-        // If so, spin_count and/or total_spin_count will be non zero.
-        // This ensures that each ecall worker thread has a dedicated tcs.
-        volatile oe_enclave_worker_context_t* ctx =
-            &manager->enclave_worker_contexts[i];
-        while (!ctx->spin_count && !ctx->total_spin_count)
+        if (call_arg)
         {
-            oe_yield_cpu();
+            *next_member = index + 1;
+            *member_out = member;
+            return (oe_call_host_function_args_t*)call_arg;
         }
-    }
-
-    // Each enclave has at most one switchless manager.
-    enclave->switchless_manager = manager;
-
-    result = OE_OK;
 
-done:
-    if (result == OE_UNSUPPORTED)
-        OE_TRACE_WARNING(
-            "Switchless call is not supported. To enable, please add \n\n"
-            "from \"openenclave/edl/sgx/switchless.edl\" import *;\n\n"
-            "in the edl file.\n");
-
-    if (result != OE_OK)
-    {
-        oe_stop_switchless_manager(enclave);
+        oe_atomic_decrement(&member->users);
     }
 
-    return result;
+    return NULL;
 }
 
-oe_result_t oe_stop_switchless_manager(oe_enclave_t* enclave)
+static void _put_shared_ocall(
+    oe_switchless_pool_member_t* member,
+    uint64_t busy_time_ns)
+{
+    oe_atomic_increment(&member->num_calls);
+    oe_atomic_add(&member->busy_time_ns, busy_time_ns);
+    oe_atomic_decrement(&member->users);
+}
+
+/* The statistics of the host worker with the given context, or NULL */
+static oe_switchless_worker_counters_t* _get_host_worker_counters(
+    oe_host_worker_context_t* context)
 {
-    oe_result_t result = OE_UNEXPECTED;
     oe_switchless_call_manager_t* manager = NULL;
-    if (enclave != NULL && enclave->switchless_manager != NULL)
+    oe_host_worker_context_t* contexts = NULL;
+    oe_switchless_worker_counters_t* counters = NULL;
+    size_t num_workers = 0;
+
+    // Workers of the shared pool have no enclave of their own.
+    if (context->enc)
     {
-        OE_CHECK(oe_stop_worker_threads(enclave->switchless_manager));
+        manager = context->enc->switchless_manager;
+        contexts = manager->host_worker_contexts;
+        counters = manager->host_worker_counters;
+        num_workers = manager->num_host_workers;
+    }
+    else if (_pool)
+    {
+        contexts = _pool->contexts;
+        counters = _pool->counters;
+        num_workers = _pool->num_workers;
+    }
 
-        manager = enclave->switchless_manager;
-        enclave->switchless_manager = NULL;
+    if (!counters || context < contexts || context >= contexts + num_workers)
+        return NULL;
 
-        // Free all allocated buffers.
-        if (manager->host_worker_contexts != NULL)
-            free(manager->host_worker_contexts);
-        if (manager->host_worker_threads != NULL)
-            free(manager->host_worker_threads);
-        if (manager->enclave_worker_contexts != NULL)
-            free(manager->enclave_worker_contexts);
-        if (manager->enclave_worker_threads != NULL)
-            free(manager->enclave_worker_threads);
-        free(manager);
-    }
-    result = OE_OK;
-done:
-    return result;
+    return &counters[context - contexts];
 }
 
-void oe_sgx_wake_switchless_worker_ocall(oe_host_worker_context_t* context)
+/* Wake the enclave thread parked on a completed call, if any. The
+ * compare-and-swap is a full barrier between setting the result and reading
+ * the flag, see oe_wait_switchless_ocall() in the enclave. */
+static void _wake_parked_caller(oe_call_host_function_args_t* args)
 {
-    oe_host_worker_wake(context);
+    if (oe_atomic_compare_and_swap_32(&args->parked, 1, 0))
+        oe_thread_wake_address(&args->parked);
 }
 
 /*
-**==============================================================================
-**
-** _switchless_call_enclave_function_impl()
-**
-** Switchlessly call the enclave function specified by the given function-id.
+** The thread function that handles switchless ocalls
 **
-**==============================================================================
 */
-static oe_result_t _switchless_call_enclave_function_impl(
-    oe_enclave_t* enclave,
-    uint64_t function_id,
+static void* _switchless_ocall_worker(void* arg)
+{
+    oe_host_worker_context_t* context = (oe_host_worker_context_t*)arg;
+    oe_switchless_worker_counters_t* counters =
+        _get_host_worker_counters(context);
+    oe_switchless_call_manager_t* manager = NULL;
+    oe_switchless_pool_t* pool = NULL;
+    const uint64_t* min_spin_ns = NULL;
+    const uint64_t* max_spin_ns = NULL;
+    size_t next_member = 0;
+    uint64_t average_gap_ns = 0;
+    uint64_t idle_start = oe_get_monotonic_time_ns();
+    uint64_t spin_start = idle_start;
+    uint64_t pauses = 1;
+
+    // Workers of the shared pool have no enclave of their own.
+    if (context->enc)
+    {
+        manager = context->enc->switchless_manager;
+        min_spin_ns = &manager->min_spin_ns;
+        max_spin_ns = &manager->max_spin_ns;
+    }
+    else
+    {
+        pool = _pool;
+        min_spin_ns = &pool->min_spin_ns;
+        max_spin_ns = &pool->max_spin_ns;
+    }
+
+    while (!context->is_stopping)
+    {
+        oe_call_host_function_args_t* local_call_arg = NULL;
+        oe_switchless_pool_member_t* member = NULL;
+        oe_enclave_t* enclave = context->enc;
+        uint64_t now;
+
+        if (pool)
+        {
+            if ((local_call_arg =
+                     _take_shared_ocall(pool, &next_member, &member)))
+                enclave = member->enclave;
+        }
+        else
+        {
+            oe_switchless_ring_t* ring = manager->host_worker_ring;
+            local_call_arg =
+                (oe_call_host_function_args_t*)oe_switchless_ring_pop(
+                    ring, ring->slots, ring->capacity - 1);
+        }
+
+        if (local_call_arg)
+        {
+            now = oe_get_monotonic_time_ns();
+            _update_average_gap(
+                &average_gap_ns, now - idle_start, *max_spin_ns);
+
+            // Publish the call being handled for diagnostics.
+            context->call_arg = local_call_arg;
+
+            // The enclave waits for the result to change. Report calls that
+            // were rejected too.
+            oe_result_t result = oe_handle_call_host_function(
+                (uint64_t)local_call_arg, enclave, true);
+            if (result != OE_OK)
+            {
+                OE_ATOMIC_MEMORY_BARRIER_RELEASE();
+                local_call_arg->result = result;
+            }
+
+            _wake_parked_caller(local_call_arg);
+            context->call_arg = NULL;
+
+            // Reset spin count for next message.
+            context->total_spin_count += context->spin_count;
+            context->spin_count = 0;
+            pauses = 1;
+            idle_start = spin_start = oe_get_monotonic_time_ns();
+
+            counters->num_calls++;
+            counters->busy_time_ns += idle_start - now;
+
+            if (member)
+                _put_shared_ocall(member, idle_start - now);
+        }
+        else
+        {
+            // If there is no message, spin until the spin time is up.
+            now = oe_get_monotonic_time_ns();
+            if (now - spin_start >=
+                _get_spin_ns(*min_spin_ns, *max_spin_ns, average_gap_ns))
+            {
+                // Reset spin count and go to sleep until event is fired.
+                context->total_spin_count += context->spin_count;
+                context->spin_count = 0;
+                counters->num_sleeps++;
+                oe_host_worker_wait(context);
+
+                pauses = 1;
+                spin_start = oe_get_monotonic_time_ns();
+                counters->sleep_time_ns += spin_start - now;
+                continue;
+            }
+
+            /* Yield CPU, backing off exponentially */
+            for (uint64_t i = 0; i < pauses; i++)
+                oe_yield_cpu();
+
+            context->spin_count += pauses;
+            if (pauses < OE_SWITCHLESS_MAX_BACKOFF_PAUSES)
+                pauses *= 2;
+        }
+    }
+    return NULL;
+}
+
+/* Stop the workers of the shared pool and free it. Called with the pool lock
+ * held, once the last member has left. */
+static void _destroy_shared_pool(oe_switchless_pool_t* pool)
+{
+    for (size_t i = 0; i < pool->num_workers; i++)
+    {
+        pool->contexts[i].is_stopping = true;
+        oe_host_worker_wake(&pool->contexts[i]);
+    }
+
+    for (size_t i = 0; i < pool->num_workers; i++)
+    {
+        if (pool->threads[i] != (oe_thread_t)NULL)
+            oe_thread_join(pool->threads[i]);
+    }
+
+    for (size_t i = 0; i < OE_SWITCHLESS_POOL_MAX_MEMBERS; i++)
+        _destroy_ring(pool->members[i].ring);
+
+    while (pool->retired_rings)
+    {
+        oe_switchless_retired_ring_t* retired = pool->retired_rings;
+        pool->retired_rings = retired->next;
+        _destroy_ring(retired->ring);
+        free(retired);
+    }
+
+    oe_memalign_free(pool->contexts);
+    oe_memalign_free(pool->counters);
+    free(pool->threads);
+    free(pool);
+}
+
+/* Start the shared pool with the given number of workers, pinned to the
+ * given CPUs if any. Called with the pool lock held. */
+static oe_result_t _create_shared_pool(
+    size_t num_workers,
+    const uint32_t* cpus,
+    size_t num_cpus)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_switchless_pool_t* pool = NULL;
+
+    if (!(pool = calloc(1, sizeof(oe_switchless_pool_t))))
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    if (!(pool->contexts = _calloc_cache_aligned(
+              num_workers, sizeof(*pool->contexts))) ||
+        !(pool->counters = _calloc_cache_aligned(
+              num_workers, sizeof(*pool->counters))) ||
+        !(pool->threads = calloc(num_workers, sizeof(*pool->threads))))
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    pool->num_workers = num_workers;
+    pool->min_spin_ns = OE_SWITCHLESS_DEFAULT_MIN_SPIN_NS;
+    pool->max_spin_ns = OE_SWITCHLESS_DEFAULT_MAX_SPIN_NS;
+    _pool = pool;
+
+    for (size_t i = 0; i < num_workers; i++)
+    {
+        OE_TRACE_INFO("Creating shared switchless host worker %d\n", (int)i);
+
+        if (oe_thread_create(
+                &pool->threads[i],
+                _switchless_ocall_worker,
+                &pool->contexts[i]))
+        {
+            pool->threads[i] = (oe_thread_t)NULL;
+            OE_RAISE(OE_THREAD_CREATE_ERROR);
+        }
+
+        _pin_worker(pool->threads[i], cpus, num_cpus, i);
+    }
+
+    pool = NULL;
+    result = OE_OK;
+
+done:
+    if (pool)
+    {
+        _pool = NULL;
+
+        if (pool->contexts && pool->counters && pool->threads)
+            _destroy_shared_pool(pool);
+        else
+        {
+            oe_memalign_free(pool->contexts);
+            oe_memalign_free(pool->counters);
+            free(pool->threads);
+            free(pool);
+        }
+    }
+
+    return result;
+}
+
+/* Join the shared pool, starting it if needed, and fill in the host worker
+ * part of the manager */
+static oe_result_t _join_shared_pool(
+    oe_enclave_t* enclave,
+    oe_switchless_call_manager_t* manager,
+    size_t num_workers)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_switchless_pool_member_t* member = NULL;
+    oe_switchless_ring_t* ring = NULL;
+    oe_switchless_retired_ring_t* retired = NULL;
+
+    oe_mutex_lock(&_pool_lock);
+
+    if (!_pool)
+        OE_CHECK(_create_shared_pool(
+            num_workers,
+            manager->host_worker_cpus,
+            manager->num_host_worker_cpus));
+
+    for (size_t i = 0; i < OE_SWITCHLESS_POOL_MAX_MEMBERS; i++)
+    {
+        if (!_pool->members[i].in_use)
+        {
+            member = &_pool->members[i];
+            break;
+        }
+    }
+
+    if (!member)
+        OE_RAISE(OE_BUSY);
+
+    // Reuse the ring of the slot if it is large enough. Otherwise retire it,
+    // since workers may still be looking at it.
+    ring = member->ring;
+
+    if (ring && ring->capacity >= 2 * enclave->num_bindings)
+        _reset_ring(ring);
+    else
+    {
+        if (ring && !(retired = malloc(sizeof(*retired))))
+            OE_RAISE(OE_OUT_OF_MEMORY);
+
+        if (!(ring = _create_ring(2 * enclave->num_bindings)))
+        {
+            free(retired);
+            OE_RAISE(OE_OUT_OF_MEMORY);
+        }
+
+        if (retired)
+        {
+            retired->ring = member->ring;
+            retired->next = _pool->retired_rings;
+            _pool->retired_rings = retired;
+        }
+
+        member->ring = ring;
+    }
+
+    member->in_use = true;
+    member->enclave = enclave;
+    member->num_calls = 0;
+    member->busy_time_ns = 0;
+
+    if ((size_t)(member - _pool->members) >= _pool->num_members)
+        _pool->num_members = (size_t)(member - _pool->members) + 1;
+
+    // Publish the ring before the workers may look at it.
+    oe_atomic_compare_and_swap((int64_t*)&member->active, 0, 1);
+    _pool->num_references++;
+
+    manager->host_worker_contexts = _pool->contexts;
+    manager->num_host_workers = _pool->num_workers;
+    manager->min_host_workers = _pool->num_workers;
+    manager->num_active_host_workers = _pool->num_workers;
+    manager->host_worker_ring = ring;
+    manager->host_worker_pool_member = member;
+
+    result = OE_OK;
+
+done:
+    if (result != OE_OK && _pool && !_pool->num_references)
+    {
+        _destroy_shared_pool(_pool);
+        _pool = NULL;
+    }
+
+    oe_mutex_unlock(&_pool_lock);
+    return result;
+}
+
+/* Leave the shared pool, stopping it after the last member */
+static void _leave_shared_pool(oe_switchless_call_manager_t* manager)
+{
+    oe_switchless_pool_member_t* member = manager->host_worker_pool_member;
+
+    oe_mutex_lock(&_pool_lock);
+
+    // Keep workers away from the ring, then wait for those that already
+    // looked at it.
+    oe_atomic_compare_and_swap((int64_t*)&member->active, 1, 0);
+
+    while (oe_atomic_load(&member->users))
+        oe_yield_cpu();
+
+    // The ring stays with the slot; workers may still look at it.
+    member->enclave = NULL;
+    member->in_use = false;
+
+    manager->host_worker_contexts = NULL;
+    manager->host_worker_ring = NULL;
+    manager->host_worker_pool_member = NULL;
+    manager->num_host_workers = 0;
+
+    if (--_pool->num_references == 0)
+    {
+        _destroy_shared_pool(_pool);
+        _pool = NULL;
+    }
+
+    oe_mutex_unlock(&_pool_lock);
+}
+
+void oe_sgx_sleep_switchless_worker_ocall(oe_enclave_worker_context_t* context)
+{
+    oe_switchless_call_manager_t* manager = context->enc->switchless_manager;
+    size_t index = (size_t)(context - manager->enclave_worker_contexts);
+    oe_switchless_worker_counters_t* counters = NULL;
+    uint64_t start = oe_get_monotonic_time_ns();
+
+    // Let the spin count follow the calls seen so far.
+    context->spin_count_threshold = _get_enclave_worker_spin_count(manager);
+
+    // Wait for messages.
+    oe_enclave_worker_wait(context);
+
+    if (index < manager->num_enclave_workers)
+    {
+        counters = &manager->enclave_worker_counters[index];
+        counters->num_sleeps++;
+        counters->sleep_time_ns += oe_get_monotonic_time_ns() - start;
+    }
+}
+
+/*
+** Park an enclave thread until the host worker handling its switchless ocall
+** clears the parked flag. The enclave checks the result after the ocall
+** returns, so spurious wakes are harmless.
+*/
+void oe_sgx_wait_switchless_ocall_ocall(void* call_arg)
+{
+    oe_call_host_function_args_t* args =
+        (oe_call_host_function_args_t*)call_arg;
+
+    if (!args)
+        return;
+
+    while (*(volatile uint32_t*)&args->parked == 1)
+        oe_thread_wait_address(&args->parked, 1, OE_UINT64_MAX);
+}
+
+/*
+** The thread function that handles switchless ecalls
+**
+*/
+static void* _switchless_ecall_worker(void* arg)
+{
+    oe_enclave_worker_context_t* context = (oe_enclave_worker_context_t*)arg;
+
+    // Enter enclave to process ecall messages.
+    if (oe_sgx_switchless_enclave_worker_thread_ecall(
+            context->enc,
+            context,
+            context->enc->switchless_manager->enclave_worker_ring) != OE_OK)
+    {
+        OE_TRACE_ERROR("Switchless enclave worker thread failed\n");
+    }
+
+    return NULL;
+}
+
+/*
+**==============================================================================
+**
+** Elastic worker pools:
+**
+**     A pool whose min number of workers is below its max is elastic. Only
+**     the first num_active workers of the pool run. Every
+**     OE_SWITCHLESS_CONTROLLER_PERIOD_NS, the controller thread samples each
+**     elastic pool. It starts one more worker when calls have been waiting
+**     in the ring for OE_SWITCHLESS_GROW_PERIODS samples in a row, or when
+**     switchless ecalls missed. It retires the last worker when some worker
+**     has been idle for OE_SWITCHLESS_RETIRE_PERIODS samples in a row. An
+**     enclave worker that is retired returns from its ecall, which hands its
+**     TCS back to the enclave.
+**
+**     The event of a worker that is not running is kept at 1, so callers
+**     looking for a sleeping worker to wake pass over it.
+**
+**==============================================================================
+*/
+
+typedef struct _oe_switchless_pool_load
+{
+    /* Consecutive samples with calls waiting in the ring */
+    uint64_t queued_periods;
+
+    /* Consecutive samples with at least one idle worker */
+    uint64_t idle_periods;
+} oe_switchless_pool_load_t;
+
+/* Returns 1 to grow the pool, -1 to shrink it, or 0 */
+static int _sample_pool(
+    oe_switchless_pool_load_t* load,
+    oe_switchless_ring_t* ring,
+    bool missed,
+    size_t num_active,
+    size_t num_busy,
+    size_t min_workers,
+    size_t max_workers)
+{
+    uint64_t tail = oe_atomic_load(&ring->tail);
+    uint64_t head = oe_atomic_load(&ring->head);
+
+    if (head != tail || missed)
+    {
+        load->idle_periods = 0;
+
+        if (++load->queued_periods >= OE_SWITCHLESS_GROW_PERIODS || missed)
+        {
+            load->queued_periods = 0;
+            return num_active < max_workers ? 1 : 0;
+        }
+
+        return 0;
+    }
+
+    load->queued_periods = 0;
+
+    if (num_busy >= num_active)
+    {
+        load->idle_periods = 0;
+        return 0;
+    }
+
+    if (++load->idle_periods >= OE_SWITCHLESS_RETIRE_PERIODS)
+    {
+        load->idle_periods = 0;
+        return num_active > min_workers ? -1 : 0;
+    }
+
+    return 0;
+}
+
+static oe_result_t _start_host_worker(
+    oe_switchless_call_manager_t* manager,
+    size_t index)
+{
+    oe_host_worker_context_t* context = &manager->host_worker_contexts[index];
+
+    OE_TRACE_INFO("Creating switchless host worker thread %d\n", (int)index);
+    context->is_stopping = false;
+    context->spin_count = 0;
+
+    if (oe_thread_create(
+            &manager->host_worker_threads[index],
+            _switchless_ocall_worker,
+            context) != 0)
+    {
+        manager->host_worker_threads[index] = (oe_thread_t)NULL;
+        return OE_THREAD_CREATE_ERROR;
+    }
+
+    _pin_worker(
+        manager->host_worker_threads[index],
+        manager->host_worker_cpus,
+        manager->num_host_worker_cpus,
+        index);
+
+    return OE_OK;
+}
+
+static oe_result_t _start_enclave_worker(
+    oe_switchless_call_manager_t* manager,
+    size_t index)
+{
+    oe_enclave_worker_context_t* context =
+        &manager->enclave_worker_contexts[index];
+
+    OE_TRACE_INFO("Creating switchless enclave worker thread %d\n", (int)index);
+    context->is_stopping = false;
+    context->spin_count = 0;
+    context->spin_count_threshold = _get_enclave_worker_spin_count(manager);
+
+    if (oe_thread_create(
+            &manager->enclave_worker_threads[index],
+            _switchless_ecall_worker,
+            context) != 0)
+    {
+        manager->enclave_worker_threads[index] = (oe_thread_t)NULL;
+        return OE_THREAD_CREATE_ERROR;
+    }
+
+    _pin_worker(
+        manager->enclave_worker_threads[index],
+        manager->enclave_worker_cpus,
+        manager->num_enclave_worker_cpus,
+        index);
+
+    return OE_OK;
+}
+
+/* Stop the last running host worker of an elastic pool */
+static void _retire_host_worker(oe_switchless_call_manager_t* manager)
+{
+    size_t index = manager->num_active_host_workers - 1;
+    oe_host_worker_context_t* context = &manager->host_worker_contexts[index];
+
+    manager->num_active_host_workers = index;
+
+    context->is_stopping = true;
+    oe_host_worker_wake(context);
+    oe_thread_join(manager->host_worker_threads[index]);
+    manager->host_worker_threads[index] = (oe_thread_t)NULL;
+
+    // Keep callers from picking the stopped worker to wake. A caller may
+    // have picked it while it was stopping, so make sure that a running
+    // worker looks at the ring.
+    OE_ATOMIC_MEMORY_BARRIER_RELEASE();
+    *(volatile int32_t*)&context->event = 1;
+    oe_host_worker_wake(&manager->host_worker_contexts[0]);
+
+    OE_TRACE_INFO("Retired switchless host worker thread %d\n", (int)index);
+}
+
+/* Stop the last running enclave worker of an elastic pool */
+static void _retire_enclave_worker(oe_switchless_call_manager_t* manager)
+{
+    size_t index = manager->num_active_enclave_workers - 1;
+    oe_enclave_worker_context_t* context =
+        &manager->enclave_worker_contexts[index];
+
+    manager->num_active_enclave_workers = index;
+
+    // The worker returns from its ecall, which releases its TCS.
+    context->is_stopping = true;
+    oe_enclave_worker_wake(context);
+    oe_thread_join(manager->enclave_worker_threads[index]);
+    manager->enclave_worker_threads[index] = (oe_thread_t)NULL;
+
+    OE_ATOMIC_MEMORY_BARRIER_RELEASE();
+    *(volatile int32_t*)&context->event = 1;
+    oe_enclave_worker_wake(&manager->enclave_worker_contexts[0]);
+
+    OE_TRACE_INFO("Retired switchless enclave worker thread %d\n", (int)index);
+}
+
+/*
+** The thread function that resizes elastic pools
+**
+*/
+static void* _switchless_controller(void* arg)
+{
+    oe_switchless_call_manager_t* manager = (oe_switchless_call_manager_t*)arg;
+    oe_switchless_pool_load_t host_load = {0, 0};
+    oe_switchless_pool_load_t enclave_load = {0, 0};
+    uint64_t ecall_misses = manager->ecall_misses;
+
+    while (!manager->controller_stopping)
+    {
+        oe_thread_wait_address(
+            &manager->controller_stopping,
+            0,
+            OE_SWITCHLESS_CONTROLLER_PERIOD_NS);
+
+        if (manager->controller_stopping)
+            break;
+
+        if (manager->min_host_workers < manager->num_host_workers)
+        {
+            size_t num_active = manager->num_active_host_workers;
+            size_t num_busy = 0;
+
+            for (size_t i = 0; i < num_active; i++)
+                if (manager->host_worker_contexts[i].call_arg)
+                    num_busy++;
+
+            switch (_sample_pool(
+                &host_load,
+                manager->host_worker_ring,
+                false,
+                num_active,
+                num_busy,
+                manager->min_host_workers,
+                manager->num_host_workers))
+            {
+                case 1:
+                    if (_start_host_worker(manager, num_active) == OE_OK)
+                        manager->num_active_host_workers = num_active + 1;
+                    break;
+                case -1:
+                    _retire_host_worker(manager);
+                    break;
+            }
+        }
+
+        if (manager->min_enclave_workers < manager->num_enclave_workers)
+        {
+            size_t num_active = manager->num_active_enclave_workers;
+            size_t num_busy = 0;
+            uint64_t misses = manager->ecall_misses;
+
+            for (size_t i = 0; i < num_active; i++)
+                if (manager->enclave_worker_contexts[i].call_arg)
+                    num_busy++;
+
+            switch (_sample_pool(
+                &enclave_load,
+                manager->enclave_worker_ring,
+                misses != ecall_misses,
+                num_active,
+                num_busy,
+                manager->min_enclave_workers,
+                manager->num_enclave_workers))
+            {
+                case 1:
+                    if (_start_enclave_worker(manager, num_active) == OE_OK)
+                        manager->num_active_enclave_workers = num_active + 1;
+                    break;
+                case -1:
+                    _retire_enclave_worker(manager);
+                    break;
+            }
+
+            ecall_misses = misses;
+        }
+    }
+
+    return NULL;
+}
+
+static oe_result_t oe_stop_worker_threads(oe_switchless_call_manager_t* manager)
+{
+    oe_result_t result = OE_UNEXPECTED;
+
+    // Stop resizing the pools first.
+    if (manager->controller_thread != (oe_thread_t)NULL)
+    {
+        manager->controller_stopping = 1;
+        oe_thread_wake_address(&manager->controller_stopping);
+
+        if (oe_thread_join(manager->controller_thread))
+            OE_RAISE(OE_THREAD_JOIN_ERROR);
+
+        manager->controller_thread = (oe_thread_t)NULL;
+    }
+
+    // The workers of the shared pool keep serving the other enclaves.
+    if (manager->host_worker_pool_member)
+        _leave_shared_pool(manager);
+
+    for (size_t i = 0; i < manager->num_host_workers; i++)
+    {
+        manager->host_worker_contexts[i].is_stopping = true;
+        oe_host_worker_wake(&manager->host_worker_contexts[i]);
+
+        OE_TRACE_INFO(
+            "Switchless host worker thread %d spun for %lu times",
+            (int)i,
+            manager->host_worker_contexts[i].total_spin_count);
+    }
+    for (size_t i = 0; i < manager->num_enclave_workers; i++)
+    {
+        manager->enclave_worker_contexts[i].is_stopping = true;
+        oe_enclave_worker_wake(&manager->enclave_worker_contexts[i]);
+    }
+
+    for (size_t i = 0; i < manager->num_host_workers; i++)
+    {
+        if (manager->host_worker_threads[i] != (oe_thread_t)NULL)
+            if (oe_thread_join(manager->host_worker_threads[i]))
+                OE_RAISE(OE_THREAD_JOIN_ERROR);
+    }
+
+    for (size_t i = 0; i < manager->num_enclave_workers; i++)
+    {
+        if (manager->enclave_worker_threads[i] != (oe_thread_t)NULL)
+            if (oe_thread_join(manager->enclave_worker_threads[i]))
+                OE_RAISE(OE_THREAD_JOIN_ERROR);
+    }
+
+    result = OE_OK;
+done:
+    return result;
+}
+
+oe_result_t oe_start_switchless_manager(
+    oe_enclave_t* enclave,
+    const oe_enclave_setting_context_switchless_t* setting)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_result_t result_out = 0;
+    oe_switchless_call_manager_t* manager = NULL;
+    oe_host_worker_context_t* host_contexts = NULL;
+    oe_thread_t* host_threads = NULL;
+    oe_enclave_worker_context_t* enclave_contexts = NULL;
+    oe_thread_t* enclave_threads = NULL;
+    size_t num_host_workers = 0;
+    size_t num_enclave_workers = 0;
+    size_t min_host_workers = 0;
+    size_t min_enclave_workers = 0;
+    bool share_host_workers = false;
+
+    if (enclave == NULL || setting == NULL)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    num_host_workers = setting->max_host_workers;
+    num_enclave_workers = setting->max_enclave_workers;
+    min_host_workers = setting->min_host_workers;
+    min_enclave_workers = setting->min_enclave_workers;
+    share_host_workers = setting->share_host_workers && num_host_workers > 0;
+
+    if (enclave->switchless_manager != NULL)
+        OE_RAISE(OE_UNEXPECTED);
+
+    if (num_host_workers == 0 && num_enclave_workers == 0)
+        OE_RAISE(OE_UNEXPECTED);
+
+    // Limit the number of workers to the number of thread bindings
+    // because the maximum parallelism is dictated by the latter for
+    // synchronous ocalls. We may need to revisit this for asynchronous
+    // calls later. The shared pool serves several enclaves and is not
+    // limited by the bindings of one.
+    if (!share_host_workers && num_host_workers > enclave->num_bindings)
+        num_host_workers = (uint32_t)enclave->num_bindings;
+
+    if (num_enclave_workers > enclave->num_bindings)
+        num_enclave_workers = (uint32_t)enclave->num_bindings;
+
+    // A pool is elastic only if its min is non-zero and below its max. The
+    // shared pool is not elastic.
+    if (share_host_workers || min_host_workers == 0 ||
+        min_host_workers > num_host_workers)
+        min_host_workers = num_host_workers;
+
+    if (min_enclave_workers == 0 || min_enclave_workers > num_enclave_workers)
+        min_enclave_workers = num_enclave_workers;
+
+    // Allocate memory for the manager and its arrays
+    manager = calloc(1, sizeof(oe_switchless_call_manager_t));
+    if (manager == NULL)
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    if (!share_host_workers)
+    {
+        host_contexts = _calloc_cache_aligned(
+            num_host_workers, sizeof(oe_host_worker_context_t));
+        if (host_contexts == NULL)
+            OE_RAISE(OE_OUT_OF_MEMORY);
+
+        host_threads = calloc(num_host_workers, sizeof(oe_thread_t));
+        if (host_threads == NULL)
+            OE_RAISE(OE_OUT_OF_MEMORY);
+    }
+
+    enclave_contexts = _calloc_cache_aligned(
+        num_enclave_workers, sizeof(oe_enclave_worker_context_t));
+    if (enclave_contexts == NULL)
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    enclave_threads = calloc(num_enclave_workers, sizeof(oe_thread_t));
+    if (enclave_threads == NULL)
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    // The counters are owned by the manager from the start.
+    if ((!share_host_workers &&
+         !(manager->host_worker_counters = _calloc_cache_aligned(
+               num_host_workers, sizeof(oe_switchless_worker_counters_t)))) ||
+        !(manager->enclave_worker_counters = _calloc_cache_aligned(
+              num_enclave_workers, sizeof(oe_switchless_worker_counters_t))))
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    if (!share_host_workers)
+    {
+        manager->num_host_workers = num_host_workers;
+        manager->min_host_workers = min_host_workers;
+        manager->host_worker_contexts = host_contexts;
+        manager->host_worker_threads = host_threads;
+    }
+
+    manager->num_enclave_workers = num_enclave_workers;
+    manager->min_enclave_workers = min_enclave_workers;
+    manager->enclave_worker_contexts = enclave_contexts;
+    manager->enclave_worker_threads = enclave_threads;
+
+    // Workers that are not running keep their event at 1.
+    for (size_t i = 0; i < manager->num_host_workers; i++)
+    {
+        host_contexts[i].enc = enclave;
+        host_contexts[i].event = 1;
+    }
+
+    for (size_t i = 0; i < num_enclave_workers; i++)
+    {
+        enclave_contexts[i].enc = enclave;
+        enclave_contexts[i].event = 1;
+    }
+
+    // Every thread binding may have a synchronous call in flight, and
+    // asynchronous calls come on top of those.
+    if (manager->num_host_workers > 0 &&
+        !(manager->host_worker_ring = _create_ring(2 * enclave->num_bindings)))
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    if (num_enclave_workers > 0 &&
+        !(manager->enclave_worker_ring =
+              _create_ring(2 * enclave->num_bindings)))
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    OE_CHECK(_copy_cpus(
+        setting->host_worker_cpus,
+        setting->num_host_worker_cpus,
+        &manager->host_worker_cpus));
+    manager->num_host_worker_cpus = setting->num_host_worker_cpus;
+
+    OE_CHECK(_copy_cpus(
+        setting->enclave_worker_cpus,
+        setting->num_enclave_worker_cpus,
+        &manager->enclave_worker_cpus));
+    manager->num_enclave_worker_cpus = setting->num_enclave_worker_cpus;
+
+    // Every ocall starts with the route declared in the EDL.
+    if (num_host_workers > 0 && enclave->num_ocalls > 0)
+    {
+        manager->ocall_routes = calloc(enclave->num_ocalls, sizeof(uint8_t));
+        manager->requested_ocall_routes =
+            calloc(enclave->num_ocalls, sizeof(uint8_t));
+        manager->average_ocall_ns =
+            calloc(enclave->num_ocalls, sizeof(uint64_t));
+
+        if (!manager->ocall_routes || !manager->requested_ocall_routes ||
+            !manager->average_ocall_ns)
+            OE_RAISE(OE_OUT_OF_MEMORY);
+
+        manager->num_ocall_routes = enclave->num_ocalls;
+    }
+
+    manager->min_spin_ns = OE_SWITCHLESS_DEFAULT_MIN_SPIN_NS;
+    manager->max_spin_ns = OE_SWITCHLESS_DEFAULT_MAX_SPIN_NS;
+    manager->pauses_per_us = _count_pauses_per_us();
+
+    // Each enclave has at most one switchless manager. The workers find
+    // their ring through it, so publish it before they start.
+    enclave->switchless_manager = manager;
+
+    // Start the host worker threads, and assign each one a private context.
+    // Or let the shared pool serve the ocalls.
+    if (share_host_workers)
+    {
+        OE_CHECK(_join_shared_pool(enclave, manager, num_host_workers));
+    }
+    else
+    {
+        for (size_t i = 0; i < min_host_workers; i++)
+        {
+            OE_CHECK(_start_host_worker(manager, i));
+            manager->num_active_host_workers = i + 1;
+        }
+    }
+
+    // Inform the enclave about the switchless manager through an ECALL
+    if (num_host_workers > 0)
+    {
+        OE_CHECK(oe_sgx_init_context_switchless_ecall(
+            enclave,
+            &result_out,
+            OE_SWITCHLESS_LAYOUT_VERSION,
+            manager->host_worker_contexts,
+            manager->num_host_workers,
+            manager->host_worker_ring,
+            (uint8_t*)manager->ocall_routes,
+            manager->num_ocall_routes));
+        OE_CHECK(result_out);
+    }
+
+    // Start the enclave worker threads, and assign each one a private context.
+    // ecall worker threads are initialized after the regular ecall above to
+    // oe_sgx_init_context_switchless_ecall is complete.
+    for (size_t i = 0; i < min_enclave_workers; i++)
+    {
+        OE_CHECK(_start_enclave_worker(manager, i));
+        manager->num_active_enclave_workers = i + 1;
+
+        // Wait until the enclave worker thread has started.
+        // If so, spin_count and/or total_spin_count will be non zero.
+        // This ensures that each ecall worker thread has a dedicated tcs.
+        volatile oe_enclave_worker_context_t* ctx =
+            &manager->enclave_worker_contexts[i];
+        while (!ctx->spin_count && !ctx->total_spin_count)
+        {
+            oe_yield_cpu();
+        }
+    }
+
+    // Start the controller if a pool is elastic.
+    if (manager->min_host_workers < manager->num_host_workers ||
+        min_enclave_workers < num_enclave_workers)
+    {
+        if (oe_thread_create(
+                &manager->controller_thread, _switchless_controller, manager) !=
+            0)
+        {
+            manager->controller_thread = (oe_thread_t)NULL;
+            OE_RAISE(OE_THREAD_CREATE_ERROR);
+        }
+    }
+
+    result = OE_OK;
+
+done:
+    if (result == OE_UNSUPPORTED)
+        OE_TRACE_WARNING(
+            "Switchless call is not supported. To enable, please add \n\n"
+            "from \"openenclave/edl/sgx/switchless.edl\" import *;\n\n"
+            "in the edl file.\n");
+
+    if (result != OE_OK)
+    {
+        if (enclave && enclave->switchless_manager == manager)
+            oe_stop_switchless_manager(enclave);
+        else if (manager)
+        {
+            oe_memalign_free(host_contexts);
+            free(host_threads);
+            oe_memalign_free(enclave_contexts);
+            free(enclave_threads);
+            _destroy_ring(manager->host_worker_ring);
+            _destroy_ring(manager->enclave_worker_ring);
+            free((void*)manager->ocall_routes);
+            free(manager->requested_ocall_routes);
+            free((void*)manager->average_ocall_ns);
+            free(manager->host_worker_cpus);
+            free(manager->enclave_worker_cpus);
+            oe_memalign_free(manager->host_worker_counters);
+            oe_memalign_free(manager->enclave_worker_counters);
+            free(manager);
+        }
+    }
+
+    return result;
+}
+
+oe_result_t oe_stop_switchless_manager(oe_enclave_t* enclave)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_switchless_call_manager_t* manager = NULL;
+    if (enclave != NULL && enclave->switchless_manager != NULL)
+    {
+        OE_CHECK(oe_stop_worker_threads(enclave->switchless_manager));
+
+        manager = enclave->switchless_manager;
+        enclave->switchless_manager = NULL;
+
+        // Free all allocated buffers.
+        if (manager->host_worker_contexts != NULL)
+            oe_memalign_free(manager->host_worker_contexts);
+        if (manager->host_worker_threads != NULL)
+            free(manager->host_worker_threads);
+        if (manager->enclave_worker_contexts != NULL)
+            oe_memalign_free(manager->enclave_worker_contexts);
+        if (manager->enclave_worker_threads != NULL)
+            free(manager->enclave_worker_threads);
+        _destroy_ring(manager->host_worker_ring);
+        _destroy_ring(manager->enclave_worker_ring);
+        free((void*)manager->ocall_routes);
+        free(manager->requested_ocall_routes);
+        free((void*)manager->average_ocall_ns);
+        free(manager->host_worker_cpus);
+        free(manager->enclave_worker_cpus);
+        oe_memalign_free(manager->host_worker_counters);
+        oe_memalign_free(manager->enclave_worker_counters);
+        free(manager);
+    }
+    result = OE_OK;
+done:
+    return result;
+}
+
+void oe_sgx_wake_switchless_worker_ocall(oe_host_worker_context_t* context)
+{
+    oe_switchless_worker_counters_t* counters =
+        _get_host_worker_counters(context);
+
+    if (counters)
+        oe_atomic_increment(&counters->num_wakeups);
+
+    oe_host_worker_wake(context);
+}
+
+/*
+**==============================================================================
+**
+** _post_switchless_ecall()
+**
+** Queue the given ecall on the ring shared with the enclave workers and wake a
+** worker if needed. Returns false if the ring is full. The call is complete
+** once the worker has set its result.
+**
+**==============================================================================
+*/
+static bool _post_switchless_ecall(
+    oe_switchless_call_manager_t* manager,
+    oe_call_enclave_function_args_t* args)
+{
+    oe_enclave_worker_context_t* contexts = manager->enclave_worker_contexts;
+    oe_switchless_ring_t* ring = manager->enclave_worker_ring;
+    uint64_t now;
+    uint64_t last;
+
+    if (!ring)
+        return false;
+
+    // Learn the gaps between calls. Gaps below half the minimum spin time
+    // all make workers spin the minimum, so leave the shared line alone
+    // until the gap reaches that. Concurrent callers may lose an update,
+    // which only makes the average slightly less precise.
+    now = oe_get_monotonic_time_ns();
+    last = manager->last_ecall_ns;
+
+    if (!last)
+        manager->last_ecall_ns = now;
+    else if (now > last && now - last >= manager->min_spin_ns / 2)
+    {
+        manager->last_ecall_ns = now;
+        _update_average_gap(
+            &manager->average_ecall_gap_ns, now - last, manager->max_spin_ns);
+    }
+
+    // Schedule the switchless call.
+    OE_ATOMIC_MEMORY_BARRIER_RELEASE();
+    args->result = __OE_RESULT_MAX; // Means the call hasn't been processed.
+
+    if (!oe_switchless_ring_push(ring, ring->slots, ring->capacity - 1, args))
+    {
+        oe_atomic_increment(&manager->ecall_misses);
+        return false;
+    }
+
+    for (size_t i = 0; i < manager->num_enclave_workers; i++)
+    {
+        // If event is 0, the worker may have gone to sleep. Wake it.
+        // Note: it is important to use an atomic cas operation to set the
+        // value to 1 before waking. Setting the value to 1 prevents the
+        // worker from simulataneously going to sleep. If instead, just a
+        // compare operation is used to determine if the worker is sleeping
+        // or not, the worker could go to sleep after the host has
+        // determined that it is not sleeping, causing a deadlock.
+        //
+        // If event is 1, that indicates a pending wake notification, or a
+        // worker that is awake. Either way, that worker checks the ring
+        // again before it sleeps.
+        uint32_t oldval = 0;
+        uint32_t newval = 1;
+        if (oe_atomic_compare_and_swap_32(
+                (uint32_t*)&contexts[i].event, oldval, newval))
+        {
+            // The pevious value of the event was 0 which means that the
+            // worker may be sleeping. Wake it.
+            contexts[i].spin_count_threshold =
+                _get_enclave_worker_spin_count(manager);
+            oe_atomic_increment(
+                &manager->enclave_worker_counters[i].num_wakeups);
+            oe_enclave_worker_wake(&contexts[i]);
+            break;
+        }
+    }
+
+    return true;
+}
+
+/* Whether a worker has finished the given call */
+static bool _is_switchless_ecall_done(oe_call_enclave_function_args_t* args)
+{
+    return *(volatile oe_result_t*)&args->result != __OE_RESULT_MAX;
+}
+
+/*
+**==============================================================================
+**
+** _switchless_call_enclave_function_impl()
+**
+** Switchlessly call the enclave function specified by the given function-id.
+**
+**==============================================================================
+*/
+static oe_result_t _switchless_call_enclave_function_impl(
+    oe_enclave_t* enclave,
+    uint64_t function_id,
     const void* input_buffer,
     size_t input_buffer_size,
     void* output_buffer,
@@ -369,16 +1622,22 @@ static oe_result_t _switchless_call_enclave_function_impl(
     size_t* output_bytes_written)
 {
     oe_result_t result = OE_UNEXPECTED;
-    bool switchless_call_posted = false;
     oe_call_enclave_function_args_t args;
-    oe_switchless_call_manager_t* manager = enclave->switchless_manager;
-    oe_enclave_worker_context_t* contexts = NULL;
-    size_t tries = 0;
+    oe_switchless_call_manager_t* manager = NULL;
+    bool timed = false;
+    uint64_t start = 0;
 
     /* Reject invalid parameters */
     if (!enclave)
         OE_RAISE(OE_INVALID_PARAMETER);
 
+    manager = enclave->switchless_manager;
+
+    // The wait times are shared by all callers; only collect them with the
+    // call statistics.
+    if ((timed = oe_call_statistics_enabled(enclave)))
+        start = oe_get_monotonic_time_ns();
+
     /* Initialize the call_enclave_args structure */
     {
         args.function_id = function_id;
@@ -391,79 +1650,25 @@ static oe_result_t _switchless_call_enclave_function_impl(
     }
 
     /* Do the switchless ECALL only if the manager is initialized. */
-    if (manager)
+    if (manager && _post_switchless_ecall(manager, &args))
     {
-        contexts = manager->enclave_worker_contexts;
-        // Schedule the switchless call.
-        OE_ATOMIC_MEMORY_BARRIER_RELEASE();
-        args.result = __OE_RESULT_MAX; // Means the call hasn't been processed.
+        // Wait for the  call to complete.
+        while (!_is_switchless_ecall_done(&args))
+        {
+            /* Yield CPU */
+            oe_yield_cpu();
+        }
 
-        // Cycle through the worker contexts until we find a free worker.
-        tries = manager->num_enclave_workers;
-        while (tries--)
+        if (timed)
         {
-            // Check if the worker's slot is free.
-            if (contexts[tries].call_arg == NULL)
-            {
-                // Try to atomically grab the slot by placing args in the slot.
-                // If the atomic operation was successful, then the worker
-                // thread will execute this switchless ecall. If the atomic
-                // operation failed, this means that the slot was grabbed by
-                // another switchless ocall and therefore, we must scan for
-                // another worker thread with a free slot.
-                if (oe_atomic_compare_and_swap_ptr(
-                        (void* volatile*)&contexts[tries].call_arg,
-                        NULL,
-                        &args))
-                {
-                    // The worker thread has been marked to execute this
-                    // switchless call. Determine if it needs to be woken up or
-                    // not.
-                    //
-                    // If event is 0, it means that it has gone to sleep. Wake
-                    // it by making an ocall
-                    // (oe_sgx_wake_switchless_worker_ocall). Note: it is
-                    // important to use an atomic cas operation to set the value
-                    // to 1 before making the ocall. Setting the value to 1
-                    // prevents the host worker from simulataneously going to
-                    // sleep. If instead, just a compare operation is used to
-                    // determine if the host thread is sleeping or not, the host
-                    // thread could go to sleep after the enclave has determined
-                    // that the host is not sleeping, causing a deadlock.
-                    //
-                    // If event is 1, that indicates a pending wake
-                    // notification.
-                    uint32_t oldval = 0;
-                    uint32_t newval = 1;
-                    // Weak operation could sporadically fail.
-                    // We need a strong operation.
-                    if (oe_atomic_compare_and_swap_32(
-                            (uint32_t*)&contexts[tries].event, oldval, newval))
-                    {
-                        // The pevious value of the event was 0 which means that
-                        // the worker was previously sleeping. Wake it.
-                        oe_enclave_worker_wake(&contexts[tries]);
-                    }
-
-                    switchless_call_posted = true;
-                    // Wait for the  call to complete.
-                    while (true)
-                    {
-                        if (oe_atomic_load(
-                                (uint64_t*)&contexts[tries].call_arg) !=
-                            (uint64_t)&args)
-                            break;
-
-                        /* Yield CPU */
-                        oe_yield_cpu();
-                    }
-                    break;
-                }
-            }
+            uint64_t wait_time_ns = oe_get_monotonic_time_ns() - start;
+
+            oe_atomic_add(&manager->ecall_wait_time_ns, wait_time_ns);
+            oe_atomic_max(&manager->max_ecall_wait_time_ns, wait_time_ns);
+            oe_record_ecall(enclave, &args, wait_time_ns, true);
         }
     }
-
-    if (!switchless_call_posted)
+    else
     {
         // Dispatch as normal ecall.
         OE_CHECK(oe_ecall(
@@ -516,3 +1721,481 @@ oe_result_t oe_switchless_call_enclave_function(
 done:
     return result;
 }
+
+/*
+**==============================================================================
+**
+** Asynchronous switchless ecalls:
+**
+**     oe_switchless_call_enclave_function_async() queues the call for the
+**     enclave workers and returns a handle at once, so that one host thread
+**     can keep several calls in flight. Completion is observed by
+**     oe_ecall_poll() or oe_ecall_wait(), which also run the optional
+**     callback, once, in the calling thread. If the queue is full, the call
+**     is made as a regular ecall and the handle is already complete.
+**
+**==============================================================================
+*/
+
+struct _oe_ecall_handle
+{
+    /* Read by the enclave worker; must stay valid until completion */
+    oe_call_enclave_function_args_t args;
+
+    /* Whether the call was queued for a worker rather than made as a
+     * regular ecall */
+    bool posted;
+
+    oe_ecall_callback_t callback;
+    void* callback_arg;
+
+    /* OE_ECALL_HANDLE_*; the poller that claims the completion runs the
+     * callback */
+    volatile uint32_t state;
+};
+
+#define OE_ECALL_HANDLE_PENDING 0
+#define OE_ECALL_HANDLE_COMPLETING 1
+#define OE_ECALL_HANDLE_COMPLETED 2
+
+oe_result_t oe_switchless_call_enclave_function_async(
+    oe_enclave_t* enclave,
+    uint64_t* global_id,
+    const char* name,
+    const void* input_buffer,
+    size_t input_buffer_size,
+    void* output_buffer,
+    size_t output_buffer_size,
+    oe_ecall_callback_t callback,
+    void* callback_arg,
+    oe_ecall_handle_t** handle_out)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_ecall_handle_t* handle = NULL;
+    oe_switchless_call_manager_t* manager = NULL;
+
+    if (handle_out)
+        *handle_out = NULL;
+
+    if (!enclave || !handle_out)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    if (!(handle = (oe_ecall_handle_t*)calloc(1, sizeof(*handle))))
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    OE_CHECK(
+        oe_get_ecall_ids(enclave, name, global_id, &handle->args.function_id));
+
+    handle->args.input_buffer = input_buffer;
+    handle->args.input_buffer_size = input_buffer_size;
+    handle->args.output_buffer = output_buffer;
+    handle->args.output_buffer_size = output_buffer_size;
+    handle->args.output_bytes_written = 0;
+    handle->args.result = OE_UNEXPECTED;
+    handle->callback = callback;
+    handle->callback_arg = callback_arg;
+
+    manager = enclave->switchless_manager;
+
+    if (!manager ||
+        !(handle->posted = _post_switchless_ecall(manager, &handle->args)))
+    {
+        // Dispatch as normal ecall.
+        OE_CHECK(oe_ecall(
+            enclave,
+            OE_ECALL_CALL_ENCLAVE_FUNCTION,
+            (uint64_t)&handle->args,
+            NULL));
+    }
+
+    *handle_out = handle;
+    handle = NULL;
+    result = OE_OK;
+
+done:
+    free(handle);
+    return result;
+}
+
+/* The result of a completed call */
+static oe_result_t _get_async_ecall_result(oe_ecall_handle_t* handle)
+{
+    /* A call the enclave rejected leaves the "not processed" marker */
+    if (handle->args.result == __OE_RESULT_MAX)
+        return OE_UNEXPECTED;
+
+    return handle->args.result;
+}
+
+bool oe_ecall_poll(oe_ecall_handle_t* handle)
+{
+    if (!handle)
+        return false;
+
+    if (handle->state != OE_ECALL_HANDLE_PENDING)
+        return handle->state == OE_ECALL_HANDLE_COMPLETED;
+
+    if (handle->posted && !_is_switchless_ecall_done(&handle->args))
+        return false;
+
+    /* Of several pollers, only one runs the callback. The others see the
+     * call as completed once the callback has returned. */
+    if (!oe_atomic_compare_and_swap_32(
+            &handle->state,
+            OE_ECALL_HANDLE_PENDING,
+            OE_ECALL_HANDLE_COMPLETING))
+        return handle->state == OE_ECALL_HANDLE_COMPLETED;
+
+    if (handle->callback)
+        handle->callback(
+            handle, _get_async_ecall_result(handle), handle->callback_arg);
+
+    OE_ATOMIC_MEMORY_BARRIER_RELEASE();
+    handle->state = OE_ECALL_HANDLE_COMPLETED;
+
+    return true;
+}
+
+oe_result_t oe_ecall_wait(
+    oe_ecall_handle_t* handle,
+    size_t* output_bytes_written)
+{
+    oe_result_t result = OE_UNEXPECTED;
+
+    if (!handle)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    while (!oe_ecall_poll(handle))
+    {
+        /* Yield CPU */
+        oe_yield_cpu();
+    }
+
+    OE_CHECK(_get_async_ecall_result(handle));
+
+    if (output_bytes_written)
+        *output_bytes_written = handle->args.output_bytes_written;
+
+    result = OE_OK;
+
+done:
+    free(handle);
+    return result;
+}
+
+/*
+**==============================================================================
+**
+** oe_set_switchless_spin_policy()
+**
+**==============================================================================
+*/
+oe_result_t oe_set_switchless_spin_policy(
+    oe_enclave_t* enclave,
+    uint64_t min_spin_ns,
+    uint64_t max_spin_ns)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_switchless_call_manager_t* manager = NULL;
+
+    if (!enclave || enclave->magic != ENCLAVE_MAGIC ||
+        min_spin_ns > max_spin_ns)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    // Keep the clamping of long gaps from overflowing.
+    if (max_spin_ns > OE_UINT64_MAX / 8)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    if (!(manager = enclave->switchless_manager))
+        OE_RAISE(OE_NOT_FOUND);
+
+    // The workers read the range without a lock. A worker that sees one new
+    // bound and one old bound spins for a time within either range.
+    manager->min_spin_ns = min_spin_ns;
+    manager->max_spin_ns = max_spin_ns;
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+/*
+**==============================================================================
+**
+** oe_get_switchless_pool_usage()
+**
+**==============================================================================
+*/
+oe_result_t oe_get_switchless_pool_usage(
+    oe_enclave_t* enclave,
+    oe_switchless_pool_usage_t* usage)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_switchless_pool_member_t* member = NULL;
+
+    if (!enclave || enclave->magic != ENCLAVE_MAGIC || !usage)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    oe_mutex_lock(&_pool_lock);
+    {
+        if (enclave->switchless_manager &&
+            (member = enclave->switchless_manager->host_worker_pool_member))
+        {
+            usage->num_calls = member->num_calls;
+            usage->busy_time_ns = member->busy_time_ns;
+            usage->num_workers = _pool->num_workers;
+            usage->num_enclaves = _pool->num_references;
+        }
+    }
+    oe_mutex_unlock(&_pool_lock);
+
+    if (!member)
+        OE_RAISE(OE_NOT_FOUND);
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+/*
+**==============================================================================
+**
+** oe_set_ocall_route()
+**
+**==============================================================================
+*/
+oe_result_t oe_set_ocall_route(
+    oe_enclave_t* enclave,
+    uint64_t function_id,
+    oe_ocall_route_t route)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_switchless_call_manager_t* manager = NULL;
+
+    if (!enclave || enclave->magic != ENCLAVE_MAGIC ||
+        function_id >= enclave->num_ocalls || route > OE_OCALL_ROUTE_AUTO)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    manager = enclave->switchless_manager;
+    if (!manager || function_id >= manager->num_ocall_routes)
+        OE_RAISE(OE_NOT_FOUND);
+
+    // An automatic route starts as declared and learns the duration afresh.
+    manager->requested_ocall_routes[function_id] = (uint8_t)route;
+    manager->average_ocall_ns[function_id] = 0;
+    manager->ocall_routes[function_id] =
+        route == OE_OCALL_ROUTE_AUTO ? OE_SWITCHLESS_OCALL_ROUTE_AS_DECLARED
+                                     : (uint8_t)route;
+
+    result = OE_OK;
+
+done:
+    return result;
+}
+
+bool oe_is_ocall_route_auto(oe_enclave_t* enclave, uint64_t function_id)
+{
+    oe_switchless_call_manager_t* manager = enclave->switchless_manager;
+
+    return manager && function_id < manager->num_ocall_routes &&
+           manager->requested_ocall_routes[function_id] == OE_OCALL_ROUTE_AUTO;
+}
+
+/*
+**==============================================================================
+**
+** oe_update_ocall_route()
+**
+**     Called after each host function with the time it took. For ocalls
+**     routed with OE_OCALL_ROUTE_AUTO, keep an average of the duration and
+**     route the ocalls as regular calls while it is long. Both routes are
+**     measured, so a function that becomes quick again returns to
+**     switchless. The average is updated without a lock; a lost update only
+**     delays a change of route.
+**
+**==============================================================================
+*/
+void oe_update_ocall_route(
+    oe_enclave_t* enclave,
+    uint64_t function_id,
+    uint64_t time_ns)
+{
+    oe_switchless_call_manager_t* manager = enclave->switchless_manager;
+    volatile uint64_t* average_ns;
+    uint8_t route;
+
+    if (!oe_is_ocall_route_auto(enclave, function_id))
+        return;
+
+    average_ns = &manager->average_ocall_ns[function_id];
+
+    // Clamp long calls so that the average recovers quickly.
+    if (time_ns > 8 * OE_SWITCHLESS_AUTO_MAX_OCALL_NS)
+        time_ns = 8 * OE_SWITCHLESS_AUTO_MAX_OCALL_NS;
+
+    if (*average_ns == 0)
+        *average_ns = time_ns ? time_ns : 1;
+    else
+        *average_ns = *average_ns - *average_ns / 8 + time_ns / 8;
+
+    if (*average_ns > OE_SWITCHLESS_AUTO_MAX_OCALL_NS)
+        route = OE_SWITCHLESS_OCALL_ROUTE_REGULAR;
+    else if (*average_ns < OE_SWITCHLESS_AUTO_MAX_OCALL_NS / 2)
+        route = OE_SWITCHLESS_OCALL_ROUTE_SWITCHLESS;
+    else
+        return;
+
+    // Avoid writing to the cache line the enclave reads on every ocall.
+    if (manager->ocall_routes[function_id] != route)
+        manager->ocall_routes[function_id] = route;
+}
+
+static void _get_worker_statistics(
+    oe_switchless_worker_statistics_t* statistics,
+    oe_switchless_worker_kind_t kind,
+    const oe_switchless_worker_counters_t* counters,
+    uint64_t num_calls,
+    uint64_t num_spins)
+{
+    statistics->kind = kind;
+    statistics->num_calls = num_calls;
+    statistics->num_wakeups = counters->num_wakeups;
+    statistics->num_sleeps = counters->num_sleeps;
+    statistics->num_spins = num_spins;
+    statistics->busy_time_ns = counters->busy_time_ns;
+    statistics->sleep_time_ns = counters->sleep_time_ns;
+}
+
+static void _get_ring_statistics(
+    const oe_switchless_ring_t* ring,
+    uint64_t* posted,
+    uint64_t* queued)
+{
+    if (ring)
+    {
+        uint64_t tail = *(const volatile uint64_t*)&ring->tail;
+        uint64_t head = *(const volatile uint64_t*)&ring->head;
+
+        *posted = head;
+        *queued = head > tail ? head - tail : 0;
+    }
+}
+
+/*
+**==============================================================================
+**
+** oe_get_switchless_statistics()
+**
+**     The counters are read without stopping the workers. Host workers of a
+**     shared pool are read under the pool lock, so that the pool cannot go
+**     away meanwhile.
+**
+**==============================================================================
+*/
+oe_result_t oe_get_switchless_statistics(
+    oe_enclave_t* enclave,
+    oe_switchless_statistics_t* statistics,
+    oe_switchless_worker_statistics_t* workers,
+    size_t* num_workers)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_switchless_call_manager_t* manager = NULL;
+    size_t count = 0;
+    bool locked = false;
+
+    if (!enclave || enclave->magic != ENCLAVE_MAGIC)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    if (workers && !num_workers)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    if (!(manager = enclave->switchless_manager))
+        OE_RAISE(OE_NOT_FOUND);
+
+    if (manager->host_worker_pool_member)
+    {
+        oe_mutex_lock(&_pool_lock);
+        locked = true;
+    }
+
+    count = manager->num_host_workers + manager->num_enclave_workers;
+
+    if (statistics)
+    {
+        memset(statistics, 0, sizeof(*statistics));
+        _get_ring_statistics(
+            manager->host_worker_ring,
+            &statistics->ocalls_posted,
+            &statistics->ocalls_queued);
+        _get_ring_statistics(
+            manager->enclave_worker_ring,
+            &statistics->ecalls_posted,
+            &statistics->ecalls_queued);
+
+        if (manager->host_worker_ring)
+            statistics->ocalls_missed =
+                oe_atomic_load(&manager->host_worker_ring->misses);
+
+        statistics->ecalls_missed = oe_atomic_load(&manager->ecall_misses);
+        statistics->ecall_wait_time_ns = manager->ecall_wait_time_ns;
+        statistics->max_ecall_wait_time_ns = manager->max_ecall_wait_time_ns;
+        statistics->num_host_workers = manager->num_host_workers;
+        statistics->num_enclave_workers = manager->num_enclave_workers;
+        statistics->num_active_host_workers =
+            manager->num_active_host_workers;
+        statistics->num_active_enclave_workers =
+            manager->num_active_enclave_workers;
+    }
+
+    if (num_workers)
+    {
+        const oe_switchless_worker_counters_t* host_counters =
+            locked ? _pool->counters : manager->host_worker_counters;
+
+        if (workers && *num_workers < count)
+        {
+            *num_workers = count;
+            OE_RAISE_NO_TRACE(OE_BUFFER_TOO_SMALL);
+        }
+
+        *num_workers = count;
+
+        for (size_t i = 0; workers && i < manager->num_host_workers; i++)
+        {
+            const oe_switchless_worker_counters_t* counters =
+                &host_counters[i];
+            oe_host_worker_context_t* context =
+                &manager->host_worker_contexts[i];
+
+            _get_worker_statistics(
+                workers++,
+                OE_SWITCHLESS_WORKER_KIND_HOST,
+                counters,
+                counters->num_calls,
+                context->total_spin_count + context->spin_count);
+        }
+
+        for (size_t i = 0; workers && i < manager->num_enclave_workers; i++)
+        {
+            oe_enclave_worker_context_t* context =
+                &manager->enclave_worker_contexts[i];
+
+            _get_worker_statistics(
+                workers++,
+                OE_SWITCHLESS_WORKER_KIND_ENCLAVE,
+                &manager->enclave_worker_counters[i],
+                context->num_calls,
+                context->total_spin_count + context->spin_count);
+        }
+    }
+
+    result = OE_OK;
+
+done:
+    if (locked)
+        oe_mutex_unlock(&_pool_lock);
+
+    return result;
+}
@@ -0,0 +1,338 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+
+#include "waitqueue.h"
+#include <openenclave/internal/atomic.h>
+#include <openenclave/internal/raise.h>
+#include <openenclave/internal/time.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../hostthread.h"
+
+/*
+**==============================================================================
+**
+** Thread wait queue:
+**
+**     When every binding of an enclave is busy, host threads calling into
+**     the enclave park here in FIFO order instead of failing with
+**     OE_OUT_OF_THREADS. A released binding is pushed onto the lock-free
+**     free list first; the releaser then checks the queue depth and, if
+**     there are waiters, moves idle bindings from the free list to the
+**     oldest waiters. A waiter publishes itself (depth++) before it checks
+**     the free list, so either the waiter sees the pushed binding or the
+**     releaser sees the waiter.
+**
+**     The queue lock is only taken on the slow path, when threads have to
+**     wait.
+**
+**==============================================================================
+*/
+
+typedef struct _oe_thread_waiter
+{
+    struct _oe_thread_waiter* next;
+
+    /* Set to 1 once a binding has been handed to this waiter */
+    volatile uint32_t signaled;
+    oe_thread_binding_t* binding;
+} oe_thread_waiter_t;
+
+typedef struct _oe_thread_wait_queue
+{
+    oe_mutex lock;
+    oe_thread_waiter_t* head;
+    oe_thread_waiter_t* tail;
+
+    /* Number of queued waiters, updated under the lock and read without it */
+    volatile uint64_t depth;
+
+    size_t max_waiters;
+    uint64_t timeout_ns;
+
+    oe_thread_wait_queue_statistics_t statistics;
+} oe_thread_wait_queue_t;
+
+static void _enqueue(oe_thread_wait_queue_t* queue, oe_thread_waiter_t* waiter)
+{
+    waiter->next = NULL;
+
+    if (queue->tail)
+        queue->tail->next = waiter;
+    else
+        queue->head = waiter;
+
+    queue->tail = waiter;
+    oe_atomic_increment(&queue->depth);
+}
+
+static void _remove(oe_thread_wait_queue_t* queue, oe_thread_waiter_t* waiter)
+{
+    oe_thread_waiter_t* prev = NULL;
+
+    for (oe_thread_waiter_t* p = queue->head; p; prev = p, p = p->next)
+    {
+        if (p == waiter)
+        {
+            if (prev)
+                prev->next = p->next;
+            else
+                queue->head = p->next;
+
+            if (queue->tail == p)
+                queue->tail = prev;
+
+            oe_atomic_decrement(&queue->depth);
+            return;
+        }
+    }
+}
+
+/* Hand idle bindings to the oldest waiters. Called with the lock held. */
+static void _hand_off_bindings(
+    oe_enclave_t* enclave,
+    oe_thread_wait_queue_t* queue)
+{
+    while (queue->head)
+    {
+        oe_thread_binding_t* binding = oe_pop_free_thread_binding(enclave);
+        oe_thread_waiter_t* waiter = queue->head;
+
+        if (!binding)
+            break;
+
+        _remove(queue, waiter);
+        waiter->binding = binding;
+        waiter->signaled = 1;
+
+        /* The waiter re-takes the lock before it returns, so its stack frame
+         * is still alive here */
+        oe_thread_wake_address(&waiter->signaled);
+    }
+}
+
+/*
+**==============================================================================
+**
+** oe_create_thread_wait_queue()
+**
+**==============================================================================
+*/
+
+oe_result_t oe_create_thread_wait_queue(
+    oe_enclave_t* enclave,
+    const oe_enclave_setting_thread_wait_queue_t* setting)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_thread_wait_queue_t* queue = NULL;
+
+    if (!enclave || !setting)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    if (enclave->thread_wait_queue)
+        OE_RAISE(OE_ALREADY_INITIALIZED);
+
+    if (!(queue = (oe_thread_wait_queue_t*)calloc(1, sizeof(*queue))))
+        OE_RAISE(OE_OUT_OF_MEMORY);
+
+    if (oe_mutex_init(&queue->lock))
+        OE_RAISE(OE_FAILURE);
+
+    queue->max_waiters = setting->max_waiters;
+    queue->timeout_ns = setting->timeout_ms * 1000000ULL;
+
+    /* Guard against overflow of very large timeouts */
+    if (queue->timeout_ns / 1000000ULL != setting->timeout_ms)
+        queue->timeout_ns = 0;
+
+    enclave->thread_wait_queue = queue;
+    queue = NULL;
+    result = OE_OK;
+
+done:
+    free(queue);
+    return result;
+}
+
+/*
+**==============================================================================
+**
+** oe_destroy_thread_wait_queue()
+**
+**==============================================================================
+*/
+
+void oe_destroy_thread_wait_queue(oe_enclave_t* enclave)
+{
+    oe_thread_wait_queue_t* queue = enclave->thread_wait_queue;
+
+    if (!queue)
+        return;
+
+    enclave->thread_wait_queue = NULL;
+    oe_mutex_destroy(&queue->lock);
+    free(queue);
+}
+
+/*
+**==============================================================================
+**
+** oe_acquire_thread_binding()
+**
+**     Take an idle binding of the enclave. Without a wait queue, this fails
+**     immediately when every binding is busy. With a wait queue, the caller
+**     waits behind earlier waiters until a binding is released, the queue is
+**     full, or the timeout elapses.
+**
+**==============================================================================
+*/
+
+oe_thread_binding_t* oe_acquire_thread_binding(oe_enclave_t* enclave)
+{
+    oe_thread_wait_queue_t* queue = enclave->thread_wait_queue;
+    oe_thread_waiter_t waiter;
+    oe_thread_binding_t* binding = NULL;
+    oe_thread_wait_queue_statistics_t* statistics;
+    uint64_t start;
+    uint64_t now;
+
+    /* Fast path: do not barge ahead of threads that are already waiting */
+    if (!queue || !oe_atomic_load(&queue->depth))
+    {
+        if ((binding = oe_pop_free_thread_binding(enclave)) || !queue)
+            return binding;
+    }
+
+    statistics = &queue->statistics;
+    memset(&waiter, 0, sizeof(waiter));
+
+    oe_mutex_lock(&queue->lock);
+    {
+        if (queue->max_waiters && queue->depth >= queue->max_waiters)
+        {
+            statistics->total_rejected++;
+            oe_mutex_unlock(&queue->lock);
+            return NULL;
+        }
+
+        _enqueue(queue, &waiter);
+
+        /* Pick up any binding released before this waiter was visible */
+        _hand_off_bindings(enclave, queue);
+
+        if (waiter.signaled)
+        {
+            oe_mutex_unlock(&queue->lock);
+            return waiter.binding;
+        }
+
+        statistics->total_waits++;
+
+        if (queue->depth > statistics->max_queue_depth)
+            statistics->max_queue_depth = queue->depth;
+    }
+    oe_mutex_unlock(&queue->lock);
+
+    start = now = oe_get_monotonic_time_ns();
+
+    while (!waiter.signaled)
+    {
+        uint64_t timeout_ns = OE_UINT64_MAX;
+
+        if (queue->timeout_ns)
+        {
+            if (now - start >= queue->timeout_ns)
+                break;
+
+            timeout_ns = queue->timeout_ns - (now - start);
+        }
+
+        oe_thread_wait_address(&waiter.signaled, 0, timeout_ns);
+        now = oe_get_monotonic_time_ns();
+    }
+
+    oe_mutex_lock(&queue->lock);
+    {
+        /* A binding may have been handed over right after the timeout */
+        if (waiter.signaled)
+        {
+            binding = waiter.binding;
+        }
+        else
+        {
+            _remove(queue, &waiter);
+            statistics->total_timeouts++;
+        }
+
+        statistics->total_wait_time_ns += now - start;
+
+        if (now - start > statistics->max_wait_time_ns)
+            statistics->max_wait_time_ns = now - start;
+    }
+    oe_mutex_unlock(&queue->lock);
+
+    return binding;
+}
+
+/*
+**==============================================================================
+**
+** oe_release_thread_binding()
+**
+**     Return an idle binding to the enclave and pass idle bindings on to
+**     waiting threads, if any.
+**
+**==============================================================================
+*/
+
+void oe_release_thread_binding(
+    oe_enclave_t* enclave,
+    oe_thread_binding_t* binding)
+{
+    oe_thread_wait_queue_t* queue = enclave->thread_wait_queue;
+
+    oe_push_free_thread_binding(enclave, binding);
+
+    /* The depth is read after the push, pairing with the waiter that
+     * publishes itself before checking the free list */
+    if (queue && oe_atomic_load(&queue->depth))
+    {
+        oe_mutex_lock(&queue->lock);
+        _hand_off_bindings(enclave, queue);
+        oe_mutex_unlock(&queue->lock);
+    }
+}
+
+/*
+**==============================================================================
+**
+** oe_get_thread_wait_queue_statistics()
+**
+**==============================================================================
+*/
+
+oe_result_t oe_get_thread_wait_queue_statistics(
+    oe_enclave_t* enclave,
+    oe_thread_wait_queue_statistics_t* statistics)
+{
+    oe_result_t result = OE_UNEXPECTED;
+    oe_thread_wait_queue_t* queue;
+
+    if (!enclave || enclave->magic != ENCLAVE_MAGIC || !statistics)
+        OE_RAISE(OE_INVALID_PARAMETER);
+
+    if (!(queue = enclave->thread_wait_queue))
+        OE_RAISE(OE_NOT_FOUND);
+
+    oe_mutex_lock(&queue->lock);
+    {
+        *statistics = queue->statistics;
+        statistics->queue_depth = queue->depth;
+    }
+    oe_mutex_unlock(&queue->lock);
+
+    result = OE_OK;
+
+done:
+    return result;
+}
@@ -0,0 +1,27 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+
+#ifndef _OE_HOST_WAITQUEUE_H
+#define _OE_HOST_WAITQUEUE_H
+
+#include <openenclave/host.h>
+#include "enclave.h"
+
+/* Enable the thread wait queue of the enclave */
+oe_result_t oe_create_thread_wait_queue(
+    oe_enclave_t* enclave,
+    const oe_enclave_setting_thread_wait_queue_t* setting);
+
+/* Release the thread wait queue of the enclave, if any */
+void oe_destroy_thread_wait_queue(oe_enclave_t* enclave);
+
+/* Take an idle binding, waiting in FIFO order if the enclave has a wait
+ * queue. Returns NULL if no binding could be obtained. */
+oe_thread_binding_t* oe_acquire_thread_binding(oe_enclave_t* enclave);
+
+/* Return an idle binding and pass it on to a waiting thread, if any */
+void oe_release_thread_binding(
+    oe_enclave_t* enclave,
+    oe_thread_binding_t* binding);
+
+#endif /* _OE_HOST_WAITQUEUE_H */
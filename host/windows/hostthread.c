@@ -44,6 +44,16 @@ int oe_thread_equal(oe_thread_t thread1, oe_thread_t thread2)
     return thread1 == thread2;
 }
 
+int oe_thread_set_affinity(oe_thread_t thread, uint32_t cpu)
+{
+    if (cpu >= sizeof(DWORD_PTR) * 8)
+        return OE_EINVAL;
+
+    return SetThreadAffinityMask((HANDLE)thread, (DWORD_PTR)1 << cpu)
+               ? 0
+               : OE_EINVAL;
+}
+
 /*
 **==============================================================================
 **
@@ -152,3 +162,37 @@ void* oe_thread_getspecific(oe_thread_key key)
 {
     return TlsGetValue(key);
 }
+
+/*
+**==============================================================================
+**
+** oe_thread_wait_address/oe_thread_wake_address
+**
+**==============================================================================
+*/
+
+int oe_thread_wait_address(
+    volatile uint32_t* addr,
+    uint32_t expected,
+    uint64_t timeout_ns)
+{
+    DWORD timeout_ms = INFINITE;
+
+    if (timeout_ns != OE_UINT64_MAX)
+    {
+        /* Round up so that short timeouts still block */
+        uint64_t ms = (timeout_ns + 999999) / 1000000;
+        timeout_ms = ms < INFINITE ? (DWORD)ms : INFINITE - 1;
+    }
+
+    if (!WaitOnAddress(addr, &expected, sizeof(expected), timeout_ms) &&
+        GetLastError() == ERROR_TIMEOUT)
+        return 1;
+
+    return 0;
+}
+
+void oe_thread_wake_address(volatile uint32_t* addr)
+{
+    WakeByAddressSingle((PVOID)addr);
+}
@@ -56,6 +56,23 @@ void oe_handle_get_time(uint64_t arg_in, uint64_t* arg_out)
         *arg_out = _time() / TICKS_PER_MILLISECOND;
 }
 
+uint64_t oe_get_monotonic_time_ns(void)
+{
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+
+    /* The frequency is fixed at boot, so racing initializations agree */
+    if (frequency.QuadPart == 0)
+        QueryPerformanceFrequency(&frequency);
+
+    QueryPerformanceCounter(&counter);
+
+    /* Split the conversion to avoid overflowing the multiplication */
+    return (uint64_t)(counter.QuadPart / frequency.QuadPart) * 1000000000ULL +
+           (uint64_t)(counter.QuadPart % frequency.QuadPart) * 1000000000ULL /
+               (uint64_t)frequency.QuadPart;
+}
+
 int gettimeofday(struct timeval* tv, struct timezone* tzp)
 {
     OE_UNUSED(tzp);
@@ -377,6 +377,11 @@ typedef enum _oe_result
      */
     OE_SGX_QUOTE_LIBRARY_ERROR,
 
+    /**
+     * The operation did not complete before its deadline.
+     */
+    OE_TIMEDOUT,
+
     __OE_RESULT_MAX = OE_ENUM_MAX,
 } oe_result_t;
 /**< typedef enum _oe_result oe_result_t*/
@@ -25,8 +25,10 @@ typedef struct _oe_sgx_enclave_image_info_t
     uint64_t enclave_size;
 } oe_sgx_enclave_image_info_t;
 
-/* Max number of threads in an enclave supported */
-#define OE_SGX_MAX_TCS 32
+/* Max number of threads in an enclave supported. The host allocates thread
+ * bindings per enclave from the signed NumTCS, so this is only a sanity
+ * bound on the enclave properties. */
+#define OE_SGX_MAX_TCS 1024
 
 // oe_sgx_enclave_properties_t SGX enclave properties derived type
 #define OE_SGX_FLAGS_DEBUG 0x0000000000000002ULL
@@ -25,6 +25,18 @@ int pthread_rwlock_wrlock(pthread_rwlock_t* rwlock)
     return oe_pthread_rwlock_wrlock((oe_pthread_rwlock_t*)rwlock);
 }
 
+OE_INLINE
+int pthread_rwlock_tryrdlock(pthread_rwlock_t* rwlock)
+{
+    return oe_pthread_rwlock_tryrdlock((oe_pthread_rwlock_t*)rwlock);
+}
+
+OE_INLINE
+int pthread_rwlock_trywrlock(pthread_rwlock_t* rwlock)
+{
+    return oe_pthread_rwlock_trywrlock((oe_pthread_rwlock_t*)rwlock);
+}
+
 OE_INLINE
 int pthread_rwlock_unlock(pthread_rwlock_t* rwlock)
 {
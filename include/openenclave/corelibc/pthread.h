@@ -119,6 +119,10 @@ int oe_pthread_rwlock_rdlock(oe_pthread_rwlock_t* rwlock);
 
 int oe_pthread_rwlock_wrlock(oe_pthread_rwlock_t* rwlock);
 
+int oe_pthread_rwlock_tryrdlock(oe_pthread_rwlock_t* rwlock);
+
+int oe_pthread_rwlock_trywrlock(oe_pthread_rwlock_t* rwlock);
+
 int oe_pthread_rwlock_unlock(oe_pthread_rwlock_t* rwlock);
 
 int oe_pthread_rwlock_destroy(oe_pthread_rwlock_t* rwlock);
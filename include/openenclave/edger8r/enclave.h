@@ -117,6 +117,68 @@ oe_result_t oe_switchless_call_host_function(
     size_t output_buffer_size,
     size_t* output_bytes_written);
 
+/**
+ * Handle of an asynchronous host function call.
+ */
+typedef struct _oe_ocall_handle oe_ocall_handle_t;
+
+/**
+ * Start a host function call without waiting for it.
+ *
+ * The call is queued for the switchless host workers and a handle is
+ * returned at once, so that the enclave thread can start other calls or
+ * compute while the host works. If switchless calls are not enabled or the
+ * queue is full, a regular ocall is made and the call has completed on return.
+ *
+ * The input and output buffers must be in host memory, for example from
+ * oe_host_malloc(), and must stay valid until the call completes. Every
+ * handle must be released with oe_ocall_wait() before the ecall returns.
+ *
+ * @param function_id The id of the host function that will be called.
+ * @param input_buffer Buffer containing inputs data.
+ * @param input_buffer_size Size of the input data buffer.
+ * @param output_buffer Buffer where the outputs of the host function are
+ * written to.
+ * @param output_buffer_size Size of the output buffer.
+ * @param handle Receives the handle of the call.
+ *
+ * @return OE_OK the call was started.
+ * @return OE_INVALID_PARAMETER a parameter is invalid.
+ * @return OE_OUT_OF_MEMORY the call could not be allocated.
+ */
+oe_result_t oe_call_host_function_async(
+    size_t function_id,
+    const void* input_buffer,
+    size_t input_buffer_size,
+    void* output_buffer,
+    size_t output_buffer_size,
+    oe_ocall_handle_t** handle);
+
+/**
+ * Check whether an asynchronous host function call has completed, without
+ * blocking.
+ *
+ * @param handle Handle of the call.
+ * @return true if the call has completed.
+ */
+bool oe_ocall_poll(oe_ocall_handle_t* handle);
+
+/**
+ * Wait for an asynchronous host function call to complete and release its
+ * handle.
+ *
+ * @param handle Handle of the call; invalid after this function returns,
+ * even if another parameter is invalid.
+ * @param output_bytes_written Number of bytes written in the output buffer.
+ *
+ * @return OE_OK the call was successful.
+ * @return OE_INVALID_PARAMETER a parameter is invalid.
+ * @return OE_FAILURE the call failed.
+ */
+oe_result_t oe_ocall_wait(
+    oe_ocall_handle_t* handle,
+    size_t* output_bytes_written);
+
 /**
  * Allocate a buffer of given size for doing an ocall.
  *
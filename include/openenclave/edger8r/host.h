@@ -76,6 +76,52 @@ oe_result_t oe_call_enclave_function(
     size_t output_buffer_size,
     size_t* output_bytes_written);
 
+/**
+ * Describes one call of oe_call_enclave_function_batch().
+ */
+typedef struct _oe_enclave_function_call
+{
+    /** The global id and name of the function, as for
+     * oe_call_enclave_function() */
+    uint64_t* global_id;
+    const char* name;
+
+    /** The marshalled inputs and the buffer for the outputs */
+    const void* input_buffer;
+    size_t input_buffer_size;
+    void* output_buffer;
+    size_t output_buffer_size;
+
+    /** Set on return: number of bytes written in the output buffer */
+    size_t output_bytes_written;
+
+    /** Set on return: the result of this call */
+    oe_result_t result;
+} oe_enclave_function_call_t;
+
+/**
+ * Perform a batch of high-level enclave function calls in a single ecall.
+ *
+ * The calls are dispatched in order inside the enclave, with the same
+ * argument copying and checks as oe_call_enclave_function(), so that many
+ * small calls only pay for one enclave transition. A failed call does not
+ * stop the batch; its error is reported in its result field.
+ *
+ * @param enclave Enclave to call into.
+ * @param calls Array of calls to perform.
+ * @param num_calls Number of elements in calls.
+ *
+ * @return OE_OK the batch was dispatched; see the result of each call.
+ * @return OE_NOT_FOUND a function name could not be resolved.
+ * @return OE_INVALID_PARAMETER a parameter is invalid.
+ * @return OE_OUT_OF_MEMORY the batch could not be allocated.
+ *
+ */
+oe_result_t oe_call_enclave_function_batch(
+    oe_enclave_t* enclave,
+    oe_enclave_function_call_t* calls,
+    size_t num_calls);
+
 /**
  * Placeholder.
  */
@@ -89,6 +135,83 @@ oe_result_t oe_switchless_call_enclave_function(
     size_t output_buffer_size,
     size_t* output_bytes_written);
 
+/**
+ * Handle of an asynchronous switchless enclave function call.
+ */
+typedef struct _oe_ecall_handle oe_ecall_handle_t;
+
+/**
+ * Completion callback of an asynchronous switchless enclave function call.
+ * It runs once, in the thread that observes the completion through
+ * oe_ecall_poll() or oe_ecall_wait().
+ */
+typedef void (*oe_ecall_callback_t)(
+    oe_ecall_handle_t* handle,
+    oe_result_t result,
+    void* arg);
+
+/**
+ * Start a switchless enclave function call without waiting for it.
+ *
+ * The call is queued for the switchless enclave workers and a handle is
+ * returned at once. The input and output buffers must stay valid until the
+ * call completes. If the queue is full, the call is made as a regular ecall
+ * and has completed when this function returns.
+ *
+ * Every handle must be released with oe_ecall_wait().
+ *
+ * @param callback Optional function to run when the call completes.
+ * @param callback_arg Argument passed to the callback.
+ * @param handle Receives the handle of the call.
+ *
+ * @return OE_OK the call was started.
+ * @return OE_NOT_FOUND the function could not be resolved.
+ * @return OE_INVALID_PARAMETER a parameter is invalid.
+ * @return OE_OUT_OF_MEMORY the handle could not be allocated.
+ *
+ */
+oe_result_t oe_switchless_call_enclave_function_async(
+    oe_enclave_t* enclave,
+    uint64_t* global_id,
+    const char* name,
+    const void* input_buffer,
+    size_t input_buffer_size,
+    void* output_buffer,
+    size_t output_buffer_size,
+    oe_ecall_callback_t callback,
+    void* callback_arg,
+    oe_ecall_handle_t** handle);
+
+/**
+ * Check whether an asynchronous call has completed, without blocking. Runs
+ * the completion callback the first time completion is observed.
+ *
+ * Several threads may poll the same handle; the callback runs in one of
+ * them, and the others see the call as completed once it has returned.
+ * oe_ecall_wait() releases the handle, so it must not race with other uses
+ * of the handle.
+ *
+ * @param handle Handle of the call.
+ *
+ * @return true if the call has completed.
+ *
+ */
+bool oe_ecall_poll(oe_ecall_handle_t* handle);
+
+/**
+ * Wait for an asynchronous call to complete and release its handle.
+ *
+ * @param handle Handle of the call; invalid after this function returns.
+ * @param output_bytes_written Optional; receives the number of bytes written
+ * in the output buffer.
+ *
+ * @return The result of the call.
+ *
+ */
+oe_result_t oe_ecall_wait(
+    oe_ecall_handle_t* handle,
+    size_t* output_bytes_written);
+
 /*
  * In some instances oeedger8r generates the same code for both the host and
  * enclave side. Since enclave applications are not required to link stdc,
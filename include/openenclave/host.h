@@ -108,6 +108,8 @@ typedef void (*oe_ocall_func_t)(
 typedef enum _oe_enclave_setting_type
 {
     OE_ENCLAVE_SETTING_CONTEXT_SWITCHLESS = 0xdc73a628,
+    OE_ENCLAVE_SETTING_THREAD_WAIT_QUEUE = 0x3f1b6e52,
+    OE_ENCLAVE_SETTING_OCALL_BUFFER = 0x5a8c2e17,
 #ifdef OE_WITH_EXPERIMENTAL_EEID
     OE_EXTENDED_ENCLAVE_INITIALIZATION_DATA = 0x976a8f66,
 #endif
@@ -130,8 +132,91 @@ typedef struct _oe_enclave_setting_context_switchless
      * workers should be 0.
      */
     size_t max_enclave_workers;
+    /**
+     * The min number of worker threads for context-switchless ocalls. If it
+     * is non-zero and less than max_host_workers, the pool is elastic: it
+     * starts with this many workers, adds workers while calls queue up or
+     * miss, and retires workers after about a second of idleness. Zero keeps
+     * max_host_workers workers running.
+     */
+    size_t min_host_workers;
+    /**
+     * The min number of worker threads for context-switchless ecalls, with
+     * the same meaning as min_host_workers. Retired enclave workers return
+     * their TCS to the enclave.
+     */
+    size_t min_enclave_workers;
+    /**
+     * Serve the context-switchless ocalls of the enclave with the host worker
+     * pool shared by all enclaves of the process that set this, instead of
+     * host workers of its own. The pool is started with max_host_workers
+     * workers by the first such enclave and stopped when the last one is
+     * terminated. The workers take calls from the enclaves in turn. Its
+     * workers spin with the default policy, and min_host_workers is ignored.
+     */
+    bool share_host_workers;
+    /**
+     * Optional CPUs to pin the host workers to: worker i runs on
+     * host_worker_cpus[i % num_host_worker_cpus]. Listing CPUs of one NUMA
+     * node keeps the workers close to the enclave threads they serve. With
+     * no CPUs, the workers run wherever the OS schedules them. A shared pool
+     * is pinned as set by the enclave that starts it.
+     */
+    const uint32_t* host_worker_cpus;
+    /** The number of entries in host_worker_cpus. */
+    size_t num_host_worker_cpus;
+    /**
+     * Optional CPUs to pin the enclave workers to, with the same meaning as
+     * host_worker_cpus.
+     */
+    const uint32_t* enclave_worker_cpus;
+    /** The number of entries in enclave_worker_cpus. */
+    size_t num_enclave_worker_cpus;
 } oe_enclave_setting_context_switchless_t;
 
+/**
+ * The setting for waiting on enclave threads.
+ *
+ * By default, an ecall made while every enclave thread (TCS) is bound to
+ * another host thread fails with OE_OUT_OF_THREADS. With this setting, the
+ * caller instead waits in a FIFO queue until a TCS is released.
+ */
+typedef struct _oe_enclave_setting_thread_wait_queue
+{
+    /**
+     * The max number of host threads that may wait for a TCS at the same
+     * time. Further callers fail with OE_OUT_OF_THREADS. Zero means no limit.
+     */
+    size_t max_waiters;
+    /**
+     * The max time in milliseconds a host thread waits for a TCS before
+     * failing with OE_OUT_OF_THREADS. Zero means wait indefinitely.
+     */
+    uint64_t timeout_ms;
+} oe_enclave_setting_thread_wait_queue_t;
+
+/**
+ * The setting for the per-thread buffers that carry ocall parameters.
+ *
+ * The parameters of an ocall that do not fit in the buffer of the calling
+ * enclave thread are placed in host memory allocated with two extra ocalls.
+ * Each buffer starts at the initial size and grows to the largest size such
+ * ocalls needed, up to the max size.
+ */
+typedef struct _oe_enclave_setting_ocall_buffer
+{
+    /**
+     * The initial size of each buffer in bytes. Zero selects the default of
+     * 16 KB.
+     */
+    uint64_t initial_size;
+    /**
+     * The max size in bytes a buffer may grow to. Zero selects the default of
+     * 1 MB. A max size equal to the initial size disables growth.
+     */
+    uint64_t max_size;
+} oe_enclave_setting_ocall_buffer_t;
+
 /**
  * The setting for config_id/config_svn on Ice Lake platform.
  */
@@ -160,6 +245,8 @@ typedef struct _oe_enclave_setting
     {
         const oe_enclave_setting_context_switchless_t*
             context_switchless_setting;
+        const oe_enclave_setting_thread_wait_queue_t* thread_wait_queue_setting;
+        const oe_enclave_setting_ocall_buffer_t* ocall_buffer_setting;
 #ifdef OE_WITH_EXPERIMENTAL_EEID
         oe_eeid_t* eeid;
 #endif
@@ -240,6 +327,362 @@ oe_result_t oe_create_enclave(
  */
 oe_result_t oe_terminate_enclave(oe_enclave_t* enclave);
 
+/**
+ * Statistics of the queue of host threads waiting for an enclave thread.
+ */
+typedef struct _oe_thread_wait_queue_statistics
+{
+    /** The number of host threads currently waiting. */
+    uint64_t queue_depth;
+    /** The largest number of host threads that waited at the same time. */
+    uint64_t max_queue_depth;
+    /** The number of ecalls that had to wait for a TCS. */
+    uint64_t total_waits;
+    /** The number of waits that ended with OE_OUT_OF_THREADS on timeout. */
+    uint64_t total_timeouts;
+    /** The number of ecalls rejected because the queue was full. */
+    uint64_t total_rejected;
+    /** The total time in nanoseconds spent waiting for a TCS. */
+    uint64_t total_wait_time_ns;
+    /** The longest time in nanoseconds a single ecall waited for a TCS. */
+    uint64_t max_wait_time_ns;
+} oe_thread_wait_queue_statistics_t;
+
+/**
+ * Get the statistics of the enclave thread wait queue.
+ *
+ * @param[in] enclave The enclave created with the
+ *            OE_ENCLAVE_SETTING_THREAD_WAIT_QUEUE setting.
+ * @param[out] statistics The statistics of the queue.
+ *
+ * @returns OE_OK on success.
+ * @returns OE_INVALID_PARAMETER if a parameter is invalid.
+ * @returns OE_NOT_FOUND if the enclave was created without a wait queue.
+ */
+oe_result_t oe_get_thread_wait_queue_statistics(
+    oe_enclave_t* enclave,
+    oe_thread_wait_queue_statistics_t* statistics);
+
+/**
+ * Statistics of the per-thread ocall buffers.
+ */
+typedef struct _oe_ocall_buffer_statistics
+{
+    /** The number of ocalls whose parameters did not fit in the buffer and
+     * were placed in host memory allocated with extra ocalls. */
+    uint64_t total_misses;
+    /** The number of times a buffer was grown. */
+    uint64_t total_grows;
+    /** The size in bytes of the largest parameters that did not fit. */
+    uint64_t max_miss_size;
+    /** The size in bytes of the largest buffer. */
+    uint64_t max_buffer_size;
+} oe_ocall_buffer_statistics_t;
+
+/**
+ * Get the statistics of the per-thread ocall buffers of an enclave.
+ *
+ * @param[in] enclave The enclave.
+ * @param[out] statistics The statistics of the buffers.
+ *
+ * @returns OE_OK on success.
+ * @returns OE_INVALID_PARAMETER if a parameter is invalid.
+ */
+oe_result_t oe_get_ocall_buffer_statistics(
+    oe_enclave_t* enclave,
+    oe_ocall_buffer_statistics_t* statistics);
+
+/**
+ * The number of latency buckets in **oe_call_statistics_t**.
+ */
+#define OE_CALL_LATENCY_BUCKETS 128
+
+/**
+ * Kinds of calls in **oe_call_statistics_t**.
+ */
+typedef enum _oe_call_kind
+{
+    OE_CALL_KIND_ECALL = 0,
+    OE_CALL_KIND_OCALL = 1,
+    __OE_CALL_KIND_MAX = OE_ENUM_MAX,
+} oe_call_kind_t;
+
+/**
+ * Statistics of the calls to one ecall or ocall of an enclave, as seen from
+ * the host. Ecall latencies span from entering the enclave to returning
+ * from it, including nested ocalls. Ocall latencies span the host function.
+ */
+typedef struct _oe_call_statistics
+{
+    /** Whether this is an ecall or an ocall. */
+    oe_call_kind_t kind;
+    /** The function id of the call in the enclave's ecall or ocall table. */
+    uint64_t function_id;
+    /** The name of the ecall. NULL for ocalls, whose tables have no names;
+     * their ids are the <edl>_fcn_id_<name> values generated by oeedger8r. */
+    const char* name;
+    /** The number of calls. */
+    uint64_t num_calls;
+    /** The number of calls made by switchless workers. */
+    uint64_t num_switchless_calls;
+    /** The total size in bytes of the input buffers. */
+    uint64_t bytes_in;
+    /** The total number of bytes written to the output buffers. */
+    uint64_t bytes_out;
+    /** The total time in nanoseconds spent in calls. */
+    uint64_t total_time_ns;
+    /** The longest time in nanoseconds spent in a call. */
+    uint64_t max_time_ns;
+    /**
+     * Histogram of latencies with four buckets per power of two. Buckets 0
+     * to 3 count calls that took 0 to 3 ns. For b >= 4, bucket b counts
+     * calls that took at least (4 + b % 4) << (b / 4 - 1) ns and less than
+     * (5 + b % 4) << (b / 4 - 1) ns. The last bucket also counts all longer
+     * calls.
+     */
+    uint64_t latency_buckets[OE_CALL_LATENCY_BUCKETS];
+} oe_call_statistics_t;
+
+/**
+ * Start counting and timing the ecalls and ocalls of an enclave.
+ *
+ * Calls are not accounted for until this is called, since the shared
+ * counters add to the cost of every call. Calls in progress are counted
+ * from the next one on. Calling it again has no effect.
+ *
+ * @param[in] enclave The enclave.
+ *
+ * @returns OE_OK on success.
+ * @returns OE_INVALID_PARAMETER if a parameter is invalid.
+ * @returns OE_OUT_OF_MEMORY if the counters could not be allocated.
+ */
+oe_result_t oe_enable_call_statistics(oe_enclave_t* enclave);
+
+/**
+ * Get the statistics of the ecalls and ocalls of an enclave.
+ *
+ * Only functions that have been called since oe_enable_call_statistics()
+ * are reported. The counters are updated with relaxed atomics, so a
+ * snapshot taken while calls are in progress may be slightly inconsistent
+ * across fields. Each call of a batch of ecalls is reported with an equal
+ * share of the time of the batch.
+ *
+ * @param[in] enclave The enclave.
+ * @param[out] statistics Array that receives one entry per called function.
+ * May be NULL to query the number of entries.
+ * @param[in,out] count On input, the number of entries in **statistics**.
+ * On output, the number of entries written, or needed if the array is too
+ * small.
+ *
+ * @returns OE_OK on success.
+ * @returns OE_INVALID_PARAMETER if a parameter is invalid.
+ * @returns OE_BUFFER_TOO_SMALL if **statistics** has too few entries.
+ */
+oe_result_t oe_get_call_statistics(
+    oe_enclave_t* enclave,
+    oe_call_statistics_t* statistics,
+    size_t* count);
+
+/**
+ * Usage of the shared context-switchless host worker pool by an enclave.
+ */
+typedef struct _oe_switchless_pool_usage
+{
+    /** The number of ocalls of the enclave handled by the pool. */
+    uint64_t num_calls;
+    /** The time in nanoseconds the workers spent in those ocalls. */
+    uint64_t busy_time_ns;
+    /** The number of workers in the pool. */
+    uint64_t num_workers;
+    /** The number of enclaves sharing the pool. */
+    uint64_t num_enclaves;
+} oe_switchless_pool_usage_t;
+
+/**
+ * Get the usage of the shared host worker pool by an enclave created with
+ * share_host_workers set in its context-switchless setting.
+ *
+ * @param[in] enclave The enclave.
+ * @param[out] usage The usage of the pool by the enclave.
+ *
+ * @returns OE_OK on success.
+ * @returns OE_INVALID_PARAMETER if a parameter is invalid.
+ * @returns OE_NOT_FOUND if the enclave does not share the pool.
+ */
+oe_result_t oe_get_switchless_pool_usage(
+    oe_enclave_t* enclave,
+    oe_switchless_pool_usage_t* usage);
+
+/**
+ * Set how long the context-switchless workers of an enclave spin waiting for
+ * calls before they sleep.
+ *
+ * Each worker learns the average gap between the calls it sees and spins
+ * about twice that long, within the given range, so that it catches the next
+ * call of a steady stream. A worker whose calls are further apart than
+ * **max_spin_ns** spins only **min_spin_ns** before it sleeps. By default,
+ * workers spin between 10 and 200 microseconds.
+ *
+ * @param[in] enclave The enclave.
+ * @param[in] min_spin_ns The minimum time in nanoseconds to spin.
+ * @param[in] max_spin_ns The maximum time in nanoseconds to spin.
+ *
+ * @returns OE_OK on success.
+ * @returns OE_INVALID_PARAMETER if a parameter is invalid.
+ * @returns OE_NOT_FOUND if context-switchless calls are not enabled.
+ */
+oe_result_t oe_set_switchless_spin_policy(
+    oe_enclave_t* enclave,
+    uint64_t min_spin_ns,
+    uint64_t max_spin_ns);
+
+/**
+ * How the ocalls to a host function are made.
+ */
+typedef enum _oe_ocall_route
+{
+    /** As declared in the EDL, switchless if transition_using_threads. */
+    OE_OCALL_ROUTE_DEFAULT = 0,
+    /** Always as a context-switchless call. */
+    OE_OCALL_ROUTE_SWITCHLESS = 1,
+    /** Always as a regular call. */
+    OE_OCALL_ROUTE_REGULAR = 2,
+    /**
+     * As a context-switchless call while the host function returns within
+     * about 10 microseconds on average, as a regular call otherwise. Until
+     * the function has been measured, as declared in the EDL.
+     */
+    OE_OCALL_ROUTE_AUTO = 3,
+    __OE_OCALL_ROUTE_MAX = OE_ENUM_MAX,
+} oe_ocall_route_t;
+
+/**
+ * Set how the ocalls of an enclave to a host function are made, overriding
+ * the transition_using_threads attribute of the function in the EDL.
+ *
+ * Short ocalls gain from being context-switchless, but an ocall that blocks,
+ * such as one waiting for I/O or sleeping, holds a host worker for its whole
+ * duration and delays the ocalls queued behind it. Such ocalls are better
+ * made as regular calls.
+ *
+ * Ocalls are only made context-switchless if the enclave was created with
+ * host workers (see oe_enclave_setting_context_switchless_t).
+ *
+ * @param[in] enclave The enclave.
+ * @param[in] function_id The id of the host function, as generated by
+ * oeedger8r.
+ * @param[in] route How to make the ocalls to the function.
+ *
+ * @returns OE_OK on success.
+ * @returns OE_INVALID_PARAMETER if a parameter is invalid.
+ * @returns OE_NOT_FOUND if context-switchless ocalls are not enabled.
+ */
+oe_result_t oe_set_ocall_route(
+    oe_enclave_t* enclave,
+    uint64_t function_id,
+    oe_ocall_route_t route);
+
+/**
+ * Kinds of workers in **oe_switchless_worker_statistics_t**.
+ */
+typedef enum _oe_switchless_worker_kind
+{
+    /** A host thread that handles switchless ocalls. */
+    OE_SWITCHLESS_WORKER_KIND_HOST = 0,
+    /** A thread in the enclave that handles switchless ecalls. */
+    OE_SWITCHLESS_WORKER_KIND_ENCLAVE = 1,
+    __OE_SWITCHLESS_WORKER_KIND_MAX = OE_ENUM_MAX,
+} oe_switchless_worker_kind_t;
+
+/**
+ * Statistics of one context-switchless worker.
+ */
+typedef struct _oe_switchless_worker_statistics
+{
+    /** Whether the worker handles ocalls or ecalls. */
+    oe_switchless_worker_kind_t kind;
+    /** The number of calls the worker handled. */
+    uint64_t num_calls;
+    /** The number of times the worker was woken up by a caller. */
+    uint64_t num_wakeups;
+    /** The number of times the worker went to sleep. */
+    uint64_t num_sleeps;
+    /** The number of times the worker spun without finding a call. */
+    uint64_t num_spins;
+    /** The time in nanoseconds the worker spent in calls. Only measured for
+     * host workers, as enclave workers have no clock; 0 for those. */
+    uint64_t busy_time_ns;
+    /** The time in nanoseconds the worker spent asleep. */
+    uint64_t sleep_time_ns;
+} oe_switchless_worker_statistics_t;
+
+/**
+ * Statistics of the context-switchless calls of an enclave.
+ */
+typedef struct _oe_switchless_statistics
+{
+    /** The number of switchless ocalls posted to the host workers. */
+    uint64_t ocalls_posted;
+    /** The number of switchless ocalls made as regular ocalls because the
+     * queue of the host workers was full. */
+    uint64_t ocalls_missed;
+    /** The number of switchless ocalls waiting for a host worker. */
+    uint64_t ocalls_queued;
+    /** The number of switchless ecalls posted to the enclave workers. */
+    uint64_t ecalls_posted;
+    /** The number of switchless ecalls made as regular ecalls because the
+     * queue of the enclave workers was full. */
+    uint64_t ecalls_missed;
+    /** The number of switchless ecalls waiting for an enclave worker. */
+    uint64_t ecalls_queued;
+    /** The total time in nanoseconds host threads waited for switchless
+     * ecalls to complete, including the time spent in the enclave. Only
+     * measured once oe_enable_call_statistics() is called; 0 before. */
+    uint64_t ecall_wait_time_ns;
+    /** The longest time in nanoseconds a host thread waited for a
+     * switchless ecall to complete. Only measured with the call
+     * statistics, as ecall_wait_time_ns. */
+    uint64_t max_ecall_wait_time_ns;
+    /** The number of host workers, including those that are not running. */
+    uint64_t num_host_workers;
+    /** The number of enclave workers, including those that are not
+     * running. */
+    uint64_t num_enclave_workers;
+    /** The number of host workers running. Elastic pools start and retire
+     * workers with load. */
+    uint64_t num_active_host_workers;
+    /** The number of enclave workers running. */
+    uint64_t num_active_enclave_workers;
+} oe_switchless_statistics_t;
+
+/**
+ * Get the statistics of the context-switchless calls of an enclave and of
+ * its workers.
+ *
+ * The statistics are read while calls are in progress, so they may be
+ * slightly inconsistent across fields. If the enclave shares the host worker
+ * pool, the host workers reported are those of the pool, and their counters
+ * include the ocalls of all enclaves sharing it.
+ *
+ * @param[in] enclave The enclave.
+ * @param[out] statistics The statistics of the calls. May be NULL.
+ * @param[out] workers Array that receives the host workers followed by the
+ * enclave workers. May be NULL to query the number of workers.
+ * @param[in,out] num_workers On input, the number of entries in **workers**.
+ * On output, the number of entries written, or needed if the array is too
+ * small. May be NULL if **workers** is NULL.
+ *
+ * @returns OE_OK on success.
+ * @returns OE_INVALID_PARAMETER if a parameter is invalid.
+ * @returns OE_NOT_FOUND if context-switchless calls are not enabled.
+ * @returns OE_BUFFER_TOO_SMALL if **workers** has too few entries.
+ */
+oe_result_t oe_get_switchless_statistics(
+    oe_enclave_t* enclave,
+    oe_switchless_statistics_t* statistics,
+    oe_switchless_worker_statistics_t* workers,
+    size_t* num_workers);
+
 #if (OE_API_VERSION < 2)
 #error "Only OE_API_VERSION of 2 is supported"
 #else
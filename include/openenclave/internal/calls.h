@@ -75,6 +75,7 @@ typedef enum _oe_func
     OE_ECALL_INIT_ENCLAVE,
     OE_ECALL_CALL_ENCLAVE_FUNCTION,
     OE_ECALL_VIRTUAL_EXCEPTION_HANDLER,
+    OE_ECALL_CALL_ENCLAVE_FUNCTION_BATCH,
     /* Caution: always add new ECALL function numbers here */
     OE_ECALL_MAX,
 
@@ -84,6 +85,8 @@ typedef enum _oe_func
     OE_OCALL_MALLOC,
     OE_OCALL_FREE,
     OE_OCALL_GET_TIME,
+    OE_OCALL_FLUSH_DEFERRED_OCALLS,
+    OE_OCALL_THREAD_TIMED_WAIT,
     /* Caution: always add new OCALL function numbers here */
     OE_OCALL_MAX, /* This value is never used */
 
@@ -190,6 +193,24 @@ typedef struct _oe_call_enclave_function_args
     oe_result_t result;
 } oe_call_enclave_function_args_t;
 
+/*
+**==============================================================================
+**
+** oe_call_enclave_function_batch_args_t
+**
+**     Argument of OE_ECALL_CALL_ENCLAVE_FUNCTION_BATCH: a host array of calls
+**     that the enclave dispatches one after another in a single ecall. The
+**     result of each call is written to its result field.
+**
+**==============================================================================
+*/
+
+typedef struct _oe_call_enclave_function_batch_args
+{
+    oe_call_enclave_function_args_t* calls;
+    size_t num_calls;
+} oe_call_enclave_function_batch_args_t;
+
 /*
 **==============================================================================
 **
@@ -207,6 +228,10 @@ typedef struct _oe_call_host_function_args
     size_t output_buffer_size;
     size_t output_bytes_written;
     oe_result_t result;
+
+    /* Set to 1 by an enclave thread that sleeps until a switchless host
+     * worker completes the call, and back to 0 by the worker that wakes it */
+    uint32_t parked;
 } oe_call_host_function_args_t;
 
 /*
@@ -328,6 +353,62 @@ oe_result_t oe_ecall(
  */
 oe_result_t oe_ocall(uint16_t func, uint64_t arg_in, uint64_t* arg_out);
 
+/*
+**==============================================================================
+**
+** oe_get_ecall_buffer_statistics()
+**
+**     Report how many ecalls copied their parameters into a reused per-thread
+**     buffer and how many had to allocate from the enclave heap. Enclave only.
+**
+**==============================================================================
+*/
+
+typedef struct _oe_ecall_buffer_statistics
+{
+    uint64_t num_reused;
+    uint64_t num_allocated;
+    uint64_t bytes_cached;
+} oe_ecall_buffer_statistics_t;
+
+void oe_get_ecall_buffer_statistics(oe_ecall_buffer_statistics_t* statistics);
+
+/*
+**==============================================================================
+**
+** Deferred ocalls (enclave only):
+**
+**     A deferred ocall is copied into a per-thread queue in host memory and
+**     returns OE_OK at once, with a zeroed output buffer. The host runs the
+**     queued ocalls in order when the thread next makes a regular ocall or
+**     returns from the ecall, so many one-way ocalls share one transition.
+**
+**     Only ocalls without a return value and without out or in-out
+**     parameters (logging, metrics) may be deferred. Ocalls fall back to a
+**     regular call when the queue is not available or too small.
+**
+**     oe_set_ocall_deferred() marks an ocall function id (its index in the
+**     enclave's ocall table) as always deferred. oe_set_ocall_deferrable()
+**     marks it as deferred only between oe_begin_deferred_ocalls() and
+**     oe_end_deferred_ocalls() on the calling thread. Ocalls to other ids,
+**     including the runtime's own, are never deferred.
+**
+**==============================================================================
+*/
+
+#define OE_MAX_DEFERRED_OCALL_ID 1024
+
+oe_result_t oe_set_ocall_deferred(uint64_t function_id, bool deferred);
+
+oe_result_t oe_set_ocall_deferrable(uint64_t function_id, bool deferrable);
+
+void oe_begin_deferred_ocalls(void);
+
+void oe_end_deferred_ocalls(void);
+
+/* Run the queued ocalls of the calling thread now */
+oe_result_t oe_flush_deferred_ocalls(void);
+
 OE_EXTERNC_END
 
 #endif /* _OE_CALLS_H */
@@ -10,6 +10,31 @@
 
 OE_EXTERNC_BEGIN
 
+/**
+ * Header of an ocall in the deferred ocall queue. It is followed by the input
+ * buffer and by room for the output buffer, both of the given sizes.
+ */
+typedef struct _oe_deferred_ocall
+{
+    uint64_t function_id;
+    uint64_t input_buffer_size;
+    uint64_t output_buffer_size;
+    uint64_t reserved;
+} oe_deferred_ocall_t;
+
+/**
+ * Per-thread queue of one-way ocalls, in host memory. The enclave appends
+ * ocalls and advances size and count; the host dispatches them in order on
+ * the next OCALL or ERET and then resets both.
+ */
+typedef struct _oe_deferred_ocall_queue
+{
+    uint8_t* buffer;
+    uint64_t capacity;
+    uint64_t size;
+    uint64_t count;
+} oe_deferred_ocall_queue_t;
+
 typedef struct _oe_ecall_context
 {
     // Storage for making ocall
@@ -21,6 +46,14 @@ typedef struct _oe_ecall_context
     uint64_t debug_eexit_rip;
     uint64_t debug_eexit_rbp;
     uint64_t debug_eexit_rsp;
+
+    // Queue for deferred one-way ocalls.
+    oe_deferred_ocall_queue_t* deferred_ocalls;
+
+    // Ocalls that did not fit in ocall_buffer, set by the enclave. The host
+    // grows the buffer from these when the ecall returns.
+    uint64_t ocall_buffer_misses;
+    uint64_t ocall_buffer_miss_size;
 } oe_ecall_context_t;
 
 /**
@@ -34,6 +67,11 @@ oe_call_host_function_args_t* oe_ecall_context_get_ocall_args();
  */
 void* oe_ecall_context_get_ocall_buffer(uint64_t size);
 
+/**
+ * Fetch the deferred ocall queue if an ecall context has been passed in.
+ */
+oe_deferred_ocall_queue_t* oe_ecall_context_get_deferred_ocall_queue();
+
 OE_EXTERNC_END
 
 #endif /* _OE_INTERNAL_ECALL_CONTEXT_H */
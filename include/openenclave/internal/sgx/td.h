@@ -81,7 +81,7 @@ oe_thread_data_t* oe_get_thread_data(void);
  * Due to the inability to use OE_OFFSETOF on a struct while defining its
  * members, this value is computed and hard-coded.
  */
-#define OE_THREAD_SPECIFIC_DATA_SIZE (3756)
+#define OE_THREAD_SPECIFIC_DATA_SIZE (3680)
 
 typedef struct _oe_callsite oe_callsite_t;
 
@@ -105,6 +105,32 @@ typedef struct _oe_shared_memory_arena_t
 
 OE_CHECK_SIZE(sizeof(oe_shared_memory_arena_t), 24);
 
+/* This structure manages the buffer that the ecall input and output
+ * parameters are copied into. An instance of this structure is maintained
+ * for each thread so that steady-state ecalls do not allocate. This structure
+ * is used in enclave/core/sgx/ecallbuffer.c.
+ */
+typedef struct _oe_ecall_buffer
+{
+    uint8_t* data;
+    uint64_t capacity;
+
+    /* Bytes in use by active (possibly nested) ecalls */
+    uint32_t used;
+
+    /* Number of consecutive ecalls that used a small part of the buffer */
+    uint32_t num_underused;
+
+    /* Number of ecalls served from the buffer and from the heap */
+    uint64_t num_reused;
+    uint64_t num_allocated;
+
+    /* Next thread data in the list of those owning a buffer */
+    struct _td* next;
+} oe_ecall_buffer_t;
+
+OE_CHECK_SIZE(sizeof(oe_ecall_buffer_t), 48);
+
 OE_PACK_BEGIN
 typedef struct _td
 {
@@ -151,7 +177,10 @@ typedef struct _td
 
     /* POSIX errno (renamed to prevent clash with errno macro) */
     int32_t errnum;
-    int32_t padding2;
+
+    /* Non-zero while the switchless runtime makes its own ocalls, which are
+     * never rerouted (see enclave/core/sgx/switchlesscalls.c) */
+    uint32_t force_regular_ocalls;
 
     /* Thread-specific shared memory pool (see enclave/core/arena.c) */
     oe_shared_memory_arena_t arena;
@@ -168,6 +197,25 @@ typedef struct _td
     /* The error code for PF and GP exceptions. */
     uint32_t error_code;
 
+    /* Nesting depth of oe_begin_deferred_ocalls() */
+    uint32_t deferred_ocalls_depth;
+
+    /* Reusable ecall marshalling buffer (see enclave/core/sgx/ecallbuffer.c) */
+    oe_ecall_buffer_t ecall_buffer;
+
+    /* Reader indicator: the readers-writer lock this thread holds for read
+     * without taking its spinlock (see enclave/core/sgx/thread.c) */
+    void* volatile rwlock_reader;
+
+    /* Next thread in the list of reader indicators that writers scan */
+    struct _td* rwlock_next;
+
+    /* Number of readers-writer locks this thread holds for read */
+    uint32_t rwlock_read_depth;
+
+    /* Non-zero once this thread is on the list of reader indicators */
+    uint32_t rwlock_registered;
+
     /* Reserved for thread specific data. */
     uint8_t thread_specific_data[OE_THREAD_SPECIFIC_DATA_SIZE];
 } oe_sgx_td_t;
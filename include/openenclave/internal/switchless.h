@@ -6,15 +6,38 @@
 
 #include <openenclave/bits/defs.h>
 #include <openenclave/bits/types.h>
+#include <openenclave/internal/atomic.h>
 #include <openenclave/internal/bits/sgx/switchless.h>
 #include <openenclave/internal/calls.h>
 #include <openenclave/internal/thread.h>
+#include <openenclave/internal/utils.h>
+
+/**
+ * Version of the layout of the structures below, which are shared by the
+ * host and the enclave. The host passes it to the enclave, which refuses a
+ * host with a different layout. Bump it whenever the layout changes.
+ *
+ * Version 2: worker contexts are padded to a cache line each, and arrays of
+ * contexts and rings start on a cache line.
+ * Version 3: enclave workers count their calls, and callers count the misses
+ * of a ring.
+ * Version 4: enclave callers of switchless ocalls may park on the call
+ * arguments, and host workers wake them.
+ */
+#define OE_SWITCHLESS_LAYOUT_VERSION 4
+
+/**
+ * Size of a cache line. Each worker context fills one, so that workers do
+ * not write to each other's lines.
+ */
+#define OE_SWITCHLESS_CACHE_LINE_SIZE 64
 
 /**
  * oe_host_worker_context_t is used both by the host (windows/linux) and the
  * enclave (ELF). Lock down the layout.
  */
-OE_STATIC_ASSERT(sizeof(oe_host_worker_context_t) == 40);
+OE_STATIC_ASSERT(
+    sizeof(oe_host_worker_context_t) == OE_SWITCHLESS_CACHE_LINE_SIZE);
 OE_STATIC_ASSERT(OE_OFFSETOF(oe_host_worker_context_t, call_arg) == 0);
 OE_STATIC_ASSERT(OE_OFFSETOF(oe_host_worker_context_t, enc) == 8);
 OE_STATIC_ASSERT(OE_OFFSETOF(oe_host_worker_context_t, is_stopping) == 16);
@@ -26,7 +49,8 @@ OE_STATIC_ASSERT(OE_OFFSETOF(oe_host_worker_context_t, total_spin_count) == 32);
  * oe_enclave_worker_context_t is used both by the host (windows/linux) and the
  * enclave (ELF). Lock down the layout.
  */
-OE_STATIC_ASSERT(sizeof(oe_enclave_worker_context_t) == 48);
+OE_STATIC_ASSERT(
+    sizeof(oe_enclave_worker_context_t) == OE_SWITCHLESS_CACHE_LINE_SIZE);
 OE_STATIC_ASSERT(OE_OFFSETOF(oe_enclave_worker_context_t, call_arg) == 0);
 OE_STATIC_ASSERT(OE_OFFSETOF(oe_enclave_worker_context_t, enc) == 8);
 OE_STATIC_ASSERT(OE_OFFSETOF(oe_enclave_worker_context_t, is_stopping) == 16);
@@ -36,25 +60,248 @@ OE_STATIC_ASSERT(
     OE_OFFSETOF(oe_enclave_worker_context_t, spin_count_threshold) == 32);
 OE_STATIC_ASSERT(
     OE_OFFSETOF(oe_enclave_worker_context_t, total_spin_count) == 40);
+OE_STATIC_ASSERT(OE_OFFSETOF(oe_enclave_worker_context_t, num_calls) == 48);
+
+/**
+ * oe_switchless_ring_t is used both by the host (windows/linux) and the
+ * enclave (ELF). Lock down the layout.
+ */
+OE_STATIC_ASSERT(sizeof(oe_switchless_ring_slot_t) == 16);
+OE_STATIC_ASSERT(OE_OFFSETOF(oe_switchless_ring_slot_t, sequence) == 0);
+OE_STATIC_ASSERT(OE_OFFSETOF(oe_switchless_ring_slot_t, call_arg) == 8);
+OE_STATIC_ASSERT(
+    sizeof(oe_switchless_ring_t) == 3 * OE_SWITCHLESS_CACHE_LINE_SIZE);
+OE_STATIC_ASSERT(OE_OFFSETOF(oe_switchless_ring_t, slots) == 0);
+OE_STATIC_ASSERT(OE_OFFSETOF(oe_switchless_ring_t, capacity) == 8);
+OE_STATIC_ASSERT(OE_OFFSETOF(oe_switchless_ring_t, misses) == 16);
+OE_STATIC_ASSERT(OE_OFFSETOF(oe_switchless_ring_t, head) == 64);
+OE_STATIC_ASSERT(OE_OFFSETOF(oe_switchless_ring_t, tail) == 128);
+
+/**
+ * Number of times a push or a pop retries after losing a race for a slot
+ * before it gives up. The ring may live in memory written by the other side
+ * of the enclave boundary, so no loop over it is left unbounded.
+ */
+#define OE_SWITCHLESS_RING_MAX_TRIES 64
+
+/*
+**==============================================================================
+**
+** Switchless call ring:
+**
+**     A bounded multi-producer/multi-consumer queue (after Dmitry Vyukov's
+**     design). Slot i starts with sequence i. A producer that claims
+**     position pos (by advancing head) fills slot pos & mask and sets its
+**     sequence to pos + 1. A consumer that claims position pos (by advancing
+**     tail) waits for that sequence, takes the call and sets the sequence to
+**     pos + capacity, handing the slot to the producer of the next lap.
+**
+**     The slots and mask are passed separately from the ring so that the
+**     enclave can use copies it has validated instead of values the host
+**     may change.
+**
+**==============================================================================
+*/
+
+/* Queue call_arg; returns false if the ring is full */
+OE_INLINE bool oe_switchless_ring_push(
+    oe_switchless_ring_t* ring,
+    oe_switchless_ring_slot_t* slots,
+    uint64_t mask,
+    void* call_arg)
+{
+    uint64_t pos = oe_atomic_load(&ring->head);
+
+    for (size_t tries = 0; tries < OE_SWITCHLESS_RING_MAX_TRIES; tries++)
+    {
+        oe_switchless_ring_slot_t* slot = &slots[pos & mask];
+        int64_t diff = (int64_t)(oe_atomic_load(&slot->sequence) - pos);
+
+        if (diff == 0)
+        {
+            if (oe_atomic_compare_and_swap(
+                    (int64_t*)&ring->head, (int64_t)pos, (int64_t)(pos + 1)))
+            {
+                slot->call_arg = call_arg;
+                OE_ATOMIC_MEMORY_BARRIER_RELEASE();
+                *(volatile uint64_t*)&slot->sequence = pos + 1;
+                return true;
+            }
+        }
+        else if (diff < 0)
+        {
+            /* The slot still holds a call from the previous lap */
+            return false;
+        }
+
+        pos = oe_atomic_load(&ring->head);
+    }
+
+    return false;
+}
+
+/* Dequeue the oldest call; returns NULL if the ring is empty */
+OE_INLINE void* oe_switchless_ring_pop(
+    oe_switchless_ring_t* ring,
+    oe_switchless_ring_slot_t* slots,
+    uint64_t mask)
+{
+    uint64_t pos = oe_atomic_load(&ring->tail);
+
+    for (size_t tries = 0; tries < OE_SWITCHLESS_RING_MAX_TRIES; tries++)
+    {
+        oe_switchless_ring_slot_t* slot = &slots[pos & mask];
+        int64_t diff = (int64_t)(oe_atomic_load(&slot->sequence) - (pos + 1));
+
+        if (diff == 0)
+        {
+            if (oe_atomic_compare_and_swap(
+                    (int64_t*)&ring->tail, (int64_t)pos, (int64_t)(pos + 1)))
+            {
+                void* call_arg = slot->call_arg;
+                OE_ATOMIC_MEMORY_BARRIER_RELEASE();
+                *(volatile uint64_t*)&slot->sequence = pos + mask + 1;
+                return call_arg;
+            }
+        }
+        else if (diff < 0)
+        {
+            /* No call has been pushed at this position yet */
+            return NULL;
+        }
+
+        pos = oe_atomic_load(&ring->tail);
+    }
+
+    return NULL;
+}
+
+/**
+ * Most pause instructions an idle worker executes between two looks at its
+ * ring. The pause count doubles after every empty look, up to this limit.
+ */
+#define OE_SWITCHLESS_MAX_BACKOFF_PAUSES 16
+
+/**
+ * Pause instructions an enclave thread executes waiting for a switchless
+ * ocall to complete before it parks in the host, about the cost of a few
+ * regular ocalls. Short ocalls complete within the spin; a blocking one
+ * does not burn a core for its whole duration.
+ */
+#define OE_SWITCHLESS_OCALL_SPIN_PAUSES 8192
+
+/**
+ * Routes of an ocall as published to the enclave, one byte per function id.
+ * Any other value means the route declared in the EDL.
+ */
+#define OE_SWITCHLESS_OCALL_ROUTE_AS_DECLARED 0
+#define OE_SWITCHLESS_OCALL_ROUTE_SWITCHLESS 1
+#define OE_SWITCHLESS_OCALL_ROUTE_REGULAR 2
+
+/* Host-side statistics of a worker, see oe_get_switchless_statistics().
+ * Each worker has a cache line of its own. */
+typedef struct _oe_switchless_worker_counters
+{
+    volatile uint64_t num_calls;
+    volatile uint64_t num_wakeups;
+    volatile uint64_t num_sleeps;
+    volatile uint64_t busy_time_ns;
+    volatile uint64_t sleep_time_ns;
+    uint8_t padding[24];
+} oe_switchless_worker_counters_t;
+
+OE_STATIC_ASSERT(
+    sizeof(oe_switchless_worker_counters_t) == OE_SWITCHLESS_CACHE_LINE_SIZE);
+
+/* A member of the process-wide host worker pool */
+typedef struct _oe_switchless_pool_member oe_switchless_pool_member_t;
 
 typedef struct _oe_switchless_call_manager
 {
+    /* Contexts and threads of up to num_host_workers workers. The first
+     * num_active_host_workers of them are running. */
     oe_host_worker_context_t* host_worker_contexts;
+    oe_switchless_worker_counters_t* host_worker_counters;
     oe_thread_t* host_worker_threads;
     size_t num_host_workers;
+    size_t min_host_workers;
+    volatile size_t num_active_host_workers;
+
+    /* Pending switchless ocalls, consumed by the host workers */
+    oe_switchless_ring_t* host_worker_ring;
+
+    /* Set if the host workers are those of the shared pool, which owns the
+     * contexts and the ring */
+    oe_switchless_pool_member_t* host_worker_pool_member;
 
     oe_enclave_worker_context_t* enclave_worker_contexts;
+    oe_switchless_worker_counters_t* enclave_worker_counters;
     oe_thread_t* enclave_worker_threads;
     size_t num_enclave_workers;
+    size_t min_enclave_workers;
+    volatile size_t num_active_enclave_workers;
+
+    /* Pending switchless ecalls, consumed by the enclave workers */
+    oe_switchless_ring_t* enclave_worker_ring;
+
+    /* CPUs the workers are pinned to in turn, if any */
+    uint32_t* host_worker_cpus;
+    size_t num_host_worker_cpus;
+    uint32_t* enclave_worker_cpus;
+    size_t num_enclave_worker_cpus;
+
+    /* Range of the spin time of the workers, see
+     * oe_set_switchless_spin_policy() */
+    uint64_t min_spin_ns;
+    uint64_t max_spin_ns;
+
+    /* Pause instructions per microsecond, used to turn the spin time of the
+     * enclave workers into a spin count */
+    uint64_t pauses_per_us;
+
+    /* Average gap between switchless ecalls, and the time of the last one */
+    volatile uint64_t average_ecall_gap_ns;
+    volatile uint64_t last_ecall_ns;
+
+    /* Switchless ecalls made as regular ecalls because the ring was full */
+    volatile uint64_t ecall_misses;
+
+    /* Time callers waited for switchless ecalls to complete */
+    volatile uint64_t ecall_wait_time_ns;
+    volatile uint64_t max_ecall_wait_time_ns;
+
+    /* Thread that resizes elastic pools, and the flag that stops it */
+    oe_thread_t controller_thread;
+    volatile uint32_t controller_stopping;
+
+    /* Per ocall function id: the route read by the enclave, the route set
+     * with oe_set_ocall_route(), and the average duration of the host
+     * function, which drives OE_OCALL_ROUTE_AUTO */
+    volatile uint8_t* ocall_routes;
+    uint8_t* requested_ocall_routes;
+    volatile uint64_t* average_ocall_ns;
+    size_t num_ocall_routes;
 } oe_switchless_call_manager_t;
 
+/* Declared in <openenclave/host.h> */
+struct _oe_enclave_setting_context_switchless;
+
 oe_result_t oe_start_switchless_manager(
     oe_enclave_t* enclave,
-    size_t num_host_workers,
-    size_t num_enclave_workers);
+    const struct _oe_enclave_setting_context_switchless* setting);
 
 oe_result_t oe_stop_switchless_manager(oe_enclave_t* enclave);
 
+/* Whether the ocalls of the function are routed with OE_OCALL_ROUTE_AUTO,
+ * so that the duration of the host function must be measured */
+bool oe_is_ocall_route_auto(oe_enclave_t* enclave, uint64_t function_id);
+
+/* Fold the duration of a host function into the route of its ocalls */
+void oe_update_ocall_route(
+    oe_enclave_t* enclave,
+    uint64_t function_id,
+    uint64_t time_ns);
+
 void oe_host_worker_wait(oe_host_worker_context_t* context);
 
 void oe_host_worker_wake(oe_host_worker_context_t* context);
@@ -177,9 +177,8 @@ OE_DECLARE_SYSCALL2(SYS_fstat);
 OE_DECLARE_SYSCALL4(SYS_fstatat);
 OE_DECLARE_SYSCALL1_M(SYS_fsync);
 OE_DECLARE_SYSCALL2(SYS_ftruncate);
-// SYS_futex is needed for compiling musl/src/internal/pthread_impl.h
-// It doesn't have to be implemented.
-// It is called with 3 or 4 arguments.
+// SYS_futex is used by musl's internal locks and by std::atomic::wait.
+// It is called with 3 to 6 arguments.
 OE_DECLARE_SYSCALL3_M(SYS_futex);
 OE_DECLARE_SYSCALL2(SYS_getcwd);
 OE_DECLARE_SYSCALL3(SYS_getdents);
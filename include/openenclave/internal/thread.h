@@ -203,7 +203,7 @@ oe_result_t oe_spin_destroy(oe_spinlock_t* spinlock);
  */
 typedef struct _oe_mutex
 {
-    uint64_t __impl[4]; /**< Internal private implementation */
+    uint64_t __impl[5]; /**< Internal private implementation */
 } oe_mutex_t;
 
 /**
@@ -337,6 +337,32 @@ oe_result_t oe_cond_init(oe_cond_t* cond);
  */
 oe_result_t oe_cond_wait(oe_cond_t* cond, oe_mutex_t* mutex);
 
+/**
+ * Wait on a condition variable until it is signaled or a deadline passes.
+ *
+ * This function behaves like oe_cond_wait(), except that it gives up waiting
+ * once the realtime clock reaches **deadline_ns**. In either case, the
+ * caller holds the mutex again when this function returns.
+ *
+ * In enclaves, the host sleeps until the deadline, so the thread does not
+ * spin while it waits.
+ *
+ * @param cond Wait on this condition variable.
+ * @param mutex This mutex must be locked by the caller.
+ * @param deadline_ns The deadline in nanoseconds since the Epoch.
+ *
+ * @return OE_OK the condition variable was signaled
+ * @return OE_TIMEDOUT the deadline passed before the condition variable was
+ *         signaled
+ * @return OE_INVALID_PARAMETER one or more parameters is invalid
+ * @return OE_BUSY the mutex is not locked by the calling thread.
+ *
+ */
+oe_result_t oe_cond_timedwait(
+    oe_cond_t* cond,
+    oe_mutex_t* mutex,
+    uint64_t deadline_ns);
+
 /**
  * Signal a thread waiting on a condition variable.
  *
@@ -574,6 +600,57 @@ oe_result_t oe_rwlock_trywrlock(oe_rwlock_t* rw_lock);
  */
 oe_result_t oe_rwlock_destroy(oe_rwlock_t* rw_lock);
 
+/**
+ * Wait on a futex word.
+ *
+ * If the 32-bit word at **addr** still holds **value**, this function parks
+ * the calling thread until oe_futex_wake() wakes it with a bitset that
+ * shares a bit with **bitset**, or until the realtime clock reaches
+ * **deadline_ns**. The comparison and the queuing are atomic with respect to
+ * oe_futex_wake() on the same word. As with Linux futexes, callers must
+ * re-check the word after this function returns.
+ *
+ * @param addr The address of the futex word, aligned on 4 bytes.
+ * @param value The value the word is expected to hold.
+ * @param bitset Wake masks that may wake this waiter. Must not be zero.
+ * @param deadline_ns The deadline in nanoseconds since the Epoch, or
+ *        OE_UINT64_MAX to wait without a deadline.
+ *
+ * @return OE_OK the waiter was woken
+ * @return OE_BUSY the word did not hold **value**
+ * @return OE_TIMEDOUT the deadline passed before the waiter was woken
+ * @return OE_INVALID_PARAMETER one or more parameters is invalid
+ *
+ */
+oe_result_t oe_futex_wait(
+    volatile int32_t* addr,
+    int32_t value,
+    uint32_t bitset,
+    uint64_t deadline_ns);
+
+/**
+ * Wake threads waiting on a futex word.
+ *
+ * This function wakes up to **count** threads that wait on **addr** with a
+ * bitset that shares a bit with **bitset**, in the order they started
+ * waiting. Callers change the word before they call this function.
+ *
+ * @param addr The address of the futex word, aligned on 4 bytes.
+ * @param count The maximum number of threads to wake.
+ * @param bitset Wake only waiters whose bitset shares a bit with this one.
+ *        Must not be zero.
+ * @param num_woken If non-null, set to the number of threads woken.
+ *
+ * @return OE_OK the operation was successful
+ * @return OE_INVALID_PARAMETER one or more parameters is invalid
+ *
+ */
+oe_result_t oe_futex_wake(
+    volatile int32_t* addr,
+    uint32_t count,
+    uint32_t bitset,
+    uint32_t* num_woken);
+
 typedef uint32_t oe_thread_key_t;
 
 /**
@@ -36,6 +36,22 @@ OE_EXTERNC_BEGIN
 
 uint64_t oe_get_time(void);
 
+#ifndef OE_BUILD_ENCLAVE
+/*
+**==============================================================================
+**
+** oe_get_monotonic_time_ns()
+**
+**     Return nanoseconds elapsed since an unspecified starting point. Unlike
+**     oe_get_time(), the result is not affected by changes to the system
+**     clock, so it is suitable for measuring intervals. Host only.
+**
+**==============================================================================
+*/
+
+uint64_t oe_get_monotonic_time_ns(void);
+#endif
+
 #ifdef _WIN32
 /*
 **==============================================================================
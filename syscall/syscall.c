@@ -25,6 +25,8 @@
 #include <openenclave/internal/syscall/sys/uio.h>
 #include <openenclave/internal/syscall/sys/utsname.h>
 #include <openenclave/internal/syscall/unistd.h>
+#include <openenclave/internal/thread.h>
+#include <openenclave/internal/time.h>
 #include <openenclave/internal/trace.h>
 
 typedef int (*ioctl_proc)(
@@ -335,12 +337,118 @@ OE_WEAK OE_DEFINE_SYSCALL2(SYS_ftruncate)
     return oe_ftruncate(fd, length);
 }
 
+/* Linux futex operations (see linux/futex.h) */
+#define OE_FUTEX_WAIT 0
+#define OE_FUTEX_WAKE 1
+#define OE_FUTEX_WAIT_BITSET 9
+#define OE_FUTEX_WAKE_BITSET 10
+#define OE_FUTEX_PRIVATE_FLAG 128
+#define OE_FUTEX_CLOCK_REALTIME 256
+#define OE_FUTEX_BITSET_MATCH_ANY 0xffffffff
+
+/* Enclave memory is private to the enclave, so private and shared futexes
+ * are the same. The enclave only has the realtime clock, so absolute
+ * timeouts are taken as realtime whether or not FUTEX_CLOCK_REALTIME is
+ * set. */
 OE_WEAK OE_DEFINE_SYSCALL3_M(SYS_futex)
 {
-    OE_UNUSED(arg1);
-    OE_UNUSED(arg2);
-    OE_UNUSED(arg3);
-    return -1;
+    oe_va_list ap;
+    oe_va_start(ap, arg3);
+    long arg4 = oe_va_arg(ap, long);
+    long arg5 = oe_va_arg(ap, long);
+    long arg6 = oe_va_arg(ap, long);
+    oe_va_end(ap);
+
+    oe_errno = 0;
+    long ret = -1;
+    volatile int32_t* uaddr = (volatile int32_t*)arg1;
+    int op = (int)arg2 & ~(OE_FUTEX_PRIVATE_FLAG | OE_FUTEX_CLOCK_REALTIME);
+    const struct oe_timespec* timeout = (const struct oe_timespec*)arg4;
+    uint32_t bitset = OE_FUTEX_BITSET_MATCH_ANY;
+    uint64_t deadline_ns = OE_UINT64_MAX;
+    uint32_t num_woken = 0;
+    oe_result_t result;
+
+    OE_UNUSED(arg5);
+
+    if (op == OE_FUTEX_WAIT_BITSET || op == OE_FUTEX_WAKE_BITSET)
+        bitset = (uint32_t)arg6;
+
+    if (op == OE_FUTEX_WAKE || op == OE_FUTEX_WAKE_BITSET)
+    {
+        if (arg3 < 0 ||
+            oe_futex_wake(uaddr, (uint32_t)arg3, bitset, &num_woken) != OE_OK)
+        {
+            oe_errno = OE_EINVAL;
+            goto done;
+        }
+
+        ret = (long)num_woken;
+        goto done;
+    }
+
+    if (op != OE_FUTEX_WAIT && op != OE_FUTEX_WAIT_BITSET)
+    {
+        oe_errno = OE_ENOSYS;
+        goto done;
+    }
+
+    if (timeout)
+    {
+        uint64_t base_ns = 0;
+
+        if (timeout->tv_sec < 0 || timeout->tv_nsec < 0 ||
+            timeout->tv_nsec >= 1000000000)
+        {
+            oe_errno = OE_EINVAL;
+            goto done;
+        }
+
+        /* FUTEX_WAIT takes a relative timeout */
+        if (op == OE_FUTEX_WAIT)
+        {
+            uint64_t now_ms = oe_get_time();
+
+            /* The timeout cannot be honored without the current time */
+            if (now_ms == (uint64_t)-1)
+            {
+                oe_errno = OE_ENOSYS;
+                goto done;
+            }
+
+            base_ns = now_ms * 1000000;
+        }
+
+        /* Deadlines past the range of the clock never expire */
+        if ((uint64_t)timeout->tv_sec < OE_UINT64_MAX / 1000000000 / 2)
+        {
+            deadline_ns = base_ns + (uint64_t)timeout->tv_sec * 1000000000 +
+                          (uint64_t)timeout->tv_nsec;
+        }
+    }
+
+    result = oe_futex_wait(uaddr, (int32_t)arg3, bitset, deadline_ns);
+
+    if (result == OE_BUSY)
+    {
+        oe_errno = OE_EAGAIN;
+        goto done;
+    }
+    else if (result == OE_TIMEDOUT)
+    {
+        oe_errno = OE_ETIMEDOUT;
+        goto done;
+    }
+    else if (result != OE_OK)
+    {
+        oe_errno = OE_EINVAL;
+        goto done;
+    }
+
+    ret = 0;
+
+done:
+    return ret;
 }
 
 OE_WEAK OE_DEFINE_SYSCALL2(SYS_getcwd)
@@ -1199,6 +1307,7 @@ static long _syscall(
         OE_SYSCALL_DISPATCH(SYS_fstat, arg1, arg2);
         OE_SYSCALL_DISPATCH(SYS_fsync, arg1);
         OE_SYSCALL_DISPATCH(SYS_ftruncate, arg1, arg2);
+        OE_SYSCALL_DISPATCH(SYS_futex, arg1, arg2, arg3, arg4, arg5, arg6);
         OE_SYSCALL_DISPATCH(SYS_getcwd, arg1, arg2);
         OE_SYSCALL_DISPATCH(SYS_getdents64, arg1, arg2, arg3);
         OE_SYSCALL_DISPATCH(SYS_getegid);
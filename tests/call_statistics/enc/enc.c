@@ -0,0 +1,34 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+
+#include <openenclave/enclave.h>
+#include <openenclave/internal/tests.h>
+#include <stdlib.h>
+#include <string.h>
+#include "call_statistics_t.h"
+
+int enc_write(size_t size, int count)
+{
+    uint8_t* buffer = (uint8_t*)malloc(size);
+
+    OE_TEST(buffer != NULL);
+    memset(buffer, 0, size);
+
+    for (int i = 0; i < count; i++)
+        OE_TEST(host_write(buffer, size) == OE_OK);
+
+    free(buffer);
+    return 0;
+}
+
+void enc_nop(void)
+{
+}
+
+OE_SET_ENCLAVE_SGX(
+    1,    /* ProductID */
+    1,    /* SecurityVersion */
+    true, /* AllowDebug */
+    64,   /* HeapPageCount */
+    16,   /* StackPageCount */
+    1);   /* TCSCount */
@@ -0,0 +1,161 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+
+#include <openenclave/host.h>
+#include <openenclave/internal/error.h>
+#include <openenclave/internal/tests.h>
+#include <stdio.h>
+#include <string.h>
+#include "call_statistics_u.h"
+
+#define NUM_ECALLS 4
+#define NUM_WRITES 10
+#define WRITE_SIZE 1024
+#define BATCH_SIZE 16
+
+/* Marshalled size of the arguments of enc_nop, as computed by oeedger8r */
+#define ENC_NOP_BUFFER_SIZE                                           \
+    ((sizeof(enc_nop_args_t) + OE_EDGER8R_BUFFER_ALIGNMENT - 1) / \
+     OE_EDGER8R_BUFFER_ALIGNMENT * OE_EDGER8R_BUFFER_ALIGNMENT)
+
+void host_write(const uint8_t* buffer, size_t size)
+{
+    OE_UNUSED(buffer);
+    OE_UNUSED(size);
+}
+
+static void _write(oe_enclave_t* enclave)
+{
+    int ret = -1;
+
+    OE_TEST(enc_write(enclave, &ret, WRITE_SIZE, NUM_WRITES) == OE_OK);
+    OE_TEST(ret == 0);
+}
+
+static void _call_batch(oe_enclave_t* enclave)
+{
+    static uint64_t global_id = OE_GLOBAL_ECALL_ID_NULL;
+    static uint8_t input[BATCH_SIZE][ENC_NOP_BUFFER_SIZE];
+    static uint8_t output[BATCH_SIZE][ENC_NOP_BUFFER_SIZE];
+    oe_enclave_function_call_t calls[BATCH_SIZE];
+
+    memset(input, 0, sizeof(input));
+
+    for (size_t i = 0; i < BATCH_SIZE; i++)
+    {
+        calls[i].global_id = &global_id;
+        calls[i].name = "enc_nop";
+        calls[i].input_buffer = input[i];
+        calls[i].input_buffer_size = ENC_NOP_BUFFER_SIZE;
+        calls[i].output_buffer = output[i];
+        calls[i].output_buffer_size = ENC_NOP_BUFFER_SIZE;
+    }
+
+    OE_TEST(
+        oe_call_enclave_function_batch(enclave, calls, BATCH_SIZE) == OE_OK);
+
+    for (size_t i = 0; i < BATCH_SIZE; i++)
+        OE_TEST(calls[i].result == OE_OK);
+}
+
+static void _test_call_statistics(oe_enclave_t* enclave)
+{
+    oe_call_statistics_t statistics[64];
+    size_t count = 0;
+    bool found_write = false;
+    bool found_nop = false;
+    bool found_ocall = false;
+
+    // Query the number of called functions first.
+    OE_TEST(
+        oe_get_call_statistics(enclave, NULL, &count) == OE_BUFFER_TOO_SMALL);
+    OE_TEST(count > 0 && count <= OE_COUNTOF(statistics));
+
+    count = OE_COUNTOF(statistics);
+    OE_TEST(oe_get_call_statistics(enclave, statistics, &count) == OE_OK);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        const oe_call_statistics_t* entry = &statistics[i];
+        uint64_t num_bucketed = 0;
+
+        for (size_t b = 0; b < OE_CALL_LATENCY_BUCKETS; b++)
+            num_bucketed += entry->latency_buckets[b];
+
+        OE_TEST(num_bucketed == entry->num_calls);
+        OE_TEST(entry->max_time_ns <= entry->total_time_ns);
+        OE_TEST(entry->num_switchless_calls == 0);
+
+        if (entry->kind == OE_CALL_KIND_ECALL && entry->name &&
+            strcmp(entry->name, "enc_write") == 0)
+        {
+            OE_TEST(entry->num_calls == NUM_ECALLS);
+            found_write = true;
+        }
+
+        // Each call of a batch is counted.
+        if (entry->kind == OE_CALL_KIND_ECALL && entry->name &&
+            strcmp(entry->name, "enc_nop") == 0)
+        {
+            OE_TEST(entry->num_calls == BATCH_SIZE);
+            OE_TEST(entry->bytes_in == BATCH_SIZE * ENC_NOP_BUFFER_SIZE);
+            found_nop = true;
+        }
+
+        if (entry->kind == OE_CALL_KIND_OCALL &&
+            entry->function_id == call_statistics_fcn_id_host_write)
+        {
+            OE_TEST(entry->num_calls == NUM_ECALLS * NUM_WRITES);
+            OE_TEST(entry->bytes_in > NUM_ECALLS * NUM_WRITES * WRITE_SIZE);
+            found_ocall = true;
+        }
+    }
+
+    OE_TEST(found_write);
+    OE_TEST(found_nop);
+    OE_TEST(found_ocall);
+}
+
+int main(int argc, const char* argv[])
+{
+    oe_result_t result;
+    oe_enclave_t* enclave = NULL;
+    size_t count = 0;
+
+    if (argc != 2)
+    {
+        fprintf(stderr, "Usage: %s ENCLAVE_PATH\n", argv[0]);
+        return 1;
+    }
+
+    if ((result = oe_create_call_statistics_enclave(
+             argv[1],
+             OE_ENCLAVE_TYPE_SGX,
+             oe_get_create_flags(),
+             NULL,
+             0,
+             &enclave)) != OE_OK)
+        oe_put_err("oe_create_enclave(): result=%u", result);
+
+    // Calls are not counted until the statistics are enabled.
+    _write(enclave);
+    OE_TEST(oe_get_call_statistics(enclave, NULL, &count) == OE_OK);
+    OE_TEST(count == 0);
+
+    OE_TEST(oe_enable_call_statistics(NULL) == OE_INVALID_PARAMETER);
+    OE_TEST(oe_enable_call_statistics(enclave) == OE_OK);
+    OE_TEST(oe_enable_call_statistics(enclave) == OE_OK);
+
+    for (int i = 0; i < NUM_ECALLS; i++)
+        _write(enclave);
+
+    _call_batch(enclave);
+    _test_call_statistics(enclave);
+
+    result = oe_terminate_enclave(enclave);
+    OE_TEST(result == OE_OK);
+
+    printf("=== passed all tests (call_statistics)\n");
+
+    return 0;
+}
@@ -0,0 +1,88 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+
+#include <openenclave/enclave.h>
+#include <openenclave/internal/calls.h>
+#include <openenclave/internal/tests.h>
+#include "deferred_ocalls_t.h"
+
+static int _record(int first, int count)
+{
+    for (int i = first; i < first + count; i++)
+    {
+        if (host_record(i) != OE_OK)
+            return -1;
+    }
+
+    return 0;
+}
+
+int enc_record(int count, bool by_id)
+{
+    int recorded = -1;
+
+    if (by_id)
+        OE_TEST(
+            oe_set_ocall_deferred(
+                deferred_ocalls_fcn_id_host_record, true) == OE_OK);
+    else
+    {
+        OE_TEST(
+            oe_set_ocall_deferrable(
+                deferred_ocalls_fcn_id_host_record, true) == OE_OK);
+        oe_begin_deferred_ocalls();
+    }
+
+    // Queue more ocalls than fit in the host queue at once.
+    OE_TEST(_record(0, count) == 0);
+
+    if (!by_id)
+    {
+        // Ocalls that did not opt in return their outputs in the scope.
+        OE_TEST(host_get_count(&recorded) == OE_OK);
+        OE_TEST(recorded == count);
+        recorded = -1;
+
+        oe_end_deferred_ocalls();
+    }
+
+    // A regular ocall runs after the ocalls queued before it.
+    OE_TEST(host_get_count(&recorded) == OE_OK);
+    OE_TEST(recorded == count);
+
+    if (by_id)
+    {
+        // These are dispatched when the ecall returns.
+        OE_TEST(_record(count, count) == 0);
+        OE_TEST(
+            oe_set_ocall_deferred(
+                deferred_ocalls_fcn_id_host_record, false) == OE_OK);
+    }
+    else
+    {
+        oe_begin_deferred_ocalls();
+        OE_TEST(_record(count, count) == 0);
+        OE_TEST(oe_flush_deferred_ocalls() == OE_OK);
+        oe_end_deferred_ocalls();
+        OE_TEST(
+            oe_set_ocall_deferrable(
+                deferred_ocalls_fcn_id_host_record, false) == OE_OK);
+    }
+
+    OE_TEST(
+        oe_set_ocall_deferred(OE_MAX_DEFERRED_OCALL_ID, true) ==
+        OE_INVALID_PARAMETER);
+    OE_TEST(
+        oe_set_ocall_deferrable(OE_MAX_DEFERRED_OCALL_ID, true) ==
+        OE_INVALID_PARAMETER);
+
+    return 0;
+}
+
+OE_SET_ENCLAVE_SGX(
+    1,    /* ProductID */
+    1,    /* SecurityVersion */
+    true, /* Debug */
+    64,   /* NumHeapPages */
+    16,   /* NumStackPages */
+    1);   /* NumTCS */
@@ -0,0 +1,67 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+
+#include <openenclave/host.h>
+#include <openenclave/internal/error.h>
+#include <openenclave/internal/tests.h>
+#include <stdio.h>
+#include "deferred_ocalls_u.h"
+
+#define NUM_RECORDS 1000
+
+static int _count;
+
+void host_record(int value)
+{
+    // Deferred ocalls must run in the order they were made.
+    OE_TEST(value == _count);
+    _count++;
+}
+
+int host_get_count(void)
+{
+    return _count;
+}
+
+static void _test(oe_enclave_t* enclave, bool by_id)
+{
+    int ret = -1;
+
+    _count = 0;
+    OE_TEST(enc_record(enclave, &ret, NUM_RECORDS, by_id) == OE_OK);
+    OE_TEST(ret == 0);
+
+    // All ocalls have run by the time the ecall returns.
+    OE_TEST(_count == 2 * NUM_RECORDS);
+}
+
+int main(int argc, const char* argv[])
+{
+    oe_result_t result;
+    oe_enclave_t* enclave = NULL;
+
+    if (argc != 2)
+    {
+        fprintf(stderr, "Usage: %s ENCLAVE_PATH\n", argv[0]);
+        return 1;
+    }
+
+    if ((result = oe_create_deferred_ocalls_enclave(
+             argv[1],
+             OE_ENCLAVE_TYPE_SGX,
+             oe_get_create_flags(),
+             NULL,
+             0,
+             &enclave)) != OE_OK)
+        oe_put_err("oe_create_enclave(): result=%u", result);
+
+    _test(enclave, false);
+    _test(enclave, true);
+
+    result = oe_terminate_enclave(enclave);
+    OE_TEST(result == OE_OK);
+
+    printf("=== passed all tests (deferred_ocalls)\n");
+
+    return 0;
+}
@@ -0,0 +1,40 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+
+#include <openenclave/enclave.h>
+#include <openenclave/internal/calls.h>
+#include <openenclave/internal/tests.h>
+#include "ecall_buffer_t.h"
+
+void enc_get_statistics(ecall_buffer_statistics_t* statistics)
+{
+    oe_ecall_buffer_statistics_t s;
+
+    oe_get_ecall_buffer_statistics(&s);
+    statistics->num_reused = s.num_reused;
+    statistics->num_allocated = s.num_allocated;
+    statistics->bytes_cached = s.bytes_cached;
+}
+
+uint64_t enc_sum(const uint8_t* buffer, size_t size)
+{
+    uint64_t sum = 0;
+
+    for (size_t i = 0; i < size; i++)
+        sum += buffer[i];
+
+    return sum;
+}
+
+uint64_t enc_sum_switchless(const uint8_t* buffer, size_t size)
+{
+    return enc_sum(buffer, size);
+}
+
+OE_SET_ENCLAVE_SGX(
+    1,    /* ProductID */
+    1,    /* SecurityVersion */
+    true, /* AllowDebug */
+    1024, /* HeapPageCount */
+    64,   /* StackPageCount */
+    2);   /* TCSCount */
@@ -0,0 +1,175 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+
+#include <openenclave/host.h>
+#include <openenclave/internal/error.h>
+#include <openenclave/internal/tests.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "ecall_buffer_u.h"
+
+#define NUM_CALLS 100
+
+/* Mirror the limits of enclave/core/sgx/ecallbuffer.c */
+#define SHRINK_AFTER 64
+#define MAX_CACHED_CAPACITY (256 * 1024)
+
+#define SMALL_SIZE 1024
+#define NESTED_SIZE (8 * 1024)
+#define LARGE_SIZE (64 * 1024)
+#define HUGE_SIZE (2 * MAX_CACHED_CAPACITY)
+
+static uint8_t _buffer[HUGE_SIZE];
+
+static void _get_statistics(
+    oe_enclave_t* enclave,
+    ecall_buffer_statistics_t* statistics)
+{
+    OE_TEST(enc_get_statistics(enclave, statistics) == OE_OK);
+}
+
+static void _sum(oe_enclave_t* enclave, size_t size, int count, bool nested)
+{
+    uint64_t expected = 0;
+
+    for (size_t i = 0; i < size; i++)
+        expected += _buffer[i];
+
+    for (int i = 0; i < count; i++)
+    {
+        uint64_t sum = 0;
+
+        if (nested)
+            OE_TEST(
+                enc_sum_switchless(enclave, &sum, _buffer, size) == OE_OK);
+        else
+            OE_TEST(enc_sum(enclave, &sum, _buffer, size) == OE_OK);
+
+        OE_TEST(sum == expected);
+    }
+}
+
+static void _test_steady_state(oe_enclave_t* enclave)
+{
+    ecall_buffer_statistics_t before;
+    ecall_buffer_statistics_t after;
+
+    _sum(enclave, SMALL_SIZE, NUM_CALLS, false);
+    _get_statistics(enclave, &before);
+
+    // Same-sized ecalls reuse the buffer; the last one reads the counters.
+    _sum(enclave, SMALL_SIZE, NUM_CALLS, false);
+    _get_statistics(enclave, &after);
+    OE_TEST(after.num_allocated == before.num_allocated);
+    OE_TEST(after.num_reused == before.num_reused + NUM_CALLS + 1);
+    OE_TEST(after.bytes_cached == before.bytes_cached);
+}
+
+static void _test_grow_and_shrink(oe_enclave_t* enclave)
+{
+    ecall_buffer_statistics_t before;
+    ecall_buffer_statistics_t grown;
+    ecall_buffer_statistics_t after;
+
+    _get_statistics(enclave, &before);
+
+    // An ecall larger than the buffer grows it once.
+    _sum(enclave, LARGE_SIZE, 1, false);
+    _get_statistics(enclave, &grown);
+    OE_TEST(grown.num_allocated == before.num_allocated + 1);
+    OE_TEST(grown.bytes_cached >= before.bytes_cached + LARGE_SIZE);
+
+    // Further large ecalls reuse the grown buffer.
+    _sum(enclave, LARGE_SIZE, NUM_CALLS, false);
+    _get_statistics(enclave, &after);
+    OE_TEST(after.num_allocated == grown.num_allocated);
+    OE_TEST(after.bytes_cached == grown.bytes_cached);
+
+    // Small ecalls do not keep the large buffer around.
+    _sum(enclave, SMALL_SIZE, SHRINK_AFTER, false);
+    _get_statistics(enclave, &after);
+    OE_TEST(after.num_allocated == grown.num_allocated);
+    OE_TEST(after.bytes_cached < grown.bytes_cached);
+
+    // Ecalls beyond the cached limit use the heap every time and do not grow
+    // the buffer.
+    before = after;
+    _sum(enclave, HUGE_SIZE, 2, false);
+    _get_statistics(enclave, &after);
+    OE_TEST(after.num_allocated == before.num_allocated + 2);
+    OE_TEST(after.bytes_cached <= before.bytes_cached);
+}
+
+static void _test_nested(oe_enclave_t* enclave)
+{
+    ecall_buffer_statistics_t before;
+    ecall_buffer_statistics_t after;
+    oe_switchless_statistics_t switchless;
+
+    _get_statistics(enclave, &before);
+
+    // Switchless ecalls are handled inside the ecall of the enclave worker
+    // and take the region of its buffer after that of the worker ecall.
+    _sum(enclave, SMALL_SIZE, NUM_CALLS, true);
+    _get_statistics(enclave, &after);
+    OE_TEST(after.num_allocated == before.num_allocated);
+    OE_TEST(after.num_reused == before.num_reused + NUM_CALLS + 1);
+
+    // A nested ecall that does not fit next to the worker ecall uses the
+    // heap; the buffer in use is not resized under the worker.
+    before = after;
+    _sum(enclave, NESTED_SIZE, 1, true);
+    _get_statistics(enclave, &after);
+    OE_TEST(after.num_allocated == before.num_allocated + 1);
+    OE_TEST(after.bytes_cached <= before.bytes_cached);
+
+    // The worker ecall still has its parameters and keeps serving calls.
+    _sum(enclave, SMALL_SIZE, NUM_CALLS, true);
+
+    OE_TEST(
+        oe_get_switchless_statistics(enclave, &switchless, NULL, NULL) ==
+        OE_OK);
+    OE_TEST(switchless.ecalls_missed == 0);
+    OE_TEST(switchless.ecalls_posted == 2 * NUM_CALLS + 1);
+}
+
+int main(int argc, const char* argv[])
+{
+    oe_result_t result;
+    oe_enclave_t* enclave = NULL;
+    oe_enclave_setting_context_switchless_t switchless_setting = {
+        .max_enclave_workers = 1};
+    oe_enclave_setting_t settings[] = {{
+        .setting_type = OE_ENCLAVE_SETTING_CONTEXT_SWITCHLESS,
+        .u.context_switchless_setting = &switchless_setting,
+    }};
+
+    if (argc != 2)
+    {
+        fprintf(stderr, "Usage: %s ENCLAVE_PATH\n", argv[0]);
+        return 1;
+    }
+
+    for (size_t i = 0; i < sizeof(_buffer); i++)
+        _buffer[i] = (uint8_t)(i * 7);
+
+    if ((result = oe_create_ecall_buffer_enclave(
+             argv[1],
+             OE_ENCLAVE_TYPE_SGX,
+             oe_get_create_flags(),
+             settings,
+             OE_COUNTOF(settings),
+             &enclave)) != OE_OK)
+        oe_put_err("oe_create_enclave(): result=%u", result);
+
+    _test_steady_state(enclave);
+    _test_grow_and_shrink(enclave);
+    _test_nested(enclave);
+
+    result = oe_terminate_enclave(enclave);
+    OE_TEST(result == OE_OK);
+
+    printf("=== passed all tests (ecall_buffer)\n");
+
+    return 0;
+}
@@ -0,0 +1,18 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+
+#include <openenclave/enclave.h>
+#include <openenclave/internal/tests.h>
+#include "ecall_contention_t.h"
+
+void enc_nop(void)
+{
+}
+
+OE_SET_ENCLAVE_SGX(
+    1,                             /* ProductID */
+    1,                             /* SecurityVersion */
+    true,                          /* Debug */
+    OE_TEST_MT_HEAP_SIZE(NUM_TCS), /* NumHeapPages */
+    16,                            /* NumStackPages */
+    NUM_TCS);                      /* NumTCS */
@@ -0,0 +1,272 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+
+#include <inttypes.h>
+#include <openenclave/host.h>
+#include <openenclave/internal/error.h>
+#include <openenclave/internal/tests.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../../../host/hostthread.h"
+#include "../../../host/strings.h"
+#include "ecall_contention_u.h"
+
+#define DEFAULT_NUM_THREADS 32
+#define DEFAULT_NUM_ITERATIONS 20000
+#define BATCH_SIZE 64
+
+/* Marshalled size of the arguments of enc_nop, as computed by oeedger8r */
+#define ENC_NOP_BUFFER_SIZE                                           \
+    ((sizeof(enc_nop_args_t) + OE_EDGER8R_BUFFER_ALIGNMENT - 1) / \
+     OE_EDGER8R_BUFFER_ALIGNMENT * OE_EDGER8R_BUFFER_ALIGNMENT)
+
+#if defined(__linux__)
+
+static double get_relative_time_in_microseconds()
+{
+    struct timespec current_time;
+    clock_gettime(CLOCK_MONOTONIC, &current_time);
+    return (double)current_time.tv_sec * 1000000 +
+           (double)current_time.tv_nsec / 1000.0;
+}
+
+#elif defined(_WIN32)
+
+#include <Windows.h>
+
+static double frequency;
+static double get_relative_time_in_microseconds()
+{
+    LARGE_INTEGER current_time;
+    QueryPerformanceCounter(&current_time);
+    return current_time.QuadPart / frequency;
+}
+
+#endif
+
+static oe_enclave_t* _enclave;
+
+typedef struct _thread_info
+{
+    oe_thread_t tid;
+    uint64_t iterations;
+    uint64_t failures;
+} thread_info_t;
+
+static void* _thread(void* arg)
+{
+    thread_info_t* info = (thread_info_t*)arg;
+
+    for (uint64_t i = 0; i < info->iterations; i++)
+    {
+        if (enc_nop(_enclave) != OE_OK)
+            info->failures++;
+    }
+
+    return NULL;
+}
+
+static void _run(uint64_t num_threads, uint64_t iterations)
+{
+    thread_info_t* info = (thread_info_t*)calloc(num_threads, sizeof(*info));
+    double start, elapsed;
+    uint64_t failures = 0;
+
+    OE_TEST(info != NULL);
+
+    start = get_relative_time_in_microseconds();
+
+    for (uint64_t i = 0; i < num_threads; i++)
+    {
+        int ret = 0;
+        info[i].iterations = iterations;
+        if ((ret = oe_thread_create(&info[i].tid, _thread, &info[i])))
+            oe_put_err("thread_create(host): ret=%u", ret);
+    }
+
+    for (uint64_t i = 0; i < num_threads; i++)
+    {
+        oe_thread_join(info[i].tid);
+        failures += info[i].failures;
+    }
+
+    elapsed = get_relative_time_in_microseconds() - start;
+
+    printf(
+        "nop: %" PRIu64 " threads x %" PRIu64 " ecalls in %.0f msecs "
+        "(%.0f ecalls/sec)\n",
+        num_threads,
+        iterations,
+        elapsed / 1000.0,
+        (double)(num_threads * iterations) * 1000000.0 / elapsed);
+
+    OE_TEST(failures == 0);
+    free(info);
+}
+
+// Issue enc_nop through oe_call_enclave_function_batch(), BATCH_SIZE calls
+// per enclave transition.
+static void _run_batch(uint64_t iterations)
+{
+    static uint64_t global_id = OE_GLOBAL_ECALL_ID_NULL;
+    static uint8_t input[BATCH_SIZE][ENC_NOP_BUFFER_SIZE];
+    static uint8_t output[BATCH_SIZE][ENC_NOP_BUFFER_SIZE];
+    oe_enclave_function_call_t calls[BATCH_SIZE];
+    uint64_t num_batches = (iterations + BATCH_SIZE - 1) / BATCH_SIZE;
+    double start, elapsed;
+
+    memset(input, 0, sizeof(input));
+    start = get_relative_time_in_microseconds();
+
+    for (uint64_t n = 0; n < num_batches; n++)
+    {
+        for (size_t i = 0; i < BATCH_SIZE; i++)
+        {
+            calls[i].global_id = &global_id;
+            calls[i].name = "enc_nop";
+            calls[i].input_buffer = input[i];
+            calls[i].input_buffer_size = ENC_NOP_BUFFER_SIZE;
+            calls[i].output_buffer = output[i];
+            calls[i].output_buffer_size = ENC_NOP_BUFFER_SIZE;
+        }
+
+        memset(output, 0xff, sizeof(output));
+        OE_TEST(
+            oe_call_enclave_function_batch(_enclave, calls, BATCH_SIZE) ==
+            OE_OK);
+
+        for (size_t i = 0; i < BATCH_SIZE; i++)
+        {
+            OE_TEST(calls[i].result == OE_OK);
+            OE_TEST(calls[i].output_bytes_written == ENC_NOP_BUFFER_SIZE);
+            OE_TEST(((enc_nop_args_t*)output[i])->oe_result == OE_OK);
+        }
+    }
+
+    elapsed = get_relative_time_in_microseconds() - start;
+
+    printf(
+        "batch: %" PRIu64 " ecalls in batches of %d in %.0f msecs "
+        "(%.0f ecalls/sec)\n",
+        num_batches * BATCH_SIZE,
+        BATCH_SIZE,
+        elapsed / 1000.0,
+        (double)(num_batches * BATCH_SIZE) * 1000000.0 / elapsed);
+
+    // An invalid buffer fails its own call only.
+    calls[1].input_buffer_size = 1;
+    OE_TEST(oe_call_enclave_function_batch(_enclave, calls, 2) == OE_OK);
+    OE_TEST(calls[0].result == OE_OK);
+    OE_TEST(calls[1].result == OE_INVALID_PARAMETER);
+}
+
+int main(int argc, const char* argv[])
+{
+    oe_result_t result;
+    uint64_t num_threads = DEFAULT_NUM_THREADS;
+    uint64_t iterations = DEFAULT_NUM_ITERATIONS;
+    bool wait_queue = false;
+    oe_enclave_setting_thread_wait_queue_t wait_queue_setting = {0, 0};
+    oe_enclave_setting_t settings[] = {
+        {.setting_type = OE_ENCLAVE_SETTING_THREAD_WAIT_QUEUE,
+         .u.thread_wait_queue_setting = &wait_queue_setting}};
+
+    if (argc < 2)
+    {
+    print_usage:
+        fprintf(
+            stderr,
+            "Usage: %s ENCLAVE_PATH [--threads n] [--iterations n] "
+            "[--wait-queue]\n",
+            argv[0]);
+        return 1;
+    }
+
+    {
+        int i = 2;
+        while (i < argc)
+        {
+            if (strcmp(argv[i], "--threads") == 0)
+            {
+                if (++i == argc)
+                    goto print_usage;
+                sscanf_s(argv[i], "%" SCNu64, &num_threads);
+            }
+            else if (strcmp(argv[i], "--iterations") == 0)
+            {
+                if (++i == argc)
+                    goto print_usage;
+                sscanf_s(argv[i], "%" SCNu64, &iterations);
+            }
+            else if (strcmp(argv[i], "--wait-queue") == 0)
+            {
+                wait_queue = true;
+            }
+            else
+                goto print_usage;
+
+            ++i;
+        }
+    }
+
+    // Each thread needs its own TCS, so only oversubscribe the enclave when
+    // threads can wait for a TCS to be released.
+    if (num_threads > NUM_TCS && !wait_queue)
+        num_threads = NUM_TCS;
+
+#if defined(_WIN32)
+    {
+        LARGE_INTEGER freq;
+        QueryPerformanceFrequency(&freq);
+        frequency = (double)freq.QuadPart / 1000000; // microseconds
+    }
+#endif
+
+    if ((result = oe_create_ecall_contention_enclave(
+             argv[1],
+             OE_ENCLAVE_TYPE_SGX,
+             oe_get_create_flags(),
+             wait_queue ? settings : NULL,
+             wait_queue ? OE_COUNTOF(settings) : 0,
+             &_enclave)) != OE_OK)
+        oe_put_err("oe_create_enclave(): result=%u", result);
+
+    _run(num_threads, iterations);
+    _run_batch(iterations);
+
+    if (wait_queue)
+    {
+        oe_thread_wait_queue_statistics_t stats;
+
+        OE_TEST(oe_get_thread_wait_queue_statistics(_enclave, &stats) == OE_OK);
+        OE_TEST(stats.queue_depth == 0);
+        OE_TEST(stats.total_timeouts == 0);
+        OE_TEST(stats.total_rejected == 0);
+        OE_TEST(stats.max_queue_depth <= num_threads);
+
+        printf(
+            "wait queue: %" PRIu64 " waits, max depth %" PRIu64
+            ", avg wait %" PRIu64 " ns, max wait %" PRIu64 " ns\n",
+            stats.total_waits,
+            stats.max_queue_depth,
+            stats.total_waits ? stats.total_wait_time_ns / stats.total_waits
+                              : 0,
+            stats.max_wait_time_ns);
+    }
+    else
+    {
+        oe_thread_wait_queue_statistics_t stats;
+        OE_TEST(
+            oe_get_thread_wait_queue_statistics(_enclave, &stats) ==
+            OE_NOT_FOUND);
+    }
+
+    result = oe_terminate_enclave(_enclave);
+    OE_TEST(result == OE_OK);
+
+    printf("=== passed all tests (ecall_contention)\n");
+
+    return 0;
+}
@@ -125,6 +125,11 @@ void enc_edl_opt_out()
     /* sgx/switchless.edl */
     OE_TEST(oe_sgx_sleep_switchless_worker_ocall(NULL) == OE_UNSUPPORTED);
     OE_TEST(oe_sgx_wake_switchless_worker_ocall(NULL) == OE_UNSUPPORTED);
+    OE_TEST(oe_sgx_wait_switchless_ocall_ocall(NULL) == OE_UNSUPPORTED);
+
+    /* sgx/thread.edl */
+    OE_TEST(
+        oe_sgx_thread_wake_multiple_ocall(NULL, NULL, 0) == OE_UNSUPPORTED);
 
     /* sgx/attestation */
     {
@@ -66,11 +66,11 @@ int main(int argc, const char* argv[])
     /* sgx/switchless.edl */
     result = OE_OK;
     OE_TEST(
-        oe_sgx_init_context_switchless_ecall(NULL, &result, NULL, 0) ==
-        OE_UNSUPPORTED);
+        oe_sgx_init_context_switchless_ecall(
+            NULL, &result, 0, NULL, 0, NULL, NULL, 0) == OE_UNSUPPORTED);
     OE_TEST(result == OE_UNSUPPORTED);
     OE_TEST(
-        oe_sgx_switchless_enclave_worker_thread_ecall(NULL, NULL) ==
+        oe_sgx_switchless_enclave_worker_thread_ecall(NULL, NULL, NULL) ==
         OE_UNSUPPORTED);
 #endif
 
@@ -0,0 +1,106 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+
+#include <openenclave/enclave.h>
+#include <openenclave/internal/tests.h>
+#include <pthread.h>
+#include "mutex_contention_t.h"
+
+static pthread_mutex_t _mutex = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t _count;
+
+int enc_contend(uint64_t iterations, uint64_t hold_pauses)
+{
+    for (uint64_t i = 0; i < iterations; i++)
+    {
+        if (pthread_mutex_lock(&_mutex) != 0)
+            return -1;
+
+        _count++;
+
+        for (uint64_t j = 0; j < hold_pauses; j++)
+            asm volatile("pause");
+
+        if (pthread_mutex_unlock(&_mutex) != 0)
+            return -1;
+    }
+
+    return 0;
+}
+
+uint64_t enc_get_count(void)
+{
+    uint64_t count;
+
+    pthread_mutex_lock(&_mutex);
+    count = _count;
+    pthread_mutex_unlock(&_mutex);
+
+    return count;
+}
+
+static pthread_mutex_t _herd_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t _herd_cond = PTHREAD_COND_INITIALIZER;
+static uint64_t _herd_generation;
+static uint64_t _herd_waiting;
+
+int enc_herd_wait(uint64_t rounds)
+{
+    pthread_mutex_lock(&_herd_mutex);
+
+    for (uint64_t i = 0; i < rounds; i++)
+    {
+        uint64_t generation = _herd_generation;
+
+        _herd_waiting++;
+
+        while (_herd_generation == generation)
+        {
+            if (pthread_cond_wait(&_herd_cond, &_herd_mutex) != 0)
+            {
+                pthread_mutex_unlock(&_herd_mutex);
+                return -1;
+            }
+        }
+    }
+
+    pthread_mutex_unlock(&_herd_mutex);
+
+    return 0;
+}
+
+int enc_herd_broadcast(uint64_t rounds, uint64_t waiters)
+{
+    for (uint64_t i = 0; i < rounds; i++)
+    {
+        pthread_mutex_lock(&_herd_mutex);
+
+        while (_herd_waiting < waiters)
+        {
+            pthread_mutex_unlock(&_herd_mutex);
+            asm volatile("pause");
+            pthread_mutex_lock(&_herd_mutex);
+        }
+
+        _herd_waiting = 0;
+        _herd_generation++;
+
+        if (pthread_cond_broadcast(&_herd_cond) != 0)
+        {
+            pthread_mutex_unlock(&_herd_mutex);
+            return -1;
+        }
+
+        pthread_mutex_unlock(&_herd_mutex);
+    }
+
+    return 0;
+}
+
+OE_SET_ENCLAVE_SGX(
+    1,                             /* ProductID */
+    1,                             /* SecurityVersion */
+    true,                          /* Debug */
+    OE_TEST_MT_HEAP_SIZE(NUM_TCS), /* NumHeapPages */
+    16,                            /* NumStackPages */
+    NUM_TCS);                      /* NumTCS */
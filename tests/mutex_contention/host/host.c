@@ -0,0 +1,257 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+
+#include <inttypes.h>
+#include <openenclave/host.h>
+#include <openenclave/internal/error.h>
+#include <openenclave/internal/tests.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../../../host/hostthread.h"
+#include "../../../host/strings.h"
+#include "mutex_contention_u.h"
+
+#define DEFAULT_NUM_THREADS 8
+#define DEFAULT_NUM_ITERATIONS 100000
+#define DEFAULT_HOLD_PAUSES 16
+
+#if defined(__linux__)
+
+static double get_relative_time_in_microseconds()
+{
+    struct timespec current_time;
+    clock_gettime(CLOCK_MONOTONIC, &current_time);
+    return (double)current_time.tv_sec * 1000000 +
+           (double)current_time.tv_nsec / 1000.0;
+}
+
+#elif defined(_WIN32)
+
+#include <Windows.h>
+
+static double frequency;
+static double get_relative_time_in_microseconds()
+{
+    LARGE_INTEGER current_time;
+    QueryPerformanceCounter(&current_time);
+    return current_time.QuadPart / frequency;
+}
+
+#endif
+
+static oe_enclave_t* _enclave;
+
+typedef struct _thread_info
+{
+    oe_thread_t tid;
+    uint64_t iterations;
+    uint64_t hold_pauses;
+    uint64_t failures;
+} thread_info_t;
+
+static void* _thread(void* arg)
+{
+    thread_info_t* info = (thread_info_t*)arg;
+    oe_result_t result;
+    int ret = -1;
+
+    result = enc_contend(_enclave, &ret, info->iterations, info->hold_pauses);
+    if (result != OE_OK || ret != 0)
+        info->failures++;
+
+    return NULL;
+}
+
+// All threads lock the same mutex in the enclave. Waiters that spin through
+// short critical sections avoid the two enclave exits of parking and waking.
+static void _run(uint64_t num_threads, uint64_t iterations, uint64_t hold)
+{
+    thread_info_t* info = (thread_info_t*)calloc(num_threads, sizeof(*info));
+    uint64_t count_before = 0;
+    uint64_t count_after = 0;
+    uint64_t failures = 0;
+    double start, elapsed;
+
+    OE_TEST(info != NULL);
+    OE_TEST(enc_get_count(_enclave, &count_before) == OE_OK);
+
+    start = get_relative_time_in_microseconds();
+
+    for (uint64_t i = 0; i < num_threads; i++)
+    {
+        int ret = 0;
+        info[i].iterations = iterations;
+        info[i].hold_pauses = hold;
+        if ((ret = oe_thread_create(&info[i].tid, _thread, &info[i])))
+            oe_put_err("thread_create(host): ret=%u", ret);
+    }
+
+    for (uint64_t i = 0; i < num_threads; i++)
+    {
+        oe_thread_join(info[i].tid);
+        failures += info[i].failures;
+    }
+
+    elapsed = get_relative_time_in_microseconds() - start;
+
+    OE_TEST(failures == 0);
+    OE_TEST(enc_get_count(_enclave, &count_after) == OE_OK);
+    OE_TEST(count_after - count_before == num_threads * iterations);
+
+    printf(
+        "hold %" PRIu64 " pauses: %" PRIu64 " threads x %" PRIu64
+        " locks in %.0f msecs (%.0f locks/sec)\n",
+        hold,
+        num_threads,
+        iterations,
+        elapsed / 1000.0,
+        (double)(num_threads * iterations) * 1000000.0 / elapsed);
+
+    free(info);
+}
+
+static void* _herd_thread(void* arg)
+{
+    thread_info_t* info = (thread_info_t*)arg;
+    int ret = -1;
+
+    if (enc_herd_wait(_enclave, &ret, info->iterations) != OE_OK || ret != 0)
+        info->failures++;
+
+    return NULL;
+}
+
+// Waiters on one condition variable are all woken by each broadcast. The
+// broadcast wakes them in batches, each costing a single enclave exit.
+static void _run_herd(uint64_t num_waiters, uint64_t rounds)
+{
+    thread_info_t* info = (thread_info_t*)calloc(num_waiters, sizeof(*info));
+    uint64_t failures = 0;
+    double start, elapsed;
+    int ret = -1;
+
+    OE_TEST(info != NULL);
+
+    start = get_relative_time_in_microseconds();
+
+    for (uint64_t i = 0; i < num_waiters; i++)
+    {
+        int err = 0;
+        info[i].iterations = rounds;
+        if ((err = oe_thread_create(&info[i].tid, _herd_thread, &info[i])))
+            oe_put_err("thread_create(host): ret=%u", err);
+    }
+
+    OE_TEST(enc_herd_broadcast(_enclave, &ret, rounds, num_waiters) == OE_OK);
+    OE_TEST(ret == 0);
+
+    for (uint64_t i = 0; i < num_waiters; i++)
+    {
+        oe_thread_join(info[i].tid);
+        failures += info[i].failures;
+    }
+
+    elapsed = get_relative_time_in_microseconds() - start;
+
+    OE_TEST(failures == 0);
+
+    printf(
+        "broadcast to %" PRIu64 " waiters: %" PRIu64
+        " rounds in %.0f msecs (%.1f usecs/round)\n",
+        num_waiters,
+        rounds,
+        elapsed / 1000.0,
+        elapsed / (double)rounds);
+
+    free(info);
+}
+
+int main(int argc, const char* argv[])
+{
+    oe_result_t result;
+    uint64_t num_threads = DEFAULT_NUM_THREADS;
+    uint64_t iterations = DEFAULT_NUM_ITERATIONS;
+    uint64_t hold = DEFAULT_HOLD_PAUSES;
+    uint32_t flags = oe_get_create_flags();
+
+    if (argc < 2)
+    {
+    print_usage:
+        fprintf(
+            stderr,
+            "Usage: %s ENCLAVE_PATH [--threads n] [--iterations n] "
+            "[--hold pauses] [--simulation]\n",
+            argv[0]);
+        return 1;
+    }
+
+    {
+        int i = 2;
+        while (i < argc)
+        {
+            if (strcmp(argv[i], "--threads") == 0)
+            {
+                if (++i == argc)
+                    goto print_usage;
+                sscanf_s(argv[i], "%" SCNu64, &num_threads);
+            }
+            else if (strcmp(argv[i], "--iterations") == 0)
+            {
+                if (++i == argc)
+                    goto print_usage;
+                sscanf_s(argv[i], "%" SCNu64, &iterations);
+            }
+            else if (strcmp(argv[i], "--hold") == 0)
+            {
+                if (++i == argc)
+                    goto print_usage;
+                sscanf_s(argv[i], "%" SCNu64, &hold);
+            }
+            else if (strcmp(argv[i], "--simulation") == 0)
+            {
+                flags |= OE_ENCLAVE_FLAG_SIMULATE;
+            }
+            else
+                goto print_usage;
+
+            ++i;
+        }
+    }
+
+    if (num_threads > NUM_TCS)
+        num_threads = NUM_TCS;
+
+#if defined(_WIN32)
+    {
+        LARGE_INTEGER freq;
+        QueryPerformanceFrequency(&freq);
+        frequency = (double)freq.QuadPart / 1000000; // microseconds
+    }
+#endif
+
+    if ((result = oe_create_mutex_contention_enclave(
+             argv[1], OE_ENCLAVE_TYPE_SGX, flags, NULL, 0, &_enclave)) !=
+        OE_OK)
+        oe_put_err("oe_create_enclave(): result=%u", result);
+
+    // Uncontended, short and long critical sections.
+    _run(1, iterations, hold);
+    _run(num_threads, iterations, 0);
+    _run(num_threads, iterations, hold);
+    _run(num_threads, iterations / 100, hold * 1000);
+
+    // The broadcasting thread takes one of the TCSs.
+    if (num_threads == NUM_TCS)
+        num_threads--;
+
+    _run_herd(num_threads, iterations / 100);
+
+    result = oe_terminate_enclave(_enclave);
+    OE_TEST(result == OE_OK);
+
+    printf("=== passed all tests (mutex_contention)\n");
+
+    return 0;
+}
@@ -0,0 +1,33 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+
+#include <openenclave/enclave.h>
+#include <openenclave/internal/tests.h>
+#include <stdlib.h>
+#include "ocall_buffer_t.h"
+
+int enc_read(size_t size, int count)
+{
+    uint8_t* buffer = (uint8_t*)malloc(size);
+
+    OE_TEST(buffer != NULL);
+
+    for (int i = 0; i < count; i++)
+    {
+        OE_TEST(host_read(buffer, size) == OE_OK);
+
+        for (size_t j = 0; j < size; j++)
+            OE_TEST(buffer[j] == (uint8_t)(j + size));
+    }
+
+    free(buffer);
+    return 0;
+}
+
+OE_SET_ENCLAVE_SGX(
+    1,    /* ProductID */
+    1,    /* SecurityVersion */
+    true, /* AllowDebug */
+    1024, /* HeapPageCount */
+    64,   /* StackPageCount */
+    1);   /* TCSCount */
@@ -0,0 +1,102 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+
+#include <openenclave/host.h>
+#include <openenclave/internal/error.h>
+#include <openenclave/internal/tests.h>
+#include <stdio.h>
+#include "ocall_buffer_u.h"
+
+#define NUM_READS 10
+#define SMALL_READ_SIZE (8 * 1024)
+#define READ_SIZE (64 * 1024)
+
+/* Both sizes differ from the host defaults (16 KB and 1 MB) */
+#define INITIAL_OCALL_BUFFER_SIZE (4 * 1024)
+#define MAX_OCALL_BUFFER_SIZE (256 * 1024)
+
+void host_read(uint8_t* buffer, size_t size)
+{
+    for (size_t i = 0; i < size; i++)
+        buffer[i] = (uint8_t)(i + size);
+}
+
+static void _read(oe_enclave_t* enclave, size_t size, int count)
+{
+    int ret = -1;
+
+    OE_TEST(enc_read(enclave, &ret, size, count) == OE_OK);
+    OE_TEST(ret == 0);
+}
+
+int main(int argc, const char* argv[])
+{
+    oe_result_t result;
+    oe_enclave_t* enclave = NULL;
+    oe_enclave_setting_ocall_buffer_t ocall_buffer_setting = {
+        INITIAL_OCALL_BUFFER_SIZE, MAX_OCALL_BUFFER_SIZE};
+    oe_enclave_setting_t settings[] = {{
+        .setting_type = OE_ENCLAVE_SETTING_OCALL_BUFFER,
+        .u.ocall_buffer_setting = &ocall_buffer_setting,
+    }};
+    oe_ocall_buffer_statistics_t statistics;
+
+    if (argc != 2)
+    {
+        fprintf(stderr, "Usage: %s ENCLAVE_PATH\n", argv[0]);
+        return 1;
+    }
+
+    if ((result = oe_create_ocall_buffer_enclave(
+             argv[1],
+             OE_ENCLAVE_TYPE_SGX,
+             oe_get_create_flags(),
+             settings,
+             OE_COUNTOF(settings),
+             &enclave)) != OE_OK)
+        oe_put_err("oe_create_enclave(): result=%u", result);
+
+    // Small reads fit in the initial buffer.
+    _read(enclave, 1024, NUM_READS);
+    OE_TEST(oe_get_ocall_buffer_statistics(enclave, &statistics) == OE_OK);
+    OE_TEST(statistics.total_misses == 0);
+    OE_TEST(statistics.total_grows == 0);
+
+    // Reads that fit the default buffer miss the smaller initial one.
+    _read(enclave, SMALL_READ_SIZE, NUM_READS);
+    OE_TEST(oe_get_ocall_buffer_statistics(enclave, &statistics) == OE_OK);
+    OE_TEST(statistics.total_misses == NUM_READS);
+    OE_TEST(statistics.total_grows == 1);
+    OE_TEST(statistics.max_miss_size > SMALL_READ_SIZE);
+    OE_TEST(statistics.max_buffer_size >= statistics.max_miss_size);
+
+    // Large reads miss until the ecall returns and the buffer grows.
+    _read(enclave, READ_SIZE, NUM_READS);
+    OE_TEST(oe_get_ocall_buffer_statistics(enclave, &statistics) == OE_OK);
+    OE_TEST(statistics.total_misses == 2 * NUM_READS);
+    OE_TEST(statistics.total_grows == 2);
+    OE_TEST(statistics.max_miss_size > READ_SIZE);
+    OE_TEST(statistics.max_buffer_size >= statistics.max_miss_size);
+    OE_TEST(statistics.max_buffer_size <= MAX_OCALL_BUFFER_SIZE);
+
+    // The grown buffer is used from then on.
+    _read(enclave, READ_SIZE, NUM_READS);
+    OE_TEST(oe_get_ocall_buffer_statistics(enclave, &statistics) == OE_OK);
+    OE_TEST(statistics.total_misses == 2 * NUM_READS);
+    OE_TEST(statistics.total_grows == 2);
+
+    // Reads beyond the max size keep allocating host memory. With the
+    // default max size, the buffer would have grown to fit them.
+    _read(enclave, 2 * MAX_OCALL_BUFFER_SIZE, 1);
+    OE_TEST(oe_get_ocall_buffer_statistics(enclave, &statistics) == OE_OK);
+    OE_TEST(statistics.total_misses == 2 * NUM_READS + 1);
+    OE_TEST(statistics.total_grows == 2);
+    OE_TEST(statistics.max_buffer_size <= MAX_OCALL_BUFFER_SIZE);
+
+    result = oe_terminate_enclave(enclave);
+    OE_TEST(result == OE_OK);
+
+    printf("=== passed all tests (ocall_buffer)\n");
+
+    return 0;
+}
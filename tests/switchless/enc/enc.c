@@ -105,6 +105,121 @@ int enc_echo_regular(
     return 0;
 }
 
+static uint64_t _sum;
+
+void enc_async_add(uint64_t value)
+{
+    __atomic_add_fetch(&_sum, value, __ATOMIC_SEQ_CST);
+}
+
+uint64_t enc_get_sum(void)
+{
+    return __atomic_load_n(&_sum, __ATOMIC_SEQ_CST);
+}
+
+/* Marshalled size of the arguments of host_async_add, as computed by
+ * oeedger8r */
+#define HOST_ASYNC_ADD_BUFFER_SIZE                                           \
+    ((sizeof(host_async_add_args_t) + OE_EDGER8R_BUFFER_ALIGNMENT - 1) / \
+     OE_EDGER8R_BUFFER_ALIGNMENT * OE_EDGER8R_BUFFER_ALIGNMENT)
+
+#define NUM_ASYNC_SLOTS 8
+
+typedef struct _async_slot
+{
+    oe_ocall_handle_t* handle;
+    host_async_add_args_t* input;
+    host_async_add_args_t* output;
+} async_slot_t;
+
+static void _wait_async_slot(async_slot_t* slot)
+{
+    size_t output_bytes_written = 0;
+
+    OE_TEST(oe_ocall_wait(slot->handle, &output_bytes_written) == OE_OK);
+    OE_TEST(output_bytes_written == HOST_ASYNC_ADD_BUFFER_SIZE);
+    OE_TEST(slot->output->oe_result == OE_OK);
+    slot->handle = NULL;
+}
+
+// Keep several switchless ocalls in flight from a single enclave thread.
+int enc_test_async_ocalls(uint64_t count)
+{
+    async_slot_t slots[NUM_ASYNC_SLOTS];
+    uint64_t sum = 0;
+
+    for (size_t i = 0; i < NUM_ASYNC_SLOTS; i++)
+    {
+        // The host reads and writes the buffers while the enclave runs.
+        slots[i].handle = NULL;
+        slots[i].input = oe_host_malloc(HOST_ASYNC_ADD_BUFFER_SIZE);
+        slots[i].output = oe_host_malloc(HOST_ASYNC_ADD_BUFFER_SIZE);
+        OE_TEST(slots[i].input && slots[i].output);
+    }
+
+    for (uint64_t i = 0; i < count; i++)
+    {
+        async_slot_t* slot = &slots[i % NUM_ASYNC_SLOTS];
+
+        if (slot->handle)
+            _wait_async_slot(slot);
+
+        memset(slot->input, 0, HOST_ASYNC_ADD_BUFFER_SIZE);
+        slot->input->value = i;
+
+        OE_TEST(
+            oe_call_host_function_async(
+                switchless_test_fcn_id_host_async_add,
+                slot->input,
+                HOST_ASYNC_ADD_BUFFER_SIZE,
+                slot->output,
+                HOST_ASYNC_ADD_BUFFER_SIZE,
+                &slot->handle) == OE_OK);
+    }
+
+    // A wait with an invalid parameter still completes the call.
+    if (slots[0].handle)
+        _wait_async_slot(&slots[0]);
+
+    memset(slots[0].input, 0, HOST_ASYNC_ADD_BUFFER_SIZE);
+    slots[0].input->value = count;
+
+    OE_TEST(
+        oe_call_host_function_async(
+            switchless_test_fcn_id_host_async_add,
+            slots[0].input,
+            HOST_ASYNC_ADD_BUFFER_SIZE,
+            slots[0].output,
+            HOST_ASYNC_ADD_BUFFER_SIZE,
+            &slots[0].handle) == OE_OK);
+    OE_TEST(oe_ocall_wait(slots[0].handle, NULL) == OE_INVALID_PARAMETER);
+    slots[0].handle = NULL;
+
+    for (size_t i = 0; i < NUM_ASYNC_SLOTS; i++)
+    {
+        if (slots[i].handle)
+            _wait_async_slot(&slots[i]);
+
+        oe_host_free(slots[i].input);
+        oe_host_free(slots[i].output);
+    }
+
+    OE_TEST(host_get_sum(&sum) == OE_OK);
+    OE_TEST(sum == count * (count + 1) / 2);
+
+    return 0;
+}
+
+int enc_test_blocking_ocalls(uint64_t count, uint32_t milliseconds)
+{
+    // Each call outlasts the spin of the caller, which then parks until the
+    // host worker wakes it.
+    for (uint64_t i = 0; i < count; i++)
+        OE_TEST(host_sleep(milliseconds) == OE_OK);
+
+    return 0;
+}
+
 OE_SET_ENCLAVE_SGX(
     1,                             /* ProductID */
     1,                             /* SecurityVersion */
@@ -416,6 +416,335 @@ void test_switchless_ecalls(
         (double)regular_microseconds / switchless_max);
 }
 
+static uint64_t _host_sum;
+
+void host_async_add(uint64_t value)
+{
+    __atomic_add_fetch(&_host_sum, value, __ATOMIC_SEQ_CST);
+}
+
+uint64_t host_get_sum(void)
+{
+    return __atomic_load_n(&_host_sum, __ATOMIC_SEQ_CST);
+}
+
+void host_sleep(uint32_t milliseconds)
+{
+#if defined(__linux__)
+    struct timespec duration;
+
+    duration.tv_sec = milliseconds / 1000;
+    duration.tv_nsec = (long)(milliseconds % 1000) * 1000000;
+    nanosleep(&duration, NULL);
+#elif defined(_WIN32)
+    Sleep(milliseconds);
+#endif
+}
+
+void test_blocking_switchless_ocalls(oe_enclave_t* enclave)
+{
+    const uint64_t count = 10;
+    const uint32_t milliseconds = 20;
+    int return_val = -1;
+    double start, end;
+
+    start = get_relative_time_in_microseconds();
+    OE_TEST(
+        enc_test_blocking_ocalls(enclave, &return_val, count, milliseconds) ==
+        OE_OK);
+    OE_TEST(return_val == 0);
+    end = get_relative_time_in_microseconds();
+
+    OE_TEST(end - start >= (double)count * milliseconds * 1000);
+
+    printf(
+        "%d blocking switchless OCALLs took %d msecs.\n",
+        (int)count,
+        (int)((end - start) / 1000.0));
+}
+
+void test_async_switchless_ocalls(oe_enclave_t* enclave)
+{
+    int return_val = -1;
+    double start, end;
+
+    start = get_relative_time_in_microseconds();
+    OE_TEST(
+        enc_test_async_ocalls(enclave, &return_val, NUM_OCALLS) == OE_OK);
+    OE_TEST(return_val == 0);
+    end = get_relative_time_in_microseconds();
+
+    printf(
+        "%d asynchronous switchless OCALLs took %d msecs.\n",
+        NUM_OCALLS,
+        (int)((end - start) / 1000.0));
+}
+
+/* Number of calls, and of switchless calls, to the given ocall */
+static void _get_ocall_counts(
+    oe_enclave_t* enclave,
+    uint64_t function_id,
+    uint64_t* num_calls,
+    uint64_t* num_switchless_calls)
+{
+    static oe_call_statistics_t statistics[64];
+    size_t count = OE_COUNTOF(statistics);
+
+    *num_calls = 0;
+    *num_switchless_calls = 0;
+    OE_TEST(oe_get_call_statistics(enclave, statistics, &count) == OE_OK);
+
+    for (size_t i = 0; i < count; i++)
+    {
+        if (statistics[i].kind == OE_CALL_KIND_OCALL &&
+            statistics[i].function_id == function_id)
+        {
+            *num_calls = statistics[i].num_calls;
+            *num_switchless_calls = statistics[i].num_switchless_calls;
+        }
+    }
+}
+
+void test_ocall_routes(oe_enclave_t* enclave)
+{
+    const uint64_t echo_switchless =
+        switchless_test_fcn_id_host_echo_switchless;
+    const uint64_t echo_regular = switchless_test_fcn_id_host_echo_regular;
+    char out[STRING_LEN];
+    int return_val;
+    uint64_t calls[2];
+    uint64_t switchless[2];
+
+    // The calls are counted through the call statistics.
+    OE_TEST(oe_enable_call_statistics(enclave) == OE_OK);
+
+    OE_TEST(
+        oe_set_ocall_route(enclave, echo_switchless, __OE_OCALL_ROUTE_MAX) ==
+        OE_INVALID_PARAMETER);
+
+    // Routed as regular calls, switchless ocalls bypass the workers.
+    OE_TEST(
+        oe_set_ocall_route(enclave, echo_switchless, OE_OCALL_ROUTE_REGULAR) ==
+        OE_OK);
+    _get_ocall_counts(enclave, echo_switchless, &calls[0], &switchless[0]);
+    make_repeated_switchless_ocalls(enclave);
+    _get_ocall_counts(enclave, echo_switchless, &calls[1], &switchless[1]);
+    OE_TEST(calls[1] - calls[0] == NUM_OCALLS);
+    OE_TEST(switchless[1] == switchless[0]);
+
+    // Routed as switchless calls, regular ocalls go to the workers.
+    OE_TEST(
+        oe_set_ocall_route(enclave, echo_regular, OE_OCALL_ROUTE_SWITCHLESS) ==
+        OE_OK);
+    _get_ocall_counts(enclave, echo_regular, &calls[0], &switchless[0]);
+    OE_TEST(
+        enc_test_echo_regular(
+            enclave, &return_val, "Hello World", out, NUM_OCALLS) == OE_OK);
+    OE_TEST(return_val == 0);
+    _get_ocall_counts(enclave, echo_regular, &calls[1], &switchless[1]);
+    OE_TEST(calls[1] - calls[0] == NUM_OCALLS);
+    OE_TEST(switchless[1] > switchless[0]);
+
+    // The echo returns quickly, so the automatic route picks the workers
+    // once it has been measured.
+    OE_TEST(
+        oe_set_ocall_route(enclave, echo_regular, OE_OCALL_ROUTE_AUTO) ==
+        OE_OK);
+    _get_ocall_counts(enclave, echo_regular, &calls[0], &switchless[0]);
+    OE_TEST(
+        enc_test_echo_regular(
+            enclave, &return_val, "Hello World", out, NUM_OCALLS) == OE_OK);
+    OE_TEST(return_val == 0);
+    _get_ocall_counts(enclave, echo_regular, &calls[1], &switchless[1]);
+    OE_TEST(switchless[1] > switchless[0]);
+
+    OE_TEST(
+        oe_set_ocall_route(enclave, echo_switchless, OE_OCALL_ROUTE_DEFAULT) ==
+        OE_OK);
+    OE_TEST(
+        oe_set_ocall_route(enclave, echo_regular, OE_OCALL_ROUTE_DEFAULT) ==
+        OE_OK);
+}
+
+void test_switchless_statistics(
+    oe_enclave_t* enclave,
+    oe_enclave_t* enclave_normal,
+    bool ecalls)
+{
+    oe_switchless_statistics_t statistics;
+    oe_switchless_worker_statistics_t workers[2 * NUM_TCS];
+    size_t num_workers = 0;
+    uint64_t calls[2] = {0, 0};
+
+    OE_TEST(
+        oe_get_switchless_statistics(enclave_normal, &statistics, NULL, NULL) ==
+        OE_NOT_FOUND);
+
+    OE_TEST(
+        oe_get_switchless_statistics(enclave, NULL, workers, &num_workers) ==
+        OE_BUFFER_TOO_SMALL);
+    OE_TEST(num_workers > 0 && num_workers <= OE_COUNTOF(workers));
+    OE_TEST(
+        oe_get_switchless_statistics(
+            enclave, &statistics, workers, &num_workers) == OE_OK);
+    OE_TEST(
+        num_workers ==
+        statistics.num_host_workers + statistics.num_enclave_workers);
+
+    for (size_t i = 0; i < num_workers; i++)
+        calls[workers[i].kind] += workers[i].num_calls;
+
+    if (ecalls)
+    {
+        OE_TEST(statistics.ecalls_posted > 0);
+        OE_TEST(calls[OE_SWITCHLESS_WORKER_KIND_ENCLAVE] > 0);
+        OE_TEST(statistics.max_ecall_wait_time_ns > 0);
+    }
+    else
+    {
+        OE_TEST(statistics.ocalls_posted > 0);
+        OE_TEST(calls[OE_SWITCHLESS_WORKER_KIND_HOST] > 0);
+    }
+
+    printf(
+        "Switchless workers handled %" PRIu64 " ocalls and %" PRIu64
+        " ecalls, %" PRIu64 " ocalls and %" PRIu64 " ecalls missed.\n",
+        calls[OE_SWITCHLESS_WORKER_KIND_HOST],
+        calls[OE_SWITCHLESS_WORKER_KIND_ENCLAVE],
+        statistics.ocalls_missed,
+        statistics.ecalls_missed);
+}
+
+void test_shared_switchless_ocalls(
+    oe_enclave_t* enclave1,
+    oe_enclave_t* enclave2,
+    oe_enclave_t* enclave_normal)
+{
+    thread_info_t tinfo[2] = {{0, enclave1, 0.0}, {0, enclave2, 0.0}};
+    oe_switchless_pool_usage_t usage1;
+    oe_switchless_pool_usage_t usage2;
+
+    // Both enclaves make ocalls at the same time through the shared pool.
+    for (size_t i = 0; i < OE_COUNTOF(tinfo); i++)
+        OE_TEST(
+            oe_thread_create(&tinfo[i].tid, launch_enclave_thread, &tinfo[i]) ==
+            0);
+
+    for (size_t i = 0; i < OE_COUNTOF(tinfo); i++)
+        oe_thread_join(tinfo[i].tid);
+
+    OE_TEST(oe_get_switchless_pool_usage(enclave1, &usage1) == OE_OK);
+    OE_TEST(oe_get_switchless_pool_usage(enclave2, &usage2) == OE_OK);
+    OE_TEST(usage1.num_enclaves == 2 && usage2.num_enclaves == 2);
+    OE_TEST(usage1.num_calls > 0 && usage2.num_calls > 0);
+    OE_TEST(
+        oe_get_switchless_pool_usage(enclave_normal, &usage1) == OE_NOT_FOUND);
+
+    printf(
+        "Shared pool handled %" PRIu64 " and %" PRIu64 " switchless ocalls.\n",
+        usage1.num_calls,
+        usage2.num_calls);
+}
+
+/* Marshalled size of the arguments of enc_async_add, as computed by oeedger8r */
+#define ENC_ASYNC_ADD_BUFFER_SIZE                                           \
+    ((sizeof(enc_async_add_args_t) + OE_EDGER8R_BUFFER_ALIGNMENT - 1) / \
+     OE_EDGER8R_BUFFER_ALIGNMENT * OE_EDGER8R_BUFFER_ALIGNMENT)
+
+#define MAX_ASYNC_IN_FLIGHT 64
+
+typedef struct _async_slot
+{
+    oe_ecall_handle_t* handle;
+    union {
+        enc_async_add_args_t args;
+        uint8_t buffer[ENC_ASYNC_ADD_BUFFER_SIZE];
+    } input, output;
+} async_slot_t;
+
+static void _async_add_completed(
+    oe_ecall_handle_t* handle,
+    oe_result_t result,
+    void* arg)
+{
+    OE_UNUSED(handle);
+    OE_TEST(result == OE_OK);
+    (*(uint64_t*)arg)++;
+}
+
+static void _wait_async_slot(async_slot_t* slot)
+{
+    size_t output_bytes_written = 0;
+
+    OE_TEST(oe_ecall_wait(slot->handle, &output_bytes_written) == OE_OK);
+    OE_TEST(output_bytes_written == ENC_ASYNC_ADD_BUFFER_SIZE);
+    OE_TEST(slot->output.args.oe_result == OE_OK);
+    slot->handle = NULL;
+}
+
+// Keep several switchless ecalls in flight from a single host thread.
+void test_async_switchless_ecalls(oe_enclave_t* enclave, uint64_t num_workers)
+{
+    static uint64_t global_id = OE_GLOBAL_ECALL_ID_NULL;
+    static async_slot_t slots[MAX_ASYNC_IN_FLIGHT];
+    uint64_t num_slots = 2 * num_workers;
+    uint64_t completed = 0;
+    uint64_t sum = 0;
+    double start, end;
+
+    if (num_slots > MAX_ASYNC_IN_FLIGHT)
+        num_slots = MAX_ASYNC_IN_FLIGHT;
+
+    start = get_relative_time_in_microseconds();
+
+    for (uint64_t i = 0; i < NUM_ECALLS; i++)
+    {
+        async_slot_t* slot = &slots[i % num_slots];
+
+        if (slot->handle)
+            _wait_async_slot(slot);
+
+        memset(&slot->input, 0, sizeof(slot->input));
+        memset(&slot->output, 0xff, sizeof(slot->output));
+        slot->input.args.value = i;
+
+        OE_TEST(
+            oe_switchless_call_enclave_function_async(
+                enclave,
+                &global_id,
+                "enc_async_add",
+                &slot->input,
+                sizeof(slot->input),
+                &slot->output,
+                sizeof(slot->output),
+                _async_add_completed,
+                &completed,
+                &slot->handle) == OE_OK);
+
+        // Completion may be observed before the wait.
+        oe_ecall_poll(slot->handle);
+    }
+
+    for (uint64_t i = 0; i < num_slots; i++)
+    {
+        if (slots[i].handle)
+            _wait_async_slot(&slots[i]);
+    }
+
+    end = get_relative_time_in_microseconds();
+
+    OE_TEST(completed == NUM_ECALLS);
+    OE_TEST(enc_get_sum(enclave, &sum) == OE_OK);
+    OE_TEST(sum == (uint64_t)NUM_ECALLS * (NUM_ECALLS - 1) / 2);
+
+    printf(
+        "%d asynchronous switchless ECALLs (%" PRIu64
+        " in flight) took %d msecs.\n",
+        NUM_ECALLS,
+        num_slots,
+        (int)((end - start) / 1000.0));
+}
+
 int main(int argc, const char* argv[])
 {
     oe_enclave_t *enclave_switchless = NULL, *enclave_normal = NULL;
@@ -427,7 +756,7 @@ int main(int argc, const char* argv[])
         fprintf(
             stderr,
             "Usage: %s ENCLAVE_PATH [--host-threads n] [--enclave-threads n] "
-            "[--ecalls]\n",
+            "[--ecalls] [--share-host-workers]\n",
             argv[0]);
         return 1;
     }
@@ -435,6 +764,8 @@ int main(int argc, const char* argv[])
     uint64_t num_host_threads = 1;
     uint64_t num_enclave_threads = 2;
     bool test_ecalls = false;
+    bool share_host_workers = false;
+    oe_enclave_t* enclave_shared = NULL;
 
     {
         int i = 2;
@@ -456,6 +787,10 @@ int main(int argc, const char* argv[])
             {
                 test_ecalls = true;
             }
+            else if (strcmp(argv[i], "--share-host-workers") == 0)
+            {
+                share_host_workers = true;
+            }
             else
                 goto print_usage;
 
@@ -476,7 +811,10 @@ int main(int argc, const char* argv[])
     if (test_ecalls)
         switchless_setting.max_enclave_workers = num_enclave_threads;
     else
+    {
         switchless_setting.max_host_workers = num_host_threads;
+        switchless_setting.share_host_workers = share_host_workers;
+    }
 
     oe_enclave_setting_t settings[] = {
         {.setting_type = OE_ENCLAVE_SETTING_CONTEXT_SWITCHLESS,
@@ -496,12 +834,46 @@ int main(int argc, const char* argv[])
         OE_OK)
         oe_put_err("oe_create_enclave(): result=%u", result);
 
+    if (share_host_workers &&
+        (result = oe_create_switchless_test_enclave(
+             argv[1],
+             OE_ENCLAVE_TYPE_SGX,
+             flags,
+             settings,
+             OE_COUNTOF(settings),
+             &enclave_shared)) != OE_OK)
+        oe_put_err("oe_create_enclave(): result=%u", result);
+
     if (test_ecalls)
+    {
+        // The wait times of switchless ecalls come with the call statistics.
+        OE_TEST(oe_enable_call_statistics(enclave_switchless) == OE_OK);
+
         test_switchless_ecalls(
             enclave_switchless, enclave_normal, num_host_threads);
+        test_async_switchless_ecalls(enclave_switchless, num_enclave_threads);
+        test_switchless_statistics(enclave_switchless, enclave_normal, true);
+    }
+    else if (share_host_workers)
+    {
+        test_shared_switchless_ocalls(
+            enclave_switchless, enclave_shared, enclave_normal);
+
+        result = oe_terminate_enclave(enclave_shared);
+        OE_TEST(result == OE_OK);
+
+        // The pool keeps serving the remaining enclave.
+        test_async_switchless_ocalls(enclave_switchless);
+    }
     else
+    {
         test_switchless_ocalls(
             enclave_switchless, enclave_normal, num_enclave_threads);
+        test_async_switchless_ocalls(enclave_switchless);
+        test_blocking_switchless_ocalls(enclave_switchless);
+        test_ocall_routes(enclave_switchless);
+        test_switchless_statistics(enclave_switchless, enclave_normal, false);
+    }
 
     result = oe_terminate_enclave(enclave_switchless);
     OE_TEST(result == OE_OK);
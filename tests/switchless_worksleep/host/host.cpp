@@ -7,9 +7,11 @@
 #include <openenclave/internal/error.h>
 #include <openenclave/internal/tests.h>
 #include <openenclave/internal/thread.h>
+#include <atomic>
 #include <chrono>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <thread>
 #include <vector>
 #include "../../../host/hostthread.h"
@@ -17,6 +19,14 @@
 #include "switchless_worksleep_u.h"
 using namespace std;
 
+// Pools of the elastic test: one worker at first, up to two under load
+#define ELASTIC_MAX_WORKERS 2
+#define ELASTIC_APP_THREADS 4
+
+// Generous limits for the pools to grow and retire on loaded machines
+#define GROW_TIMEOUT_MS 30000
+#define RETIRE_TIMEOUT_MS 60000
+
 // global counters to increment in ocalls
 uint32_t ocall1_counter = 0;
 uint32_t ocall2_counter = 0;
@@ -86,19 +96,152 @@ void* thread_func(void* arg)
     return NULL;
 }
 
+static atomic<bool> burst_stopping(false);
+
+/**
+ * burst worker method
+ * call ecall1 and ecall2 until the burst is stopped
+ */
+void* burst_thread_func(void* arg)
+{
+    uint32_t fails = 0;
+    oe_enclave_t* enclave = (oe_enclave_t*)arg;
+
+    while (!burst_stopping)
+    {
+        if (enc_ecall1_switchless(enclave) != OE_OK)
+            fails++;
+        if (enc_ecall2_switchless(enclave) != OE_OK)
+            fails++;
+    }
+    OE_TEST(fails == 0);
+    return NULL;
+}
+
+static void get_active_workers(
+    oe_enclave_t* enclave,
+    uint64_t* host_workers,
+    uint64_t* enclave_workers)
+{
+    oe_switchless_statistics_t statistics;
+
+    OE_TEST(
+        oe_get_switchless_statistics(enclave, &statistics, NULL, NULL) ==
+        OE_OK);
+    OE_TEST(statistics.num_host_workers == ELASTIC_MAX_WORKERS);
+    OE_TEST(statistics.num_enclave_workers == ELASTIC_MAX_WORKERS);
+    *host_workers = statistics.num_active_host_workers;
+    *enclave_workers = statistics.num_active_enclave_workers;
+}
+
+/**
+ * Elastic pools start with their min number of workers, grow to their max
+ * under a burst of calls, and shrink back once idle. The timing depends on
+ * the scheduler, so only check that both happen within generous limits.
+ */
+static void test_elastic_pools(const char* path)
+{
+    oe_enclave_t* enclave = NULL;
+    oe_result_t result;
+    oe_enclave_setting_context_switchless_t switchless_setting = {
+        ELASTIC_MAX_WORKERS, ELASTIC_MAX_WORKERS, 1, 1};
+    oe_enclave_setting_t setting;
+    vector<oe_thread_t> app_threads;
+    oe_thread_t thread;
+    uint64_t host_workers = 0;
+    uint64_t enclave_workers = 0;
+    uint64_t max_host_workers = 0;
+    uint64_t max_enclave_workers = 0;
+    int ret = 0;
+
+    printf("Run elastic pool test.\n");
+
+    setting.setting_type = OE_ENCLAVE_SETTING_CONTEXT_SWITCHLESS;
+    setting.u.context_switchless_setting = &switchless_setting;
+
+    if ((result = oe_create_switchless_worksleep_enclave(
+             path,
+             OE_ENCLAVE_TYPE_SGX,
+             oe_get_create_flags(),
+             &setting,
+             1,
+             &enclave)) != OE_OK)
+        oe_put_err("oe_create_enclave(): result=%u", result);
+
+    get_active_workers(enclave, &host_workers, &enclave_workers);
+    OE_TEST(host_workers == 1);
+    OE_TEST(enclave_workers == 1);
+
+    // Queue more calls than one worker of each pool keeps up with, until
+    // both pools have grown.
+    burst_stopping = false;
+
+    for (uint32_t i = 0; i < ELASTIC_APP_THREADS; i++)
+    {
+        if ((ret = oe_thread_create(&thread, burst_thread_func, enclave)))
+        {
+            oe_put_err("thread_create(host): ret=%u", ret);
+        }
+        app_threads.push_back(thread);
+    }
+
+    auto end =
+        chrono::steady_clock::now() + chrono::milliseconds(GROW_TIMEOUT_MS);
+    while (chrono::steady_clock::now() < end &&
+           (max_host_workers < ELASTIC_MAX_WORKERS ||
+            max_enclave_workers < ELASTIC_MAX_WORKERS))
+    {
+        get_active_workers(enclave, &host_workers, &enclave_workers);
+        if (host_workers > max_host_workers)
+            max_host_workers = host_workers;
+        if (enclave_workers > max_enclave_workers)
+            max_enclave_workers = enclave_workers;
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+
+    burst_stopping = true;
+
+    for (size_t i = 0; i < app_threads.size(); i++)
+    {
+        oe_thread_join(app_threads[i]);
+    }
+
+    printf(
+        "Burst ran up to (%d) host and (%d) enclave workers\n",
+        (int)max_host_workers,
+        (int)max_enclave_workers);
+    OE_TEST(max_host_workers >= ELASTIC_MAX_WORKERS);
+    OE_TEST(max_enclave_workers >= ELASTIC_MAX_WORKERS);
+
+    // Idle workers retire after about a second of idleness.
+    end = chrono::steady_clock::now() + chrono::milliseconds(RETIRE_TIMEOUT_MS);
+    do
+    {
+        this_thread::sleep_for(chrono::milliseconds(100));
+        get_active_workers(enclave, &host_workers, &enclave_workers);
+    } while ((host_workers > 1 || enclave_workers > 1) &&
+             chrono::steady_clock::now() < end);
+
+    OE_TEST(host_workers == 1);
+    OE_TEST(enclave_workers == 1);
+
+    OE_TEST(oe_terminate_enclave(enclave) == OE_OK);
+}
+
 int main(int argc, const char* argv[])
 {
     oe_enclave_t* enclave = NULL;
     oe_result_t result;
+    bool elastic = false;
 
-    if (argc != 2)
+    if (argc == 3 && strcmp(argv[2], "--elastic") == 0)
+        elastic = true;
+    else if (argc != 2)
     {
-        fprintf(stderr, "Usage: %s ENCLAVE\n", argv[0]);
+        fprintf(stderr, "Usage: %s ENCLAVE [--elastic]\n", argv[0]);
         exit(1);
     }
 
-    printf("Run Sleep-Wake test.\n");
-
     // check number of cores, need at least 4
     uint32_t cores = thread::hardware_concurrency();
     // if not enough cores, exit, but don't fail the test
@@ -110,6 +253,15 @@ int main(int argc, const char* argv[])
     }
     printf("Test System runs (%d) CPUs\n", cores);
 
+    if (elastic)
+    {
+        test_elastic_pools(argv[1]);
+        printf("=== passed all tests (switchless_worksleep_elastic)\n");
+        return 0;
+    }
+
+    printf("Run Sleep-Wake test.\n");
+
     uint32_t workers = cores / 4;
 
     printf(
@@ -132,6 +284,12 @@ int main(int argc, const char* argv[])
         OE_OK)
         oe_put_err("oe_create_enclave(): result=%u", result);
 
+    // Spin only briefly so that the workers go to sleep and wake up often.
+    OE_TEST(
+        oe_set_switchless_spin_policy(enclave, 2000, 1000) ==
+        OE_INVALID_PARAMETER);
+    OE_TEST(oe_set_switchless_spin_policy(enclave, 1000, 50000) == OE_OK);
+
     vector<oe_thread_t> app_threads;
     uint32_t app_workers = cores - workers - workers;
     printf("Launching (%d) application threads\n", app_workers);
@@ -5,11 +5,13 @@
 #include "thread.h"
 #endif
 
+#include <errno.h>
 #include <openenclave/enclave.h>
 #include <openenclave/internal/tests.h>
 #include <openenclave/internal/thread.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <time.h>
 #include "thread_t.h"
 
 static oe_mutex_t mutex = OE_MUTEX_INITIALIZER;
@@ -105,3 +107,58 @@ void cb_test_signal_thread_impl()
     // from either of the calls and then check the exit_thread flag and quit.
     oe_mutex_unlock(&mutex);
 }
+
+static oe_mutex_t timed_mutex = OE_MUTEX_INITIALIZER;
+static oe_cond_t timed_cond = OE_COND_INITIALIZER;
+static bool timed_signaled = false;
+
+// Wait on timed_cond until it is signaled or timeout_ms elapses.
+// Returns 0 if signaled and 1 if the wait timed out.
+int enc_cond_timedwait(uint64_t timeout_ms)
+{
+    struct timespec deadline;
+    int timed_out = 0;
+
+    OE_TEST(clock_gettime(CLOCK_REALTIME, &deadline) == 0);
+    deadline.tv_sec += (time_t)(timeout_ms / 1000);
+    deadline.tv_nsec += (long)((timeout_ms % 1000) * 1000000);
+
+    if (deadline.tv_nsec >= 1000000000)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+
+    oe_mutex_lock(&timed_mutex);
+
+    while (!timed_signaled && !timed_out)
+    {
+#ifdef _PTHREAD_ENC_
+        int r = pthread_cond_timedwait(&timed_cond, &timed_mutex, &deadline);
+
+        OE_TEST(r == 0 || r == ETIMEDOUT);
+        timed_out = (r == ETIMEDOUT);
+#else
+        uint64_t deadline_ns =
+            (uint64_t)deadline.tv_sec * 1000000000 + (uint64_t)deadline.tv_nsec;
+        int r = oe_cond_timedwait(&timed_cond, &timed_mutex, deadline_ns);
+
+        OE_TEST(r == OE_OK || r == OE_TIMEDOUT);
+        timed_out = (r == OE_TIMEDOUT);
+#endif
+    }
+
+    // The timed-out waiter must still hold the mutex
+    timed_signaled = false;
+    oe_mutex_unlock(&timed_mutex);
+
+    return timed_out;
+}
+
+void enc_cond_timedwait_signal()
+{
+    oe_mutex_lock(&timed_mutex);
+    timed_signaled = true;
+    oe_cond_signal(&timed_cond);
+    oe_mutex_unlock(&timed_mutex);
+}
@@ -0,0 +1,78 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+
+#include <errno.h>
+#include <limits.h>
+#include <openenclave/enclave.h>
+#include <openenclave/internal/tests.h>
+#include <stdint.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#include "thread_t.h"
+
+// From linux/futex.h, which the enclave libc does not ship.
+#ifndef FUTEX_WAIT
+#define FUTEX_WAIT 0
+#define FUTEX_WAKE 1
+#define FUTEX_PRIVATE_FLAG 128
+#endif
+
+static volatile int32_t futex_word = 0;
+static volatile uint32_t futex_parked = 0;
+
+static long _futex(volatile int32_t* addr, int op, int32_t value, void* timeout)
+{
+    return syscall(SYS_futex, addr, op | FUTEX_PRIVATE_FLAG, value, timeout);
+}
+
+void enc_futex_reset()
+{
+    __atomic_store_n(&futex_word, 0, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&futex_parked, 0, __ATOMIC_SEQ_CST);
+}
+
+void enc_futex_set(int32_t value)
+{
+    __atomic_store_n(&futex_word, value, __ATOMIC_SEQ_CST);
+}
+
+// Wait once for the word to be 0. Returns 0 once woken, or the errno.
+int enc_futex_wait()
+{
+    __atomic_add_fetch(&futex_parked, 1, __ATOMIC_SEQ_CST);
+
+    if (_futex(&futex_word, FUTEX_WAIT, 0, NULL) != 0)
+        return errno;
+
+    return 0;
+}
+
+// Number of enc_futex_wait() calls about to wait or waiting
+uint32_t enc_futex_num_parked()
+{
+    return __atomic_load_n(&futex_parked, __ATOMIC_SEQ_CST);
+}
+
+// Wake all waiters without changing the word
+int enc_futex_wake()
+{
+    return (int)_futex(&futex_word, FUTEX_WAKE, INT_MAX, NULL);
+}
+
+void enc_test_futex_errors()
+{
+    struct timespec timeout = {0, 50 * 1000000};
+    volatile int32_t word = 1;
+
+    // The word does not hold the expected value.
+    OE_TEST(_futex(&word, FUTEX_WAIT, 0, NULL) == -1);
+    OE_TEST(errno == EAGAIN);
+
+    // Nobody wakes the waiter.
+    OE_TEST(_futex(&word, FUTEX_WAIT, 1, &timeout) == -1);
+    OE_TEST(errno == ETIMEDOUT);
+
+    // Nobody waits on the word.
+    OE_TEST(_futex(&word, FUTEX_WAKE, 1, NULL) == 0);
+}
@@ -5,8 +5,10 @@
 #include "thread.h"
 #endif
 
+#include <errno.h>
 #include <openenclave/enclave.h>
 #include <openenclave/internal/print.h>
+#include <openenclave/internal/tests.h>
 #include <openenclave/internal/thread.h>
 #include <openenclave/internal/types.h>
 #include <stdio.h>
@@ -163,3 +165,103 @@ void enc_rw_results(
     *max_writers = g_max_writers;
     *readers_and_writers = g_readers_and_writers;
 }
+
+// Take a read lock often enough for readers to bypass the spinlock, then
+// check that writers still see those readers.
+void enc_test_rwlock_bias()
+{
+    static oe_rwlock_t lock = OE_RWLOCK_INITIALIZER;
+
+    for (size_t i = 0; i < 1000; ++i)
+    {
+        OE_TEST(oe_rwlock_rdlock(&lock) == 0);
+        OE_TEST(oe_rwlock_unlock(&lock) == 0);
+    }
+
+    // Nested read locks, one of which may use the reader indicator.
+    OE_TEST(oe_rwlock_rdlock(&lock) == 0);
+    OE_TEST(oe_rwlock_rdlock(&lock) == 0);
+
+#ifdef _PTHREAD_ENC_
+    OE_TEST(pthread_rwlock_trywrlock(&lock) == EBUSY);
+#else
+    OE_TEST(oe_rwlock_trywrlock(&lock) == OE_BUSY);
+#endif
+
+    OE_TEST(oe_rwlock_unlock(&lock) == 0);
+    OE_TEST(oe_rwlock_unlock(&lock) == 0);
+
+    // With the readers gone, the writer gets the lock.
+    OE_TEST(oe_rwlock_wrlock(&lock) == 0);
+    OE_TEST(oe_rwlock_unlock(&lock) == 0);
+}
+
+static oe_rwlock_t g_bias_lock = OE_RWLOCK_INITIALIZER;
+static size_t g_bias_readers = 0;
+static size_t g_bias_writers = 0;
+static size_t g_bias_reads = 0;
+static bool g_bias_readers_and_writers = false;
+
+// Take read locks back to back, so that they mostly bypass the spinlock.
+// Some are held across an ocall, long enough for the writer to park.
+void enc_bias_reader_thread_impl(size_t iterations)
+{
+    for (size_t i = 0; i < iterations; ++i)
+    {
+        OE_TEST(oe_rwlock_rdlock(&g_bias_lock) == 0);
+        __atomic_add_fetch(&g_bias_readers, 1, __ATOMIC_SEQ_CST);
+
+        if (__atomic_load_n(&g_bias_writers, __ATOMIC_SEQ_CST))
+            g_bias_readers_and_writers = true;
+
+        if (i % 16 == 0)
+            host_usleep(sleep_utime);
+
+        if (__atomic_load_n(&g_bias_writers, __ATOMIC_SEQ_CST))
+            g_bias_readers_and_writers = true;
+
+        __atomic_sub_fetch(&g_bias_readers, 1, __ATOMIC_SEQ_CST);
+        __atomic_add_fetch(&g_bias_reads, 1, __ATOMIC_SEQ_CST);
+        OE_TEST(oe_rwlock_unlock(&g_bias_lock) == 0);
+    }
+}
+
+// Take write locks, each after enough reads for the lock to be reader-biased
+// again, so that every write lock revokes the bias from running readers.
+void enc_bias_writer_thread_impl()
+{
+    for (size_t i = 0; i < RWLOCK_BIAS_WRITES; ++i)
+    {
+        size_t reads = __atomic_load_n(&g_bias_reads, __ATOMIC_SEQ_CST) +
+                       RWLOCK_BIAS_READS;
+
+        // The readers may be done already.
+        for (size_t n = 0; n < 1000; ++n)
+        {
+            if (__atomic_load_n(&g_bias_reads, __ATOMIC_SEQ_CST) >= reads)
+                break;
+
+            host_usleep(sleep_utime);
+        }
+
+        OE_TEST(oe_rwlock_wrlock(&g_bias_lock) == 0);
+        __atomic_add_fetch(&g_bias_writers, 1, __ATOMIC_SEQ_CST);
+
+        if (__atomic_load_n(&g_bias_readers, __ATOMIC_SEQ_CST))
+            g_bias_readers_and_writers = true;
+
+        host_usleep(sleep_utime);
+
+        if (__atomic_load_n(&g_bias_readers, __ATOMIC_SEQ_CST))
+            g_bias_readers_and_writers = true;
+
+        __atomic_sub_fetch(&g_bias_writers, 1, __ATOMIC_SEQ_CST);
+        OE_TEST(oe_rwlock_unlock(&g_bias_lock) == 0);
+    }
+}
+
+void enc_bias_results(size_t* reads, bool* readers_and_writers)
+{
+    *reads = g_bias_reads;
+    *readers_and_writers = g_bias_readers_and_writers;
+}
@@ -6,6 +6,7 @@
 #include <openenclave/internal/tests.h>
 #include <atomic>
 #include <cassert>
+#include <cerrno>
 #include <chrono>
 #include <condition_variable>
 #include <cstdio>
@@ -122,6 +123,78 @@ void test_cond_broadcast(oe_enclave_t* enclave)
     printf("test_cond_broadcast Complete\n");
 }
 
+void test_cond_timedwait(oe_enclave_t* enclave)
+{
+    int ret = -1;
+
+    printf("test_cond_timedwait Starting\n");
+
+    // Nobody signals, so the wait must time out.
+    OE_TEST(enc_cond_timedwait(enclave, &ret, 50) == OE_OK);
+    OE_TEST(ret == 1);
+
+    // A signal must end the wait well before its deadline.
+    std::thread waiter([enclave, &ret]() {
+        OE_TEST(enc_cond_timedwait(enclave, &ret, 60 * 1000) == OE_OK);
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    OE_TEST(enc_cond_timedwait_signal(enclave) == OE_OK);
+    waiter.join();
+    OE_TEST(ret == 0);
+
+    printf("test_cond_timedwait Complete\n");
+}
+
+void test_futex(oe_enclave_t* enclave)
+{
+    std::thread threads[NUM_THREADS];
+    uint32_t parked = 0;
+    int woken = -1;
+    int ret = -1;
+
+    printf("test_futex Starting\n");
+
+    OE_TEST(enc_test_futex_errors(enclave) == OE_OK);
+    OE_TEST(enc_futex_reset(enclave) == OE_OK);
+
+    // The word stays 0, so every waiter returns only once it is woken.
+    for (size_t i = 0; i < NUM_THREADS; i++)
+    {
+        threads[i] = std::thread([enclave]() {
+            int wait_ret = -1;
+            OE_TEST(enc_futex_wait(enclave, &wait_ret) == OE_OK);
+            OE_TEST(wait_ret == 0);
+        });
+    }
+
+    for (int i = 0; i < 3000 && parked < NUM_THREADS; i++)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        OE_TEST(enc_futex_num_parked(enclave, &parked) == OE_OK);
+    }
+    OE_TEST(parked == NUM_THREADS);
+
+    // The waiters count themselves just before they queue.
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    OE_TEST(enc_futex_wake(enclave, &woken) == OE_OK);
+    OE_TEST(woken == (int)NUM_THREADS);
+
+    for (size_t i = 0; i < NUM_THREADS; i++)
+    {
+        threads[i].join();
+    }
+
+    // A word that no longer holds the value is not waited on.
+    OE_TEST(enc_futex_set(enclave, 1) == OE_OK);
+    OE_TEST(enc_futex_wait(enclave, &ret) == OE_OK);
+    OE_TEST(ret == EAGAIN);
+    OE_TEST(enc_futex_wake(enclave, &woken) == OE_OK);
+    OE_TEST(woken == 0);
+
+    printf("test_futex Complete\n");
+}
+
 void* exclusive_access_thread(oe_enclave_t* enclave)
 {
     const size_t ITERS = 2;
@@ -339,6 +412,10 @@ int main(int argc, const char* argv[])
 
     test_cond_broadcast(enclave);
 
+    test_cond_timedwait(enclave);
+
+    test_futex(enclave);
+
     test_thread_wake_wait(enclave);
 
     test_thread_locking_patterns(enclave);
@@ -32,6 +32,49 @@ void* writer_thread(oe_enclave_t* enclave)
     return NULL;
 }
 
+void* bias_reader_thread(oe_enclave_t* enclave)
+{
+    OE_TEST(
+        enc_bias_reader_thread_impl(enclave, RWLOCK_TEST_ITERS) == OE_OK);
+
+    return NULL;
+}
+
+void* bias_writer_thread(oe_enclave_t* enclave)
+{
+    OE_TEST(enc_bias_writer_thread_impl(enclave) == OE_OK);
+
+    return NULL;
+}
+
+// Launch reader threads that mostly hold the lock through their reader
+// indicators, and a writer that revokes the bias from them.
+static void test_readers_writer_lock_bias(oe_enclave_t* enclave)
+{
+    std::thread threads[NUM_READER_THREADS + 1];
+    size_t reads = 0;
+    bool readers_and_writers = false;
+
+    for (size_t i = 0; i < NUM_READER_THREADS; i++)
+    {
+        threads[i] = std::thread(bias_reader_thread, enclave);
+    }
+
+    threads[NUM_READER_THREADS] = std::thread(bias_writer_thread, enclave);
+
+    for (size_t i = 0; i < NUM_READER_THREADS + 1; i++)
+    {
+        threads[i].join();
+    }
+
+    OE_TEST(enc_bias_results(enclave, &reads, &readers_and_writers) == OE_OK);
+
+    OE_TEST(reads == NUM_READER_THREADS * RWLOCK_TEST_ITERS);
+
+    // Readers and the writer must never be simultaneously active.
+    OE_TEST(readers_and_writers == false);
+}
+
 // Launch multiple reader and writer threads and OE_TEST invariants.
 void test_readers_writer_lock(oe_enclave_t* enclave)
 {
@@ -82,4 +125,9 @@ void test_readers_writer_lock(oe_enclave_t* enclave)
     // Additionally, the test requires that all readers are
     // simultaneously active at least once.
     OE_TEST(max_readers == NUM_READER_THREADS);
+
+    // Writers must see readers that bypass the lock's spinlock.
+    OE_TEST(enc_test_rwlock_bias(enclave) == OE_OK);
+
+    test_readers_writer_lock_bias(enclave);
 }
@@ -17,4 +17,9 @@ const size_t NUM_RW_TEST_THREADS = 8;
 // Number of reader threads.
 const size_t NUM_READER_THREADS = NUM_RW_TEST_THREADS / 2;
 
+// Write locks taken while readers may hold the lock through their reader
+// indicators, and reads let through before each of them.
+const size_t RWLOCK_BIAS_WRITES = 50;
+const size_t RWLOCK_BIAS_READS = 128;
+
 #endif /* _rwlock_tests_h */
@@ -0,0 +1,82 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+
+#include <openenclave/enclave.h>
+#include <openenclave/internal/tests.h>
+#include <stdlib.h>
+#include "transition_bench_t.h"
+
+void enc_nop(void)
+{
+}
+
+void enc_nop_switchless(void)
+{
+}
+
+void enc_in(const uint8_t* buffer, size_t size)
+{
+    OE_UNUSED(buffer);
+    OE_UNUSED(size);
+}
+
+void enc_out(uint8_t* buffer, size_t size)
+{
+    OE_UNUSED(buffer);
+    OE_UNUSED(size);
+}
+
+static oe_result_t _make_ocall(
+    int index,
+    ocall_kind_t kind,
+    uint8_t* buffer,
+    size_t size)
+{
+    switch (kind)
+    {
+        case OCALL_KIND_NOP:
+            return host_nop(index);
+        case OCALL_KIND_NOP_SWITCHLESS:
+            return host_nop_switchless(index);
+        case OCALL_KIND_IN:
+            return host_in(index, buffer, size);
+        case OCALL_KIND_OUT:
+            return host_out(index, buffer, size);
+        default:
+            return OE_INVALID_PARAMETER;
+    }
+}
+
+int enc_make_ocalls(int index, ocall_kind_t kind, uint64_t count, size_t size)
+{
+    int ret = -1;
+    uint8_t* buffer = NULL;
+
+    if (size && !(buffer = (uint8_t*)calloc(1, size)))
+        goto done;
+
+    for (uint64_t i = 0; i < count; i++)
+    {
+        if (_make_ocall(index, kind, buffer, size) != OE_OK)
+            goto done;
+    }
+
+    ret = 0;
+
+done:
+    free(buffer);
+    return ret;
+}
+
+void enc_nested(void)
+{
+    OE_TEST(host_nested() == OE_OK);
+}
+
+OE_SET_ENCLAVE_SGX(
+    1,    /* ProductID */
+    1,    /* SecurityVersion */
+    true, /* AllowDebug */
+    8192, /* HeapPageCount */
+    64,   /* StackPageCount */
+    8);   /* TCSCount */
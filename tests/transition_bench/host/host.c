@@ -0,0 +1,473 @@
+// Copyright (c) Open Enclave SDK contributors.
+// Licensed under the MIT License.
+
+#include <inttypes.h>
+#include <openenclave/host.h>
+#include <openenclave/internal/error.h>
+#include <openenclave/internal/tests.h>
+#include <openenclave/internal/time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../../../host/hostthread.h"
+#include "transition_bench_u.h"
+
+/*
+**==============================================================================
+**
+** Transition microbenchmarks:
+**
+**     Measure the latency of ecalls, ocalls, nested calls, switchless calls
+**     and the marshalling of payloads from 0 B to 1 MB, with 1 to
+**     MAX_THREADS concurrent host threads, and print the percentiles as
+**     JSON. Ecalls are timed around the call. Ocalls are timed by the
+**     interval between two consecutive ocalls of the same enclave thread,
+**     which covers the exit, the host function and the re-entry.
+**
+**     The switchless workers can be pinned to lists of CPUs, such as
+**     "0,1", to compare switchless latencies with and without pinning.
+**
+**     Usage: transition_bench_host ENCLAVE_PATH [--iterations N]
+**                [--threads N] [--output FILE]
+**                [--host-worker-cpus LIST] [--enclave-worker-cpus LIST]
+**
+**==============================================================================
+*/
+
+#define DEFAULT_NUM_ITERATIONS 1000
+
+/* The enclave has 8 TCSs: one per host thread and two switchless workers */
+#define MAX_THREADS 4
+#define NUM_SWITCHLESS_WORKERS 2
+
+/* Max number of CPUs in a list of CPUs to pin workers to */
+#define MAX_CPUS 64
+
+/* Payloads at least this large run fewer iterations */
+#define LARGE_PAYLOAD_SIZE (64 * 1024)
+#define LARGE_PAYLOAD_DIVISOR 16
+
+typedef enum _bench_kind
+{
+    BENCH_ECALL,
+    BENCH_ECALL_IN,
+    BENCH_ECALL_OUT,
+    BENCH_NESTED,
+    BENCH_SWITCHLESS_ECALL,
+    BENCH_OCALL,
+    BENCH_OCALL_IN,
+    BENCH_OCALL_OUT,
+    BENCH_SWITCHLESS_OCALL,
+} bench_kind_t;
+
+typedef struct _bench
+{
+    const char* name;
+    bench_kind_t kind;
+    bool has_payload;
+} bench_t;
+
+static const bench_t _benches[] = {
+    {"ecall", BENCH_ECALL, false},
+    {"ecall_in", BENCH_ECALL_IN, true},
+    {"ecall_out", BENCH_ECALL_OUT, true},
+    {"nested_call", BENCH_NESTED, false},
+    {"switchless_ecall", BENCH_SWITCHLESS_ECALL, false},
+    {"ocall", BENCH_OCALL, false},
+    {"ocall_in", BENCH_OCALL_IN, true},
+    {"ocall_out", BENCH_OCALL_OUT, true},
+    {"switchless_ocall", BENCH_SWITCHLESS_OCALL, false},
+};
+
+static const size_t _payload_sizes[] = {64, 4096, 65536, 1024 * 1024};
+
+typedef struct _bench_thread
+{
+    oe_thread_t tid;
+    int index;
+    const bench_t* bench;
+    size_t size;
+    uint64_t iterations;
+    uint8_t* buffer;
+
+    uint64_t* samples;
+    uint64_t num_samples;
+
+    /* Time of the previous ocall made on behalf of this thread */
+    uint64_t last_ocall_ns;
+
+    uint64_t failures;
+} bench_thread_t;
+
+static oe_enclave_t* _enclave;
+static bench_thread_t _threads[MAX_THREADS];
+
+static void _record_ocall(int index)
+{
+    bench_thread_t* thread;
+    uint64_t now = oe_get_monotonic_time_ns();
+
+    OE_TEST(index >= 0 && index < MAX_THREADS);
+    thread = &_threads[index];
+
+    if (thread->last_ocall_ns && thread->num_samples < thread->iterations)
+        thread->samples[thread->num_samples++] = now - thread->last_ocall_ns;
+
+    thread->last_ocall_ns = now;
+}
+
+void host_nop(int index)
+{
+    _record_ocall(index);
+}
+
+void host_nop_switchless(int index)
+{
+    _record_ocall(index);
+}
+
+void host_in(int index, const uint8_t* buffer, size_t size)
+{
+    OE_UNUSED(buffer);
+    OE_UNUSED(size);
+    _record_ocall(index);
+}
+
+void host_out(int index, uint8_t* buffer, size_t size)
+{
+    OE_UNUSED(buffer);
+    OE_UNUSED(size);
+    _record_ocall(index);
+}
+
+void host_nested(void)
+{
+    OE_TEST(enc_nop(_enclave) == OE_OK);
+}
+
+static oe_result_t _call_enclave(bench_thread_t* thread)
+{
+    switch (thread->bench->kind)
+    {
+        case BENCH_ECALL:
+            return enc_nop(_enclave);
+        case BENCH_ECALL_IN:
+            return enc_in(_enclave, thread->buffer, thread->size);
+        case BENCH_ECALL_OUT:
+            return enc_out(_enclave, thread->buffer, thread->size);
+        case BENCH_NESTED:
+            return enc_nested(_enclave);
+        case BENCH_SWITCHLESS_ECALL:
+            return enc_nop_switchless(_enclave);
+        default:
+            return OE_INVALID_PARAMETER;
+    }
+}
+
+static ocall_kind_t _ocall_kind(bench_kind_t kind)
+{
+    switch (kind)
+    {
+        case BENCH_OCALL_IN:
+            return OCALL_KIND_IN;
+        case BENCH_OCALL_OUT:
+            return OCALL_KIND_OUT;
+        case BENCH_SWITCHLESS_OCALL:
+            return OCALL_KIND_NOP_SWITCHLESS;
+        default:
+            return OCALL_KIND_NOP;
+    }
+}
+
+static void* _thread(void* arg)
+{
+    bench_thread_t* thread = (bench_thread_t*)arg;
+
+    switch (thread->bench->kind)
+    {
+        case BENCH_OCALL:
+        case BENCH_OCALL_IN:
+        case BENCH_OCALL_OUT:
+        case BENCH_SWITCHLESS_OCALL:
+        {
+            int ret = -1;
+
+            // One more ocall than samples, as the first one only starts
+            // the clock.
+            if (enc_make_ocalls(
+                    _enclave,
+                    &ret,
+                    thread->index,
+                    _ocall_kind(thread->bench->kind),
+                    thread->iterations + 1,
+                    thread->size) != OE_OK ||
+                ret != 0)
+                thread->failures++;
+            break;
+        }
+        default:
+        {
+            for (uint64_t i = 0; i < thread->iterations; i++)
+            {
+                uint64_t start = oe_get_monotonic_time_ns();
+
+                if (_call_enclave(thread) != OE_OK)
+                    thread->failures++;
+
+                thread->samples[thread->num_samples++] =
+                    oe_get_monotonic_time_ns() - start;
+            }
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+static int _compare_samples(const void* a, const void* b)
+{
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+static uint64_t _percentile(const uint64_t* sorted, uint64_t n, double p)
+{
+    return sorted[(uint64_t)(p * (double)(n - 1) + 0.5)];
+}
+
+static void _run(
+    FILE* out,
+    const bench_t* bench,
+    size_t size,
+    uint64_t num_threads,
+    uint64_t iterations,
+    bool* first)
+{
+    uint64_t* samples = NULL;
+    uint64_t num_samples = 0;
+    uint64_t total = 0;
+
+    for (uint64_t i = 0; i < num_threads; i++)
+    {
+        bench_thread_t* thread = &_threads[i];
+
+        memset(thread, 0, sizeof(*thread));
+        thread->index = (int)i;
+        thread->bench = bench;
+        thread->size = size;
+        thread->iterations = iterations;
+
+        OE_TEST(
+            (thread->samples =
+                 (uint64_t*)calloc(iterations, sizeof(uint64_t))) != NULL);
+
+        if (size)
+            OE_TEST((thread->buffer = (uint8_t*)calloc(1, size)) != NULL);
+    }
+
+    for (uint64_t i = 0; i < num_threads; i++)
+    {
+        int ret = 0;
+        if ((ret = oe_thread_create(&_threads[i].tid, _thread, &_threads[i])))
+            oe_put_err("thread_create(host): ret=%u", ret);
+    }
+
+    for (uint64_t i = 0; i < num_threads; i++)
+        oe_thread_join(_threads[i].tid);
+
+    OE_TEST(
+        (samples = (uint64_t*)calloc(
+             num_threads * iterations, sizeof(uint64_t))) != NULL);
+
+    for (uint64_t i = 0; i < num_threads; i++)
+    {
+        bench_thread_t* thread = &_threads[i];
+
+        OE_TEST(thread->failures == 0);
+        OE_TEST(thread->num_samples == iterations);
+
+        memcpy(
+            samples + num_samples,
+            thread->samples,
+            thread->num_samples * sizeof(uint64_t));
+        num_samples += thread->num_samples;
+
+        free(thread->samples);
+        free(thread->buffer);
+    }
+
+    qsort(samples, num_samples, sizeof(uint64_t), _compare_samples);
+
+    for (uint64_t i = 0; i < num_samples; i++)
+        total += samples[i];
+
+    fprintf(
+        out,
+        "%s\n    {\"name\": \"%s\", \"payload_bytes\": %zu, "
+        "\"threads\": %" PRIu64 ", \"samples\": %" PRIu64 ", "
+        "\"min_ns\": %" PRIu64 ", \"mean_ns\": %" PRIu64 ", "
+        "\"p50_ns\": %" PRIu64 ", \"p90_ns\": %" PRIu64 ", "
+        "\"p99_ns\": %" PRIu64 ", \"p999_ns\": %" PRIu64 ", "
+        "\"max_ns\": %" PRIu64 "}",
+        *first ? "" : ",",
+        bench->name,
+        size,
+        num_threads,
+        num_samples,
+        samples[0],
+        total / num_samples,
+        _percentile(samples, num_samples, 0.50),
+        _percentile(samples, num_samples, 0.90),
+        _percentile(samples, num_samples, 0.99),
+        _percentile(samples, num_samples, 0.999),
+        samples[num_samples - 1]);
+
+    *first = false;
+    free(samples);
+}
+
+/* Parse a comma-separated list of CPUs */
+static size_t _parse_cpus(const char* list, uint32_t cpus[MAX_CPUS])
+{
+    size_t num_cpus = 0;
+    char* end = NULL;
+
+    while (*list)
+    {
+        if (num_cpus == MAX_CPUS)
+            oe_put_err("too many CPUs: %s", list);
+
+        cpus[num_cpus++] = (uint32_t)strtoul(list, &end, 10);
+
+        if (end == list || (*end && *end != ','))
+            oe_put_err("invalid list of CPUs: %s", list);
+
+        list = *end ? end + 1 : end;
+    }
+
+    return num_cpus;
+}
+
+static void _print_cpus(FILE* out, const uint32_t* cpus, size_t num_cpus)
+{
+    fprintf(out, "[");
+
+    for (size_t i = 0; i < num_cpus; i++)
+        fprintf(out, "%s%u", i ? ", " : "", cpus[i]);
+
+    fprintf(out, "]");
+}
+
+int main(int argc, const char* argv[])
+{
+    oe_result_t result;
+    uint32_t flags = oe_get_create_flags();
+    uint64_t iterations = DEFAULT_NUM_ITERATIONS;
+    uint64_t max_threads = MAX_THREADS;
+    const char* output_path = NULL;
+    FILE* out = stdout;
+    bool first = true;
+    uint32_t host_worker_cpus[MAX_CPUS];
+    uint32_t enclave_worker_cpus[MAX_CPUS];
+    oe_enclave_setting_context_switchless_t switchless_setting = {
+        NUM_SWITCHLESS_WORKERS, NUM_SWITCHLESS_WORKERS};
+    oe_enclave_setting_t settings[] = {{
+        .setting_type = OE_ENCLAVE_SETTING_CONTEXT_SWITCHLESS,
+        .u.context_switchless_setting = &switchless_setting,
+    }};
+
+    if (argc < 2)
+    {
+        fprintf(
+            stderr,
+            "Usage: %s ENCLAVE_PATH [--iterations N] [--threads N] "
+            "[--output FILE] [--host-worker-cpus LIST] "
+            "[--enclave-worker-cpus LIST]\n",
+            argv[0]);
+        return 1;
+    }
+
+    for (int i = 2; i + 1 < argc; i += 2)
+    {
+        if (strcmp(argv[i], "--iterations") == 0)
+            iterations = strtoull(argv[i + 1], NULL, 10);
+        else if (strcmp(argv[i], "--threads") == 0)
+            max_threads = strtoull(argv[i + 1], NULL, 10);
+        else if (strcmp(argv[i], "--output") == 0)
+            output_path = argv[i + 1];
+        else if (strcmp(argv[i], "--host-worker-cpus") == 0)
+        {
+            switchless_setting.host_worker_cpus = host_worker_cpus;
+            switchless_setting.num_host_worker_cpus =
+                _parse_cpus(argv[i + 1], host_worker_cpus);
+        }
+        else if (strcmp(argv[i], "--enclave-worker-cpus") == 0)
+        {
+            switchless_setting.enclave_worker_cpus = enclave_worker_cpus;
+            switchless_setting.num_enclave_worker_cpus =
+                _parse_cpus(argv[i + 1], enclave_worker_cpus);
+        }
+        else
+            oe_put_err("unknown option: %s", argv[i]);
+    }
+
+    if (iterations == 0 || max_threads == 0 || max_threads > MAX_THREADS)
+        oe_put_err("invalid iterations or threads");
+
+    if (output_path && !(out = fopen(output_path, "w")))
+        oe_put_err("cannot open %s", output_path);
+
+    if ((result = oe_create_transition_bench_enclave(
+             argv[1],
+             OE_ENCLAVE_TYPE_SGX,
+             flags,
+             settings,
+             OE_COUNTOF(settings),
+             &_enclave)) != OE_OK)
+        oe_put_err("oe_create_enclave(): result=%u", result);
+
+    fprintf(
+        out,
+        "{\n  \"simulation\": %s,\n  \"iterations\": %" PRIu64 ",\n",
+        (flags & OE_ENCLAVE_FLAG_SIMULATE) ? "true" : "false",
+        iterations);
+    fprintf(out, "  \"host_worker_cpus\": ");
+    _print_cpus(
+        out, host_worker_cpus, switchless_setting.num_host_worker_cpus);
+    fprintf(out, ",\n  \"enclave_worker_cpus\": ");
+    _print_cpus(
+        out, enclave_worker_cpus, switchless_setting.num_enclave_worker_cpus);
+    fprintf(out, ",\n  \"results\": [");
+
+    for (size_t b = 0; b < OE_COUNTOF(_benches); b++)
+    {
+        const bench_t* bench = &_benches[b];
+        size_t num_sizes = bench->has_payload ? OE_COUNTOF(_payload_sizes) : 1;
+
+        for (size_t s = 0; s < num_sizes; s++)
+        {
+            size_t size = bench->has_payload ? _payload_sizes[s] : 0;
+            uint64_t n = iterations;
+
+            if (size >= LARGE_PAYLOAD_SIZE)
+                n = n / LARGE_PAYLOAD_DIVISOR ? n / LARGE_PAYLOAD_DIVISOR : 1;
+
+            for (uint64_t t = 1; t <= max_threads; t *= 2)
+                _run(out, bench, size, t, n, &first);
+        }
+    }
+
+    fprintf(out, "\n  ]\n}\n");
+
+    if (out != stdout)
+        fclose(out);
+
+    result = oe_terminate_enclave(_enclave);
+    OE_TEST(result == OE_OK);
+
+    fprintf(stderr, "=== passed all tests (transition_bench)\n");
+
+    return 0;
+}